@@ -0,0 +1,169 @@
+/**
+ * @file "bench.h"
+ * @brief Timing harness shared by the decoders' standalone benchmarks
+ * @date 2025
+ *
+ * Each bench/ program under src/designN/decoder defines its operations as
+ * bench_op_t functions and times them with bench() (or bench_run() and
+ * bench_print_result() when it reports more fields). An operation is repeated
+ * in blocks of BENCH_NUM_BLOCKS calls until at least BENCH_MIN_RUNTIME_SEC
+ * has elapsed, and the result is printed as one JSON object per line:
+ *
+ *   {"design": ..., "config": ..., "op": ..., "size": ..., "ops": ...,
+ *    "seconds": ..., "us_per_op": ..., "cycles_per_op": ...}
+ *
+ * Cycle counts come from the time stamp counter on x86 hosts and are null
+ * elsewhere (qemu-arm does not model cycles), where us_per_op is the figure to
+ * compare. BENCH_DESIGN and BENCH_CONFIG are set by bench.mk.
+ *
+ * The functions are static inline: each benchmark is a single translation
+ * unit, and not every one of them uses all of the functions.
+ *
+ * This source file is part of an example system for MITRE's 2025 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2025 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ *
+ * @copyright Copyright (c) 2025 The MITRE Corporation
+ */
+
+#ifndef __BENCH__
+#define __BENCH__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_CYCLE_COUNTER 1
+#endif
+
+/******************************** MACRO DEFINITIONS ********************************/
+#ifndef BENCH_MIN_RUNTIME_SEC
+#define BENCH_MIN_RUNTIME_SEC 1.0
+#endif
+#ifndef BENCH_NUM_BLOCKS
+#define BENCH_NUM_BLOCKS 64
+#endif
+#ifndef BENCH_DESIGN
+#define BENCH_DESIGN "unknown"
+#endif
+#ifndef BENCH_CONFIG
+#define BENCH_CONFIG "unnamed"
+#endif
+
+/******************************** TYPE DEFINITIONS ********************************/
+/** @brief One operation under test; returns 0 on success. */
+typedef int (*bench_op_t)(void *arg);
+
+typedef struct {
+    long count;         // Calls made
+    double seconds;     // Wall time of all calls
+    uint64_t cycles;    // Cycle counter delta, 0 without BENCH_HAVE_CYCLE_COUNTER
+} bench_result_t;
+
+/******************************** FUNCTION DEFINITIONS ********************************/
+/** @brief Returns a monotonic time in seconds.
+*/
+static inline double bench_time(void) {
+#if defined(__linux__) || defined(__APPLE__)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#else
+    // newlib + semihosting (arm-none-eabi under qemu-arm)
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/** @brief Returns the cycle counter, or 0 if there is none.
+*/
+static inline uint64_t bench_cycles(void) {
+#ifdef BENCH_HAVE_CYCLE_COUNTER
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/** @brief Repeats an operation for at least BENCH_MIN_RUNTIME_SEC.
+ *
+ * @param op Operation to time.
+ * @param arg Argument passed to every call of op.
+ * @param result Filled with the number of calls and the time they took.
+ *
+ * @return 0 if every call succeeded, non-zero otherwise.
+ */
+static inline int bench_run(bench_op_t op, void *arg, bench_result_t *result) {
+    int retcode = 0;
+    long count = 0;
+    uint64_t start_cycles = bench_cycles();
+    double start = bench_time();
+    double elapsed;
+
+    do {
+        for (int i = 0; i < BENCH_NUM_BLOCKS; i++) {
+            retcode |= op(arg);
+        }
+        count += BENCH_NUM_BLOCKS;
+        elapsed = bench_time() - start;
+    } while (elapsed < BENCH_MIN_RUNTIME_SEC);
+
+    result->cycles = bench_cycles() - start_cycles;
+    result->count = count;
+    result->seconds = elapsed;
+    return retcode;
+}
+
+/** @brief Prints the common fields of a result line, leaving the object open.
+ *
+ * The caller may print more ", \"name\": value" fields, then must close the
+ * line with bench_print_end().
+ *
+ * @param name Name of the operation.
+ * @param size Size of the input in bytes.
+ * @param result Result of bench_run().
+ */
+static inline void bench_print_result(const char *name, size_t size, const bench_result_t *result) {
+    printf("{\"design\": \"%s\", \"config\": \"%s\", \"op\": \"%s\", \"size\": %u, "
+            "\"ops\": %ld, \"seconds\": %.6f, \"us_per_op\": %.3f, ",
+            BENCH_DESIGN, BENCH_CONFIG, name, (unsigned)size, result->count,
+            result->seconds, result->seconds * 1e6 / result->count);
+#ifdef BENCH_HAVE_CYCLE_COUNTER
+    printf("\"cycles_per_op\": %.1f", (double)result->cycles / result->count);
+#else
+    printf("\"cycles_per_op\": null");
+#endif
+}
+
+/** @brief Closes the line opened by bench_print_result().
+*/
+static inline void bench_print_end(void) {
+    printf("}\n");
+    fflush(stdout);
+}
+
+/** @brief Times one operation and prints its result line.
+ *
+ * @param name Name of the operation.
+ * @param size Size of the input in bytes.
+ * @param op Operation to time.
+ * @param arg Argument passed to every call of op.
+ *
+ * @return 0 on success, non-zero on error.
+ */
+static inline int bench(const char *name, size_t size, bench_op_t op, void *arg) {
+    bench_result_t result;
+    int retcode = bench_run(op, arg, &result);
+
+    if (retcode != 0) {
+        fprintf(stderr, "%s(%u) failed during timing\n", name, (unsigned)size);
+        return retcode;
+    }
+    bench_print_result(name, size, &result);
+    bench_print_end();
+    return 0;
+}
+
+#endif // __BENCH__
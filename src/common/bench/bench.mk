@@ -0,0 +1,84 @@
+# Shared part of the decoders' standalone benchmark builds (bench/ next to each
+# decoder's Makefile): the host and arm toolchains, wolfCrypt and the timing
+# harness in bench.h. None of it uses the MSDK.
+#
+# Each bench Makefile sets the variables below, includes this file, then adds
+# its own `all` target and the link rules of its benchmarks:
+#   include ../../../common/bench/bench.mk
+#
+# Set by the bench Makefile:
+# - DESIGN : Design name, reported in every result line
+# - WOLFSSL_ROOT : wolfSSL source tree (same one the firmware is built from)
+# - DECODER_CFLAGS : wolfSSL and decoder defines of the firmware build
+#
+# Configuration variables:
+# - ARCH : "host" (native gcc) or "arm" (arm-none-eabi-gcc for the Cortex-M4,
+#          run under qemu-arm with semihosting; needs the qemu-user package)
+# - CONFIG : Name of the configuration, used for the build directory
+# - CONFIG_CFLAGS : Extra wolfSSL defines for this configuration
+# - CONFIG_SRCS : Extra sources relative to wolfcrypt/src (e.g. port/arm/*.S)
+#
+# Provides CC, NM, CFLAGS, LDFLAGS, RUN, BUILD_DIR and WOLFCRYPT_OBJS, and
+# rules for $(BUILD_DIR)/%.o from the bench's own sources and wolfCrypt's.
+
+BENCH_DIR := $(patsubst %/,%,$(dir $(lastword $(MAKEFILE_LIST))))
+
+ARCH ?= host
+CONFIG ?= baseline
+CONFIG_CFLAGS ?=
+CONFIG_SRCS ?=
+BUILD_DIR ?= build/$(ARCH)/$(CONFIG)
+
+ifeq ($(ARCH),arm)
+CROSS ?= arm-none-eabi-
+ARCH_CFLAGS := -mcpu=cortex-m4 -mthumb -mfloat-abi=soft
+ARCH_LDFLAGS := --specs=rdimon.specs
+RUN ?= qemu-arm -cpu cortex-m4
+else ifeq ($(ARCH),host)
+CROSS ?=
+ARCH_CFLAGS :=
+ARCH_LDFLAGS :=
+RUN ?=
+else
+$(error Unknown ARCH '$(ARCH)', expected host or arm)
+endif
+
+CC := $(CROSS)gcc
+NM := $(CROSS)nm
+
+# Same optimization and section flags as the MSDK release build
+CFLAGS := -O2 -ffunction-sections -fdata-sections -Wall
+CFLAGS += $(ARCH_CFLAGS)
+CFLAGS += -I$(BENCH_DIR) -I$(WOLFSSL_ROOT)
+CFLAGS += $(DECODER_CFLAGS) $(CONFIG_CFLAGS)
+CFLAGS += -DBENCH_DESIGN=\"$(DESIGN)\" -DBENCH_CONFIG=\"$(CONFIG)\"
+LDFLAGS := -Wl,--gc-sections $(ARCH_LDFLAGS)
+
+WOLFCRYPT_SRC := $(WOLFSSL_ROOT)/wolfcrypt/src
+WOLFCRYPT_SRCS := $(wildcard $(WOLFCRYPT_SRC)/*.c)
+WOLFCRYPT_SRCS += $(addprefix $(WOLFCRYPT_SRC)/,$(CONFIG_SRCS))
+WOLFCRYPT_OBJS := $(addprefix $(BUILD_DIR)/wolfcrypt/,$(addsuffix .o,$(basename $(notdir $(WOLFCRYPT_SRCS)))))
+
+vpath %.c $(sort $(dir $(WOLFCRYPT_SRCS)))
+vpath %.S $(sort $(dir $(WOLFCRYPT_SRCS)))
+
+# The bench Makefile defines `all` after including this file
+.DEFAULT_GOAL := all
+
+.PHONY: clean
+
+# The benchmarks themselves, from bench/
+$(BUILD_DIR)/%.o: %.c $(BENCH_DIR)/bench.h | $(BUILD_DIR)/wolfcrypt
+	$(CC) $(CFLAGS) -c -o $@ $<
+
+$(BUILD_DIR)/wolfcrypt/%.o: %.c | $(BUILD_DIR)/wolfcrypt
+	$(CC) $(CFLAGS) -c -o $@ $<
+
+$(BUILD_DIR)/wolfcrypt/%.o: %.S | $(BUILD_DIR)/wolfcrypt
+	$(CC) $(CFLAGS) -c -o $@ $<
+
+$(BUILD_DIR)/wolfcrypt:
+	mkdir -p $@
+
+clean:
+	rm -rf build
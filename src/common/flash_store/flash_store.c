@@ -0,0 +1,431 @@
+/**
+ * @file "flash_store.c"
+ * @brief Log-structured record store in flash
+ * @date 2025
+ *
+ * Layout of each page of the ring. Everything is programmed in whole 16-byte
+ * lines, the MAX78000's flash programming unit, and no line is programmed
+ * twice between erases:
+ *
+ *   page_header_t      programmed last when a page is made active
+ *   record_header_t    \
+ *   data, padded        | one record; repeated until the first erased line
+ *   record_commit_t    /
+ *
+ * This source file is part of an example system for MITRE's 2025 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2025 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ *
+ * @copyright Copyright (c) 2025 The MITRE Corporation
+ */
+
+#include "flash_store.h"
+
+#include <string.h>
+
+#include "mxc_device.h"
+#include "simple_flash.h"
+
+#ifdef FLASH_STORE_TRACE
+#include <stdio.h>
+#endif
+
+/******************************** MACRO DEFINITIONS ********************************/
+#define FLASH_STORE_LINE 16
+#define PAGE_MAGIC 0x31534650    // "PFS1"
+#define RECORD_MAGIC 0x31534652  // "RFS1"
+#define RECORD_COMMIT 0x31534643 // "CFS1"
+#define ERASED_WORD 0xFFFFFFFF
+
+#define LINE_ALIGN(x) (((x) + FLASH_STORE_LINE - 1) & ~(FLASH_STORE_LINE - 1))
+#define RECORD_SIZE(len) (2 * FLASH_STORE_LINE + LINE_ALIGN(len))
+#define PAGE_ADDRESS(page) (FLASH_STORE_BASE + (page) * MXC_FLASH_PAGE_SIZE)
+
+#if FLASH_STORE_PAGES < 2
+#error "FLASH_STORE_PAGES must be at least 2"
+#endif
+
+/******************************** TYPE DEFINITIONS ********************************/
+typedef struct {
+    uint32_t magic;
+    uint32_t generation; // The valid page with the highest generation is active
+    uint32_t check;      // ~generation, so that a torn header is not valid
+    uint32_t reserved;
+} page_header_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t key;
+    uint16_t len;
+    uint32_t check;      // ~(key | len << 16)
+    uint32_t reserved;
+} record_header_t;
+
+typedef struct {
+    uint32_t commit;     // RECORD_COMMIT once the record is complete
+    uint32_t reserved[3];
+} record_commit_t;
+
+typedef struct {
+    uint16_t key;
+    uint16_t len;
+    uint32_t offset;     // Offset of the record header in the active page
+} index_entry_t;
+
+/******************************** GLOBALS ********************************/
+static struct {
+    uint32_t page;       // Index of the active page in the ring
+    uint32_t generation;
+    uint32_t tail;       // Offset of the first free line in the active page
+    uint32_t count;
+    index_entry_t index[FLASH_STORE_MAX_KEYS];
+} store;
+
+// Padded data of the record being programmed
+static uint32_t record_buf[FLASH_STORE_MAX_RECORD / sizeof(uint32_t)];
+
+static flash_simple_stats_t op_start;
+static flash_store_stats_t last_stats;
+
+/******************************** FUNCTION DEFINITIONS ********************************/
+/** @brief Starts counting the flash operations of a flash_store call.
+*/
+static void op_begin(void) {
+    flash_simple_get_stats(&op_start);
+    memset(&last_stats, 0, sizeof(last_stats));
+}
+
+/** @brief Stops counting the flash operations of a flash_store call.
+ *
+ *  @param op The name of the call, for the trace.
+ *  @param key The key it accessed, for the trace, or -1 if none.
+*/
+static void op_end(const char *op, int key) {
+    flash_simple_stats_t now;
+
+    flash_simple_get_stats(&now);
+    last_stats.erases = now.erases - op_start.erases;
+    last_stats.programs = now.programs - op_start.programs;
+    last_stats.program_bytes = now.program_bytes - op_start.program_bytes;
+#ifdef FLASH_STORE_TRACE
+    if (key >= 0) {
+        fprintf(stderr, "flash_store: %s key %d: ", op, key);
+    } else {
+        fprintf(stderr, "flash_store: %s: ", op);
+    }
+    fprintf(stderr, "%lu erases, %lu programs, %lu bytes%s\n",
+            (unsigned long)last_stats.erases, (unsigned long)last_stats.programs,
+            (unsigned long)last_stats.program_bytes, last_stats.compacted ? " (compacted)" : "");
+#else
+    (void)op;
+    (void)key;
+#endif
+}
+
+/** @brief Reads the header of a page in the ring.
+ *
+ *  @param page The index of the page in the ring.
+ *  @param generation Set to the page's generation if it is valid.
+ *
+ *  @return 0 if the page has a valid header, -1 if not.
+*/
+static int read_page_header(uint32_t page, uint32_t *generation) {
+    page_header_t header;
+
+    flash_simple_read(PAGE_ADDRESS(page), &header, sizeof(header));
+    if (header.magic != PAGE_MAGIC || header.check != ~header.generation) {
+        return -1;
+    }
+    *generation = header.generation;
+    return 0;
+}
+
+/** @brief Programs the header that makes a page valid.
+ *
+ *  @param page The index of the page in the ring.
+ *  @param generation The page's generation.
+ *
+ *  @return 0 on success, a negative value on a flash error.
+*/
+static int write_page_header(uint32_t page, uint32_t generation) {
+    page_header_t header = {
+        .magic = PAGE_MAGIC,
+        .generation = generation,
+        .check = ~generation,
+        .reserved = ERASED_WORD,
+    };
+
+    return flash_simple_write(PAGE_ADDRESS(page), &header, sizeof(header));
+}
+
+/** @brief Programs a record and then its commit marker.
+ *
+ *  @param page The index of the page in the ring.
+ *  @param offset Offset in the page of the (erased) space for the record.
+ *  @param key The record's key.
+ *  @param buf The record.
+ *  @param len The length of the record.
+ *
+ *  @return 0 on success, a negative value on a flash error.
+*/
+static int program_record(uint32_t page, uint32_t offset, uint16_t key,
+                          const void *buf, uint16_t len) {
+    uint32_t address = PAGE_ADDRESS(page) + offset;
+    record_header_t header = {
+        .magic = RECORD_MAGIC,
+        .key = key,
+        .len = len,
+        .check = ~((uint32_t)key | (uint32_t)len << 16),
+        .reserved = ERASED_WORD,
+    };
+    record_commit_t commit = {
+        .commit = RECORD_COMMIT,
+        .reserved = { ERASED_WORD, ERASED_WORD, ERASED_WORD },
+    };
+    int ret;
+
+    ret = flash_simple_write(address, &header, sizeof(header));
+    if (ret != 0) {
+        return ret;
+    }
+    address += sizeof(header);
+
+    if (len > 0) {
+        // Pad the last line with erased bytes so it is programmed only once
+        memset(record_buf, 0xFF, LINE_ALIGN(len));
+        memcpy(record_buf, buf, len);
+        ret = flash_simple_write(address, record_buf, LINE_ALIGN(len));
+        if (ret != 0) {
+            return ret;
+        }
+        address += LINE_ALIGN(len);
+    }
+
+    return flash_simple_write(address, &commit, sizeof(commit));
+}
+
+/** @brief Finds a key in the index.
+ *
+ *  @param key The key to look for.
+ *
+ *  @return The index entry, or NULL if the key has no record.
+*/
+static index_entry_t *find_key(uint16_t key) {
+    for (uint32_t i = 0; i < store.count; i++) {
+        if (store.index[i].key == key) {
+            return &store.index[i];
+        }
+    }
+    return NULL;
+}
+
+/** @brief Points the index entry of a key at a record, adding it if needed.
+ *
+ *  @param key The record's key.
+ *  @param len The length of the record.
+ *  @param offset Offset of the record header in the active page.
+ *
+ *  @return 0 on success, -1 if the index is full.
+*/
+static int index_set(uint16_t key, uint16_t len, uint32_t offset) {
+    index_entry_t *entry = find_key(key);
+
+    if (entry == NULL) {
+        if (store.count == FLASH_STORE_MAX_KEYS) {
+            return -1;
+        }
+        entry = &store.index[store.count++];
+        entry->key = key;
+    }
+    entry->len = len;
+    entry->offset = offset;
+    return 0;
+}
+
+/** @brief Indexes the committed records of the active page and finds its tail.
+*/
+static void scan_page(void) {
+    static const uint8_t erased[FLASH_STORE_LINE] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    };
+    uint32_t address = PAGE_ADDRESS(store.page);
+    uint32_t offset = sizeof(page_header_t);
+    record_header_t header;
+    record_commit_t commit;
+
+    store.count = 0;
+    while (offset + RECORD_SIZE(0) <= MXC_FLASH_PAGE_SIZE) {
+        flash_simple_read(address + offset, &header, sizeof(header));
+        if (memcmp(&header, erased, sizeof(header)) == 0) {
+            break;
+        }
+        if (header.magic != RECORD_MAGIC
+                || header.check != ~((uint32_t)header.key | (uint32_t)header.len << 16)
+                || header.len > FLASH_STORE_MAX_RECORD
+                || offset + RECORD_SIZE(header.len) > MXC_FLASH_PAGE_SIZE) {
+            // A torn header: nothing after it can be trusted, so treat the
+            // page as full and let the next write compact it
+            offset = MXC_FLASH_PAGE_SIZE;
+            break;
+        }
+
+        // A record without its commit marker was interrupted; skip over it
+        flash_simple_read(address + offset + sizeof(header) + LINE_ALIGN(header.len),
+                          &commit, sizeof(commit));
+        if (commit.commit == RECORD_COMMIT) {
+            index_set(header.key, header.len, offset);
+        }
+        offset += RECORD_SIZE(header.len);
+    }
+    store.tail = offset;
+}
+
+/** @brief Moves the latest copy of each record to the next page in the ring.
+ *
+ *  The next page only becomes valid once all the records are copied, so the
+ *  current page stays active if this is interrupted.
+ *
+ *  @return 0 on success, a negative value on a flash error.
+*/
+static int compact(void) {
+    uint32_t next = (store.page + 1) % FLASH_STORE_PAGES;
+    uint32_t old_address = PAGE_ADDRESS(store.page);
+    uint32_t offsets[FLASH_STORE_MAX_KEYS];
+    uint32_t data[FLASH_STORE_MAX_RECORD / sizeof(uint32_t)];
+    uint32_t offset = sizeof(page_header_t);
+    int ret;
+
+    last_stats.compacted = 1;
+    ret = flash_simple_erase_page(PAGE_ADDRESS(next));
+    if (ret != 0) {
+        return ret;
+    }
+
+    for (uint32_t i = 0; i < store.count; i++) {
+        index_entry_t *entry = &store.index[i];
+
+        flash_simple_read(old_address + entry->offset + sizeof(record_header_t),
+                          data, entry->len);
+        ret = program_record(next, offset, entry->key, data, entry->len);
+        if (ret != 0) {
+            return ret;
+        }
+        offsets[i] = offset;
+        offset += RECORD_SIZE(entry->len);
+    }
+
+    ret = write_page_header(next, store.generation + 1);
+    if (ret != 0) {
+        return ret;
+    }
+
+    store.page = next;
+    store.generation++;
+    store.tail = offset;
+    for (uint32_t i = 0; i < store.count; i++) {
+        store.index[i].offset = offsets[i];
+    }
+    return 0;
+}
+
+/** @brief Initializes the flash and loads the index of the store.
+ *
+ *  @return 0 on success, a negative value on a flash error.
+*/
+int flash_store_init(void) {
+    uint32_t generation;
+    int found = 0;
+    int ret = 0;
+
+    flash_simple_init();
+    op_begin();
+
+    for (uint32_t page = 0; page < FLASH_STORE_PAGES; page++) {
+        if (read_page_header(page, &generation) != 0) {
+            continue;
+        }
+        // Compare by difference, so the generation may wrap around
+        if (!found || (int32_t)(generation - store.generation) > 0) {
+            store.page = page;
+            store.generation = generation;
+            found = 1;
+        }
+    }
+
+    if (found) {
+        scan_page();
+    } else {
+        // First boot: format the first page of the ring
+        store.page = 0;
+        store.generation = 1;
+        store.tail = sizeof(page_header_t);
+        store.count = 0;
+        ret = flash_simple_erase_page(PAGE_ADDRESS(0));
+        if (ret == 0) {
+            ret = write_page_header(0, store.generation);
+        }
+    }
+
+    op_end("init", -1);
+    return ret;
+}
+
+/** @brief Reads the latest committed copy of a record.
+ *
+ *  @return The length of the record, or -1 if there is no record with this key.
+*/
+int flash_store_read(uint16_t key, void *buf, uint16_t len) {
+    index_entry_t *entry = find_key(key);
+
+    if (entry == NULL) {
+        return -1;
+    }
+    if (len > entry->len) {
+        len = entry->len;
+    }
+    flash_simple_read(PAGE_ADDRESS(store.page) + entry->offset + sizeof(record_header_t),
+                      buf, len);
+    return entry->len;
+}
+
+/** @brief Writes a record, replacing any previous one with the same key.
+ *
+ *  @return 0 on success, -1 if the record does not fit or on a flash error.
+*/
+int flash_store_write(uint16_t key, const void *buf, uint16_t len) {
+    uint32_t offset;
+    int ret = 0;
+
+    if (len > FLASH_STORE_MAX_RECORD
+            || (find_key(key) == NULL && store.count == FLASH_STORE_MAX_KEYS)) {
+        return -1;
+    }
+
+    op_begin();
+    if (store.tail + RECORD_SIZE(len) > MXC_FLASH_PAGE_SIZE) {
+        ret = compact();
+    }
+    if (ret == 0 && store.tail + RECORD_SIZE(len) > MXC_FLASH_PAGE_SIZE) {
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        offset = store.tail;
+        // The space is used even if programming fails part way
+        store.tail += RECORD_SIZE(len);
+        ret = program_record(store.page, offset, key, buf, len);
+        if (ret == 0) {
+            index_set(key, len, offset);
+        }
+    }
+
+    op_end("write", key);
+    return ret == 0 ? 0 : -1;
+}
+
+/** @brief Returns the flash operations done by the last flash_store call.
+*/
+void flash_store_get_stats(flash_store_stats_t *stats) {
+    *stats = last_stats;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file "flash_store.h"
+ * @brief Log-structured record store in flash
+ * @date 2025
+ *
+ * Keeps small records, each identified by a key, in a ring of
+ * FLASH_STORE_PAGES flash pages. Updating a record appends a new copy to the
+ * active page instead of erasing it, and the copy only counts once the commit
+ * marker after it has been programmed. When the active page is full, the
+ * latest copy of each record is moved to the next page in the ring, and that
+ * page becomes active once its header is programmed. A reset at any point
+ * therefore leaves either the old or the new value of a record.
+ *
+ * This source file is part of an example system for MITRE's 2025 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2025 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ *
+ * @copyright Copyright (c) 2025 The MITRE Corporation
+ */
+
+#ifndef __FLASH_STORE__
+#define __FLASH_STORE__
+
+#include <stdint.h>
+
+/******************************** MACRO DEFINITIONS ********************************/
+// Number of pages in the ring; at least two, so there is a page to compact into
+#ifndef FLASH_STORE_PAGES
+#define FLASH_STORE_PAGES 2
+#endif
+
+// The ring ends just below the last page of flash, which the ROM bootloader uses
+#ifndef FLASH_STORE_BASE
+#define FLASH_STORE_BASE (MXC_FLASH_MEM_BASE + MXC_FLASH_MEM_SIZE - \
+                          (FLASH_STORE_PAGES + 1) * MXC_FLASH_PAGE_SIZE)
+#endif
+
+// The status page that decoders kept all of their subscriptions in before this
+// store. It is the last page of the default ring, so it is only erased when the
+// store first compacts into it; the decoders carry its subscriptions over to
+// the store at boot until then.
+#define FLASH_STORE_LEGACY_PAGE (MXC_FLASH_MEM_BASE + MXC_FLASH_MEM_SIZE - 2 * MXC_FLASH_PAGE_SIZE)
+
+// Number of distinct keys the store can hold
+#ifndef FLASH_STORE_MAX_KEYS
+#define FLASH_STORE_MAX_KEYS 16
+#endif
+
+// Largest record, in bytes
+#define FLASH_STORE_MAX_RECORD 256
+
+/******************************** TYPE DEFINITIONS ********************************/
+/**
+ * @brief Flash operations done by the last flash_store call
+*/
+typedef struct {
+    uint32_t erases;        // Pages erased
+    uint32_t programs;      // Program operations
+    uint32_t program_bytes; // Bytes programmed
+    uint8_t compacted;      // 1 if the records were moved to the next page
+} flash_store_stats_t;
+
+/******************************** FUNCTION PROTOTYPES ******************************/
+/** @brief Initializes the flash and loads the index of the store.
+ *
+ *  Finds the active page (formatting the first page of the ring if there is
+ *  none) and indexes the latest committed copy of each record in it.
+ *
+ *  @return 0 on success, a negative value on a flash error.
+*/
+int flash_store_init(void);
+
+/** @brief Reads the latest committed copy of a record.
+ *
+ *  @param key The record's key.
+ *  @param buf Buffer to read the record into.
+ *  @param len The size of buf. A longer record is truncated to len bytes.
+ *
+ *  @return The length of the record, or -1 if there is no record with this key.
+*/
+int flash_store_read(uint16_t key, void *buf, uint16_t len);
+
+/** @brief Writes a record, replacing any previous one with the same key.
+ *
+ *  @param key The record's key.
+ *  @param buf The record.
+ *  @param len The length of the record, at most FLASH_STORE_MAX_RECORD.
+ *
+ *  @return 0 on success, -1 if the record does not fit or on a flash error.
+*/
+int flash_store_write(uint16_t key, const void *buf, uint16_t len);
+
+/** @brief Returns the flash operations done by the last flash_store call.
+ *
+ *  @param stats Filled with the erase and program counts of the last
+ *      flash_store_init or flash_store_write.
+*/
+void flash_store_get_stats(flash_store_stats_t *stats);
+
+#endif // __FLASH_STORE__
@@ -19,7 +19,8 @@
 #include "icc.h"
 #include "nvic_table.h"
 
-#include <stdio.h>
+// Erase and program operations since boot
+static flash_simple_stats_t flash_stats;
 
 /**
  * @brief ISR for the Flash Controller
@@ -44,14 +45,16 @@ void flash_simple_irq(void) {
  * @brief Initialize the Simple Flash Interface
  * 
  * This function registers the interrupt for the flash system,
- * enables the interrupt, and disables ICC
+ * enables the interrupt, and enables ICC. The ICC is only disabled
+ * while a page is erased or programmed (see flash_simple_erase_page
+ * and flash_simple_write).
 */
 void flash_simple_init(void) {
     // Setup Flash
     MXC_NVIC_SetVector(FLC0_IRQn, flash_simple_irq);
     NVIC_EnableIRQ(FLC0_IRQn);
     MXC_FLC_EnableInt(MXC_F_FLC_INTR_DONEIE | MXC_F_FLC_INTR_AFIE);
-    MXC_ICC_Disable(MXC_ICC0);
+    MXC_ICC_Enable(MXC_ICC0);
 }
 
 /**
@@ -65,9 +68,17 @@ void flash_simple_init(void) {
  * Flash memory can only be erased in a large block size called a page.
  * Once erased, memory can only be written one way e.g. 1->0.
  * In order to be re-written the entire page must be erased.
+ * The ICC is disabled for the duration of the erase.
 */
 int flash_simple_erase_page(uint32_t address) {
-    return MXC_FLC_PageErase(address);
+    int ret;
+
+    MXC_ICC_Disable(MXC_ICC0);
+    ret = MXC_FLC_PageErase(address);
+    // Enabling the ICC invalidates it, so no stale lines of the page survive
+    MXC_ICC_Enable(MXC_ICC0);
+    flash_stats.erases++;
+    return ret;
 }
 
 /**
@@ -97,7 +108,25 @@ void flash_simple_read(uint32_t address, void* buffer, uint32_t size) {
  * with the specified amount of bytes. Flash memory can only be written in one
  * way e.g. 1->0. To rewrite previously written memory see the 
  * flash_simple_erase_page documentation.
+ * The ICC is disabled for the duration of the write.
 */
 int flash_simple_write(uint32_t address, void* buffer, uint32_t size) {
-    return MXC_FLC_Write(address, size, (uint32_t *)buffer);
+    int ret;
+
+    MXC_ICC_Disable(MXC_ICC0);
+    ret = MXC_FLC_Write(address, size, (uint32_t *)buffer);
+    MXC_ICC_Enable(MXC_ICC0);
+    flash_stats.programs++;
+    flash_stats.program_bytes += size;
+    return ret;
+}
+
+/**
+ * @brief Flash Simple Stats
+ * 
+ * @param stats: flash_simple_stats_t*, filled with the number of erase
+ *  and program operations since boot
+*/
+void flash_simple_get_stats(flash_simple_stats_t *stats) {
+    *stats = flash_stats;
 }
@@ -16,11 +16,22 @@
 
 #include <stdint.h>
 
+/**
+ * @brief Counts of the flash operations done through this interface
+*/
+typedef struct {
+    uint32_t erases;        // Pages erased
+    uint32_t programs;      // Calls to flash_simple_write
+    uint32_t program_bytes; // Bytes passed to flash_simple_write
+} flash_simple_stats_t;
+
 /**
  * @brief Initialize the Simple Flash Interface
  * 
  * This function registers the interrupt for the flash system,
- * enables the interrupt, and disables ICC
+ * enables the interrupt, and enables ICC. The ICC is only disabled
+ * while a page is erased or programmed (see flash_simple_erase_page
+ * and flash_simple_write).
 */
 void flash_simple_init(void);
 /**
@@ -34,6 +45,7 @@ void flash_simple_init(void);
  * Flash memory can only be erased in a large block size called a page.
  * Once erased, memory can only be written one way e.g. 1->0.
  * In order to be re-written the entire page must be erased.
+ * The ICC is disabled for the duration of the erase.
 */
 int flash_simple_erase_page(uint32_t address);
 /**
@@ -60,7 +72,15 @@ void flash_simple_read(uint32_t address, void* buffer, uint32_t size);
  * with the specified amount of bytes. Flash memory can only be written in one
  * way e.g. 1->0. To rewrite previously written memory see the 
  * flash_simple_erase_page documentation.
+ * The ICC is disabled for the duration of the write.
 */
 int flash_simple_write(uint32_t address, void* buffer, uint32_t size);
+/**
+ * @brief Flash Simple Stats
+ * 
+ * @param stats: flash_simple_stats_t*, filled with the number of erase
+ *  and program operations since boot
+*/
+void flash_simple_get_stats(flash_simple_stats_t *stats);
 
 #endif
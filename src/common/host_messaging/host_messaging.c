@@ -0,0 +1,336 @@
+/**
+ * @file host_messaging.c
+ * @author Samuel Meyers
+ * @brief eCTF Host Messaging Implementation
+ * @date 2025
+ *
+ * This source file is part of an example system for MITRE's 2025 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2025 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ *
+ * @copyright Copyright (c) 2025 The MITRE Corporation
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "mxc_device.h"
+#include "host_messaging.h"
+
+// Size of the scratch buffer used to discard the body of a packet
+#define DISCARD_CHUNK_SIZE 32
+
+static host_messaging_stats_t stats;
+
+static const char hex_digits[16] = {
+    '0', '1', '2', '3', '4', '5', '6', '7',
+    '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+};
+
+
+/** @brief Read the DWT cycle counter, enabling it on first use.
+ *
+ *  @return The current cycle count.
+*/
+static uint32_t cycle_count(void) {
+    if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    return DWT->CYCCNT;
+}
+
+/** @brief Record a completed message in one direction's counters.
+ *
+ *  @param counters The counters to update.
+ *  @param bytes The size of the message on the wire, including the header.
+ *  @param start The cycle count at which the message started.
+*/
+static void count_message(msg_counters_t *counters, uint32_t bytes, uint32_t start) {
+    counters->last_bytes = bytes;
+    counters->last_cycles = cycle_count() - start;
+    counters->messages++;
+    counters->bytes += bytes;
+    counters->cycles += counters->last_cycles;
+}
+
+/** @brief Read len bytes from UART, acknowledging after every 256 bytes.
+ *
+ *  @param buf Pointer to a buffer where the incoming bytes should be stored.
+ *             If null, the bytes are read and discarded.
+ *  @param len The number of bytes to be read.
+ *  @param hooks If not null, hooks->data is called as the bytes arrive in buf.
+ *
+ *  @return 0 on success. A negative value on error.
+*/
+int read_bytes(void *buf, uint16_t len, const msg_rx_hooks_t *hooks) {
+    uint8_t discard[DISCARD_CHUNK_SIZE];
+    uint16_t i;
+    uint16_t n;
+    int result;
+
+    for (i = 0; i < len; i += n) {
+        if (i % MSG_BLOCK_SIZE == 0 && i != 0) { // Send an ACK after receiving 256 bytes
+            write_ack();
+        }
+        // Never read past the current block: the host waits for its ACK first
+        n = MSG_BLOCK_SIZE - i % MSG_BLOCK_SIZE;
+        if (n > len - i) {
+            n = len - i;
+        }
+        if (hooks != NULL && hooks->chunk_size != 0 && n > hooks->chunk_size) {
+            n = hooks->chunk_size;
+        }
+        if (buf == NULL) {
+            if (n > sizeof(discard)) {
+                n = sizeof(discard);
+            }
+            result = uart_read(discard, n);
+        } else {
+            result = uart_read((uint8_t *)buf + i, n);
+        }
+        if (result < 0) {  // if there was an error, return immediately
+            return result;
+        }
+        if (buf != NULL && hooks != NULL && hooks->data != NULL) {
+            hooks->data(hooks->ctx, buf, i + n);
+        }
+    }
+
+    return 0;
+}
+
+/** @brief Read a msg header from UART.
+ *
+ *  @param hdr Pointer to a buffer where the incoming bytes should be stored.
+*/
+void read_header(msg_header_t *hdr) {
+    hdr->magic = uart_readbyte();
+    // Any bytes until '%' will be read, but ignored.
+    // Once we receive a '%', continue with processing the rest of the message.
+    while (hdr->magic != MSG_MAGIC) {
+        hdr->magic = uart_readbyte();
+    }
+    hdr->cmd = uart_readbyte();
+    uart_read((uint8_t *)&hdr->len, sizeof(hdr->len));
+}
+
+/** @brief Receive an ACK from UART.
+ *
+ *  @return 0 on success. A negative value on error.
+*/
+int read_ack(void) {
+    msg_header_t ack_buf = {0};
+
+    read_header(&ack_buf);
+    if (ack_buf.cmd == ACK_MSG) {
+        return 0;
+    } else {
+        return -1;
+    }
+}
+
+/** @brief Write len bytes to console, one 256 byte block at a time.
+ *
+ *  @param buf Pointer to a buffer that stores the outgoing bytes.
+ *  @param len The number of bytes to write.
+ *  @param should_ack True if the decoder should expect an ACK. This should be false for
+ *                    debug and ACK messages.
+ *
+ *  @return 0 on success. A negative value on error.
+*/
+int write_bytes(const void *buf, uint16_t len, bool should_ack) {
+    uint16_t i;
+    uint16_t n;
+
+    for (i = 0; i < len; i += n) {
+        if (i != 0) {  // Expect an ACK after sending every 256 bytes
+            if (should_ack && read_ack() < 0) {
+                return -1;
+            }
+        }
+        n = len - i < MSG_BLOCK_SIZE ? len - i : MSG_BLOCK_SIZE;
+        if (uart_write((const uint8_t *)buf + i, n) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/** @brief Write len bytes to UART in hex. 2 bytes will be printed for every byte.
+ *
+ *  Each 256 character block is encoded into a local buffer and written in one burst.
+ *
+ *  @param type Message type.
+ *  @param buf Pointer to the bytes that will be printed.
+ *  @param len The number of bytes to print.
+ *
+ *  @return 0 on success. A negative value on error.
+*/
+int write_hex(msg_type_t type, const void *buf, size_t len) {
+    char block[MSG_BLOCK_SIZE];
+    msg_header_t hdr;
+    uint32_t start = cycle_count();
+    size_t i;
+    size_t j;
+    uint8_t byte;
+
+    hdr.magic = MSG_MAGIC;
+    hdr.cmd = type;
+    hdr.len = len*2;
+
+    write_bytes(&hdr, MSG_HEADER_SIZE, false /* should_ack */);
+    if (type != DEBUG_MSG && read_ack() < 0) {
+        // If the header was not ack'd, don't send the message
+        return -1;
+    }
+
+    for (i = 0; i < len; i += MSG_BLOCK_SIZE / 2) {
+        if (i != 0 && type != DEBUG_MSG && read_ack() < 0) {
+            // If the block was not ack'd, don't send the rest of the message
+            return -1;
+        }
+        for (j = 0; j < MSG_BLOCK_SIZE / 2 && i + j < len; j++) {
+            byte = ((const uint8_t *)buf)[i + j];
+            block[2*j] = hex_digits[byte >> 4];
+            block[2*j + 1] = hex_digits[byte & 0xf];
+        }
+        if (uart_write((const uint8_t *)block, 2*j) < 0) {
+            return -1;
+        }
+    }
+    // The final block is ACK'd like in write_packet
+    if (len > 0 && type != DEBUG_MSG && read_ack() < 0) {
+        return -1;
+    }
+
+    count_message(&stats.tx, MSG_HEADER_SIZE + hdr.len, start);
+    return 0;
+}
+
+/** @brief Send a message to the host, expecting an ack after every 256 bytes.
+ *
+ *  @param type The type of message to send.
+ *  @param buf Pointer to a buffer containing the outgoing packet.
+ *  @param len The size of the outgoing packet in bytes.
+ *
+ *  @return 0 on success. A negative value on failure.
+*/
+int write_packet(msg_type_t type, const void *buf, uint16_t len) {
+    msg_header_t hdr;
+    uint32_t start = cycle_count();
+    int result;
+
+    hdr.magic = MSG_MAGIC;
+    hdr.cmd = type;
+    hdr.len = len;
+
+    result = write_bytes(&hdr, MSG_HEADER_SIZE, false);
+    if (type == ACK_MSG) {
+        return result;
+    }
+
+    // If the header was not ack'd, don't send the message
+    if (type != DEBUG_MSG && read_ack() < 0) {
+        return -1;
+    }
+    // If there is data to write, write it
+    if (len > 0) {
+        result = write_bytes(buf, len, type != DEBUG_MSG);
+        // If we still need to ACK the last block (write_bytes does not handle the final ACK)
+        if (type != DEBUG_MSG && read_ack() < 0) {
+            return -1;
+        }
+    }
+
+    count_message(&stats.tx, MSG_HEADER_SIZE + len, start);
+    return 0;
+}
+
+/** @brief Reads a packet from console UART.
+ *
+ *  A packet that does not fit in buf is still received and acknowledged, so the
+ *  link stays in sync, but its body is discarded and -1 is returned.
+ *
+ *  @param cmd A pointer to the resulting opcode of the packet. Must not be null.
+ *  @param buf A pointer to a buffer to store the incoming packet. Can be null.
+ *  @param buf_len The size of buf in bytes.
+ *  @param len A pointer to the resulting length of the packet. Can be null.
+ *
+ *  @return 0 on success, a negative number on failure
+*/
+int read_packet(msg_type_t* cmd, void *buf, uint16_t buf_len, uint16_t *len) {
+    return read_packet_streamed(cmd, buf, buf_len, len, NULL);
+}
+
+/** @brief Reads a packet from console UART, passing the body to hooks as it arrives.
+ *
+ *  @param cmd A pointer to the resulting opcode of the packet. Must not be null.
+ *  @param buf A pointer to a buffer to store the incoming packet. Can be null.
+ *  @param buf_len The size of buf in bytes.
+ *  @param len A pointer to the resulting length of the packet. Can be null.
+ *  @param hooks The callbacks to run during the receive. Can be null.
+ *
+ *  @return 0 on success, a negative number on failure
+*/
+int read_packet_streamed(msg_type_t* cmd, void *buf, uint16_t buf_len, uint16_t *len, const msg_rx_hooks_t *hooks) {
+    msg_header_t header = {0};
+    uint32_t start;
+    int result = 0;
+
+    // cmd must be a valid pointer
+    if (cmd == NULL) {
+        return -1;
+    }
+
+    read_header(&header);
+    start = cycle_count();
+
+    *cmd = header.cmd;
+
+    if (len != NULL) {
+        *len = header.len;
+    }
+
+    if (header.cmd == ACK_MSG) {
+        return 0;
+    }
+
+    if (hooks != NULL && hooks->start != NULL) {
+        hooks->start(hooks->ctx, header.cmd, header.len);
+    }
+
+    write_ack();  // ACK the header
+    if (header.len) {
+        if (buf != NULL && header.len > buf_len) {
+            // Too big: drain it so the next header is read from the right place
+            buf = NULL;
+            result = -1;
+        }
+        if (read_bytes(buf, header.len, hooks) < 0) {
+            return -1;
+        }
+        if (write_ack() < 0) { // ACK the final block (not handled by read_bytes)
+            return -1;
+        }
+    }
+
+    count_message(&stats.rx, MSG_HEADER_SIZE + header.len, start);
+    return result;
+}
+
+/** @brief Returns the byte and time counters of the host link.
+ *
+ *  @return Pointer to the counters, which are updated in place.
+*/
+const host_messaging_stats_t *host_messaging_get_stats(void) {
+    return &stats;
+}
+
+/** @brief Zeroes the byte and time counters of the host link.
+*/
+void host_messaging_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
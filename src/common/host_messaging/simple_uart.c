@@ -17,7 +17,6 @@
 #include <string.h>
 #include "uart.h"
 #include "nvic_table.h"
-#include "host_messaging.h"
 #include "board.h"
 #include "mxc_device.h"
 
@@ -58,14 +57,39 @@ int uart_readbyte(void){
     return data;
 }
 
+/** @brief Reads exactly len bytes from UART, taking everything that is already
+ *      in the RX FIFO on each pass instead of one character at a time.
+ * 
+ *  @param buf Pointer to a buffer where the incoming bytes should be stored.
+ *  @param len The number of bytes to read.
+ * 
+ *  @return 0 upon success.  Otherwise see MAX78000 Error Codes for
+ *      a list of return codes.
+*/
+int uart_read(uint8_t *buf, size_t len) {
+    mxc_uart_regs_t *uart = MXC_UART_GET_UART(CONSOLE_UART);
+    int n;
+
+    while (len > 0) {
+        // Returns the number of bytes that were waiting, possibly 0
+        n = MXC_UART_ReadRXFIFO(uart, buf, len);
+        if (n < 0) {
+            return n;
+        }
+        buf += n;
+        len -= n;
+    }
+
+    return E_NO_ERROR;
+}
+
 /** @brief Writes a byte to UART.
  * 
  *  @param data The byte to be written.
 */
 void uart_writebyte(uint8_t data) {
-    while (MXC_UART_GET_UART(CONSOLE_UART)->status & MXC_F_UART_STATUS_TX_FULL) {
-    }
-    MXC_UART_GET_UART(CONSOLE_UART)->fifo = data;
+    // Blocks while the TX FIFO is full
+    MXC_UART_WriteCharacter(MXC_UART_GET_UART(CONSOLE_UART), data);
 }
 
 /** @brief Flushes UART.
@@ -73,4 +97,30 @@ void uart_writebyte(uint8_t data) {
 void uart_flush(void){
     MXC_UART_ClearRXFIFO(MXC_UART_GET_UART(CONSOLE_UART));
     MXC_UART_ClearTXFIFO(MXC_UART_GET_UART(CONSOLE_UART));
-}
\ No newline at end of file
+}
+
+/** @brief Writes len bytes to UART, filling the TX FIFO as far as it has room
+ *      on each pass instead of polling for every byte.
+ * 
+ *  @param buf Pointer to the bytes to be written.
+ *  @param len The number of bytes to write.
+ * 
+ *  @return 0 upon success.  Otherwise see MAX78000 Error Codes for
+ *      a list of return codes.
+*/
+int uart_write(const uint8_t *buf, size_t len) {
+    mxc_uart_regs_t *uart = MXC_UART_GET_UART(CONSOLE_UART);
+    int n;
+
+    while (len > 0) {
+        // Returns the number of bytes that fit, possibly 0
+        n = MXC_UART_WriteTXFIFO(uart, buf, len);
+        if (n < 0) {
+            return n;
+        }
+        buf += n;
+        len -= n;
+    }
+
+    return E_NO_ERROR;
+}
@@ -16,11 +16,11 @@
 #define __SIMPLE_UART__
 
 #include <stdio.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 #include "uart.h"
 #include "nvic_table.h"
-#include "host_messaging.h"
 
 /******************************** MACRO DEFINITIONS ********************************/
 #define UART_BAUD 115200
@@ -47,12 +47,34 @@ int uart_readbyte_raw(void);
 */
 int uart_readbyte(void);
 
+/** @brief Reads exactly len bytes from UART, taking everything that is already
+ *      in the RX FIFO on each pass instead of one character at a time.
+ *
+ *  @param buf Pointer to a buffer where the incoming bytes should be stored.
+ *  @param len The number of bytes to read.
+ *
+ *  @return 0 upon success.  Otherwise see MAX78000 Error Codes for
+ *      a list of return codes.
+*/
+int uart_read(uint8_t *buf, size_t len);
+
 /** @brief Writes a byte to UART.
  * 
  *  @param data The byte to be written.
 */
 void uart_writebyte(uint8_t data);
 
+/** @brief Writes len bytes to UART, filling the TX FIFO as far as it has room
+ *      on each pass instead of polling for every byte.
+ *
+ *  @param buf Pointer to the bytes to be written.
+ *  @param len The number of bytes to write.
+ *
+ *  @return 0 upon success.  Otherwise see MAX78000 Error Codes for
+ *      a list of return codes.
+*/
+int uart_write(const uint8_t *buf, size_t len);
+
 /** @brief Flushes UART.
 */
 void uart_flush(void);
@@ -0,0 +1,116 @@
+/**
+ * @file board.c
+ * @brief MSDK shim: core, interrupt, cache, LED and delay functions
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "board.h"
+#include "icc.h"
+#include "led.h"
+#include "mxc_delay.h"
+#include "nvic_table.h"
+
+#define LED_COUNT 3
+
+// The MAX78000 runs from the 100 MHz internal oscillator
+uint32_t SystemCoreClock = 100000000;
+
+mxc_icc_regs_t msdk_shim_icc0;
+CoreDebug_Type msdk_shim_core_debug;
+
+static DWT_Type dwt;
+static int led_state[LED_COUNT];
+
+int Board_Init(void) {
+    return E_NO_ERROR;
+}
+
+/******************************** CORE *********************************************/
+void NVIC_EnableIRQ(IRQn_Type irqn) {
+    (void)irqn;
+}
+
+void NVIC_DisableIRQ(IRQn_Type irqn) {
+    (void)irqn;
+}
+
+void MXC_NVIC_SetVector(IRQn_Type irqn, void (*irq_callback)(void)) {
+    (void)irqn;
+    (void)irq_callback;
+}
+
+DWT_Type *msdk_shim_dwt(void) {
+    struct timespec now;
+    uint64_t ns;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ns = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+    dwt.CYCCNT = (uint32_t)(ns * (SystemCoreClock / 1000000) / 1000);
+    return &dwt;
+}
+
+int MXC_Delay(uint32_t us) {
+    struct timespec delay = {
+        .tv_sec = us / 1000000,
+        .tv_nsec = (us % 1000000) * 1000L,
+    };
+
+    while (nanosleep(&delay, &delay) != 0) {
+    }
+    return E_NO_ERROR;
+}
+
+/******************************** CACHE ********************************************/
+void MXC_ICC_Enable(mxc_icc_regs_t *icc) {
+    icc->ctrl |= 1;
+}
+
+void MXC_ICC_Disable(mxc_icc_regs_t *icc) {
+    icc->ctrl &= ~1UL;
+}
+
+void MXC_ICC_Flush(mxc_icc_regs_t *icc) {
+    icc->invalidate = 1;
+}
+
+/******************************** LEDS *********************************************/
+/** @brief Prints the LED color if MSDK_SHIM_LED_LOG=1.
+*/
+static void log_leds(void) {
+    static const char *colors[] = {
+        "off", "red", "green", "yellow", "blue", "purple", "cyan", "white",
+    };
+    const char *log = getenv("MSDK_SHIM_LED_LOG");
+
+    if (log != NULL && log[0] == '1') {
+        fprintf(stderr, "msdk_shim: LED %s\n",
+                colors[led_state[0] | led_state[1] << 1 | led_state[2] << 2]);
+    }
+}
+
+int LED_Init(void) {
+    return E_NO_ERROR;
+}
+
+void LED_On(unsigned int idx) {
+    if (idx < LED_COUNT && !led_state[idx]) {
+        led_state[idx] = 1;
+        log_leds();
+    }
+}
+
+void LED_Off(unsigned int idx) {
+    if (idx < LED_COUNT && led_state[idx]) {
+        led_state[idx] = 0;
+        log_leds();
+    }
+}
+
+void LED_Toggle(unsigned int idx) {
+    if (idx < LED_COUNT) {
+        led_state[idx] ? LED_Off(idx) : LED_On(idx);
+    }
+}
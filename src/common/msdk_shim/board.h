@@ -0,0 +1,21 @@
+/**
+ * @file board.h
+ * @brief MSDK shim: MAX78000 FTHR board definitions
+ */
+
+#ifndef __BOARD_H__
+#define __BOARD_H__
+
+#include "mxc_device.h"
+#include "led.h"
+
+#define CONSOLE_UART 0
+#define CONSOLE_BAUD 115200
+
+/** @brief Initializes the board.
+ *
+ *  @return E_NO_ERROR.
+*/
+int Board_Init(void);
+
+#endif // __BOARD_H__
@@ -0,0 +1,146 @@
+/**
+ * @file flc.c
+ * @brief MSDK shim: flash controller, backed by a file
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "flc.h"
+
+mxc_flc_regs_t msdk_shim_flc0;
+
+static uint8_t *flash;
+
+/** @brief Returns the flash contents, mapping MSDK_SHIM_FLASH on first use.
+ *
+ *  @return Pointer to MXC_FLASH_MEM_SIZE bytes.
+*/
+static uint8_t *flash_image(void) {
+    static uint8_t erased[MXC_FLASH_PAGE_SIZE];
+    const char *path;
+    struct stat st;
+    off_t offset;
+    int fd;
+
+    if (flash != NULL) {
+        return flash;
+    }
+
+    path = getenv("MSDK_SHIM_FLASH");
+    if (path == NULL) {
+        flash = malloc(MXC_FLASH_MEM_SIZE);
+        if (flash == NULL) {
+            perror("msdk_shim: cannot allocate flash");
+            exit(1);
+        }
+        memset(flash, 0xFF, MXC_FLASH_MEM_SIZE);
+        return flash;
+    }
+
+    fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror("msdk_shim: cannot open MSDK_SHIM_FLASH");
+        exit(1);
+    }
+    // A new (or short) image is extended with erased pages
+    memset(erased, 0xFF, sizeof(erased));
+    for (offset = st.st_size - st.st_size % MXC_FLASH_PAGE_SIZE;
+            offset < (off_t)MXC_FLASH_MEM_SIZE; offset += MXC_FLASH_PAGE_SIZE) {
+        if (offset < st.st_size) {
+            continue;  // Keep the programmed part of a partial page
+        }
+        if (pwrite(fd, erased, sizeof(erased), offset) != sizeof(erased)) {
+            perror("msdk_shim: cannot extend MSDK_SHIM_FLASH");
+            exit(1);
+        }
+    }
+    flash = mmap(NULL, MXC_FLASH_MEM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (flash == MAP_FAILED) {
+        perror("msdk_shim: cannot map MSDK_SHIM_FLASH");
+        exit(1);
+    }
+    return flash;
+}
+
+/** @brief Checks that a range lies within flash.
+ *
+ *  @param address The start of the range.
+ *  @param len The length of the range in bytes.
+ *
+ *  @return 1 if it does, 0 if not.
+*/
+static int in_flash(uint32_t address, uint32_t len) {
+    return address >= MXC_FLASH_MEM_BASE && len <= MXC_FLASH_MEM_SIZE
+        && address - MXC_FLASH_MEM_BASE <= MXC_FLASH_MEM_SIZE - len;
+}
+
+int MXC_FLC_Init(void) {
+    flash_image();
+    return E_NO_ERROR;
+}
+
+int MXC_FLC_PageErase(uint32_t address) {
+    uint32_t page;
+
+    if (!in_flash(address, 1)) {
+        return E_BAD_PARAM;
+    }
+    page = (address - MXC_FLASH_MEM_BASE) & ~(MXC_FLASH_PAGE_SIZE - 1);
+    memset(flash_image() + page, 0xFF, MXC_FLASH_PAGE_SIZE);
+    return E_NO_ERROR;
+}
+
+void MXC_FLC_Read(int address, void *buffer, int len) {
+    if (len < 0 || !in_flash(address, len)) {
+        // The real part would fault on the bus access
+        fprintf(stderr, "msdk_shim: flash read out of range: 0x%08x+%d\n", address, len);
+        abort();
+    }
+    memcpy(buffer, flash_image() + (address - MXC_FLASH_MEM_BASE), len);
+}
+
+int MXC_FLC_Write(uint32_t address, uint32_t length, uint32_t *buffer) {
+    const uint8_t *src = (const uint8_t *)buffer;
+    uint8_t *dst;
+    uint32_t i;
+
+    if (!in_flash(address, length)) {
+        return E_BAD_PARAM;
+    }
+    // Programming can only clear bits
+    dst = flash_image() + (address - MXC_FLASH_MEM_BASE);
+    for (i = 0; i < length; i++) {
+        dst[i] &= src[i];
+    }
+    return E_NO_ERROR;
+}
+
+int MXC_FLC_Write32(uint32_t address, uint32_t data) {
+    return MXC_FLC_Write(address, sizeof(data), &data);
+}
+
+int MXC_FLC_EnableInt(uint32_t flags) {
+    MXC_FLC0->intr |= flags;
+    return E_NO_ERROR;
+}
+
+int MXC_FLC_DisableInt(uint32_t flags) {
+    MXC_FLC0->intr &= ~flags;
+    return E_NO_ERROR;
+}
+
+int MXC_FLC_GetFlags(void) {
+    return MXC_FLC0->intr & (MXC_F_FLC_INTR_DONE | MXC_F_FLC_INTR_AF);
+}
+
+int MXC_FLC_ClearFlags(uint32_t flags) {
+    MXC_FLC0->intr &= ~flags;
+    return E_NO_ERROR;
+}
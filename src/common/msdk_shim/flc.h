@@ -0,0 +1,27 @@
+/**
+ * @file flc.h
+ * @brief MSDK shim: flash controller, backed by a file
+ *
+ * Flash is MXC_FLASH_MEM_SIZE bytes at MXC_FLASH_MEM_BASE. It is kept in the
+ * file named by MSDK_SHIM_FLASH (created fully erased if it does not exist),
+ * or only in memory if that variable is not set. Like the real part, erasing
+ * sets a page to 0xFF and programming can only clear bits.
+ */
+
+#ifndef __FLC_H__
+#define __FLC_H__
+
+#include <stdint.h>
+#include "mxc_device.h"
+
+int MXC_FLC_Init(void);
+int MXC_FLC_PageErase(uint32_t address);
+void MXC_FLC_Read(int address, void *buffer, int len);
+int MXC_FLC_Write(uint32_t address, uint32_t length, uint32_t *buffer);
+int MXC_FLC_Write32(uint32_t address, uint32_t data);
+int MXC_FLC_EnableInt(uint32_t flags);
+int MXC_FLC_DisableInt(uint32_t flags);
+int MXC_FLC_GetFlags(void);
+int MXC_FLC_ClearFlags(uint32_t flags);
+
+#endif // __FLC_H__
@@ -0,0 +1,114 @@
+# Linux build of a C decoder (insecure, design1, design2) against the MSDK shim
+# in this directory. The decoder's sources in src/ and the shared host
+# messaging and flash store libraries are compiled as-is; the MSDK headers and drivers they use
+# are replaced by the ones here:
+#
+#   uart.c  - console UART on a pseudo-terminal
+#   flc.c   - flash kept in a file
+#   trng.c  - getrandom(2)
+#   board.c - LEDs, ICC, NVIC, delays and the DWT cycle counter
+#
+# Each design includes this file from the host.mk next to its Makefile:
+#   cd src/design2/decoder
+#   make -f host.mk DECODER_ID=0xdeadbeef WOLFSSL_ROOT=/path/to/wolfssl
+#   MSDK_SHIM_UART=/tmp/design2.pty MSDK_SHIM_FLASH=/tmp/design2.flash build/host/decoder
+#   python3 -m ectf25.utils.stress_test --port /tmp/design2.pty ... decode
+#
+# Configuration variables:
+# - DECODER_ID : Decoder ID, as for the firmware build
+# - WOLFSSL_ROOT : wolfSSL source tree (default: wolfssl/, like the firmware)
+# - CRYPTO_EXAMPLE : Set to 1 to build wolfSSL (set by project.mk or host.mk)
+# - HOST_CPPFLAGS : Extra preprocessor flags of the design
+# - HOST_PREREQS : Generated headers the decoder sources need
+#
+# Runtime environment variables:
+# - MSDK_SHIM_UART : Path of a symlink to create to the UART's pty
+# - MSDK_SHIM_FLASH : File to keep flash in, so it persists across runs
+# - MSDK_SHIM_LED_LOG : Set to 1 to print LED changes to stderr
+#
+# The flash store prints the erase and program counts of each operation to
+# stderr (FLASH_STORE_TRACE).
+
+SHIM_DIR := $(patsubst %/,%,$(dir $(lastword $(MAKEFILE_LIST))))
+COMMON_DIR ?= $(SHIM_DIR)/..
+
+DECODER_ID ?= 0xdeadbeef
+WOLFSSL_ROOT ?= wolfssl
+BUILD_DIR ?= build/host
+
+# The design's own configuration: IPATH, PROJ_CFLAGS, CRYPTO_EXAMPLE and the
+# rules for generated headers
+include project.mk
+
+# Same defines as the firmware build (taken from project.mk and the Makefile,
+# whose wolfSSL configuration only applies with CRYPTO_EXAMPLE=1), minus the
+# ones that only make sense on the MAX78000.
+DESIGN_CFLAGS := $(PROJ_CFLAGS)
+ifeq ($(CRYPTO_EXAMPLE),1)
+DESIGN_CFLAGS += $(shell sed -n 's/^PROJ_CFLAGS *+= *//p' Makefile)
+endif
+DESIGN_CFLAGS := $(filter -D%,$(DESIGN_CFLAGS))
+DESIGN_CFLAGS := $(filter-out -DDECODER_ID=% -DPOST_BOOT=% -DMXC_% -DTIME_T_NOT_64BIT,$(DESIGN_CFLAGS))
+
+# The shim comes first so that it shadows the MSDK headers
+HOST_CPPFLAGS += -I$(SHIM_DIR) -I. $(addprefix -I,$(IPATH)) -DDECODER_ID=$(DECODER_ID)
+HOST_CPPFLAGS += $(DESIGN_CFLAGS) -DFLASH_STORE_TRACE
+ifeq ($(CRYPTO_EXAMPLE),1)
+HOST_CPPFLAGS += -I$(WOLFSSL_ROOT)
+endif
+CFLAGS := -O2 -g -Wall -ffunction-sections -fdata-sections
+LDFLAGS := -Wl,--gc-sections
+
+DECODER_SRCS := $(notdir $(wildcard src/*.c))
+MESSAGING_SRCS := $(notdir $(wildcard $(COMMON_DIR)/host_messaging/*.c))
+FLASH_STORE_SRCS := $(notdir $(wildcard $(COMMON_DIR)/flash_store/*.c))
+SHIM_SRCS := $(notdir $(wildcard $(SHIM_DIR)/*.c))
+ifeq ($(CRYPTO_EXAMPLE),1)
+WOLFCRYPT_SRCS := $(notdir $(wildcard $(WOLFSSL_ROOT)/wolfcrypt/src/*.c))
+endif
+
+DECODER_OBJS := $(addprefix $(BUILD_DIR)/src/,$(DECODER_SRCS:.c=.o))
+OBJS := $(DECODER_OBJS)
+OBJS += $(addprefix $(BUILD_DIR)/host_messaging/,$(MESSAGING_SRCS:.c=.o))
+OBJS += $(addprefix $(BUILD_DIR)/flash_store/,$(FLASH_STORE_SRCS:.c=.o))
+OBJS += $(addprefix $(BUILD_DIR)/msdk_shim/,$(SHIM_SRCS:.c=.o))
+OBJS += $(addprefix $(BUILD_DIR)/wolfcrypt/,$(WOLFCRYPT_SRCS:.c=.o))
+
+DECODER := $(BUILD_DIR)/decoder
+
+.PHONY: host host_clean
+.DEFAULT_GOAL := host
+
+host: $(DECODER)
+
+$(DECODER): $(OBJS)
+	$(CC) $(CFLAGS) -o $@ $^ $(LDFLAGS)
+
+$(DECODER_OBJS): | $(HOST_PREREQS)
+
+# Some design headers use uint8_t without including <stdint.h>, which the
+# firmware toolchain's headers happen to pull in
+$(BUILD_DIR)/src/%.o: src/%.c
+	@mkdir -p $(dir $@)
+	$(CC) $(HOST_CPPFLAGS) -include stdint.h $(CFLAGS) -MMD -c -o $@ $<
+
+$(BUILD_DIR)/host_messaging/%.o: $(COMMON_DIR)/host_messaging/%.c
+	@mkdir -p $(dir $@)
+	$(CC) $(HOST_CPPFLAGS) $(CFLAGS) -MMD -c -o $@ $<
+
+$(BUILD_DIR)/flash_store/%.o: $(COMMON_DIR)/flash_store/%.c
+	@mkdir -p $(dir $@)
+	$(CC) $(HOST_CPPFLAGS) $(CFLAGS) -MMD -c -o $@ $<
+
+$(BUILD_DIR)/msdk_shim/%.o: $(SHIM_DIR)/%.c
+	@mkdir -p $(dir $@)
+	$(CC) $(HOST_CPPFLAGS) $(CFLAGS) -MMD -c -o $@ $<
+
+$(BUILD_DIR)/wolfcrypt/%.o: $(WOLFSSL_ROOT)/wolfcrypt/src/%.c
+	@mkdir -p $(dir $@)
+	$(CC) $(HOST_CPPFLAGS) $(CFLAGS) -c -o $@ $<
+
+host_clean:
+	rm -rf $(BUILD_DIR)
+
+-include $(OBJS:.o=.d)
@@ -0,0 +1,18 @@
+/**
+ * @file icc.h
+ * @brief MSDK shim: instruction cache controller
+ *
+ * There is no cache to keep coherent with flash on the host; the calls only
+ * record the state.
+ */
+
+#ifndef __ICC_H__
+#define __ICC_H__
+
+#include "mxc_device.h"
+
+void MXC_ICC_Enable(mxc_icc_regs_t *icc);
+void MXC_ICC_Disable(mxc_icc_regs_t *icc);
+void MXC_ICC_Flush(mxc_icc_regs_t *icc);
+
+#endif // __ICC_H__
@@ -0,0 +1,24 @@
+/**
+ * @file led.h
+ * @brief MSDK shim: board LEDs
+ *
+ * The LED state is only kept in memory. Set MSDK_SHIM_LED_LOG=1 to print
+ * every change to stderr.
+ */
+
+#ifndef __LED_H__
+#define __LED_H__
+
+#define LED1 0  // Red
+#define LED2 1  // Green
+#define LED3 2  // Blue
+
+#define LED_OFF 0
+#define LED_ON 1
+
+int LED_Init(void);
+void LED_On(unsigned int idx);
+void LED_Off(unsigned int idx);
+void LED_Toggle(unsigned int idx);
+
+#endif // __LED_H__
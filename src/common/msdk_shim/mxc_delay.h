@@ -0,0 +1,23 @@
+/**
+ * @file mxc_delay.h
+ * @brief MSDK shim: busy-wait delays, implemented with nanosleep
+ */
+
+#ifndef __MXC_DELAY_H__
+#define __MXC_DELAY_H__
+
+#include <stdint.h>
+
+#define MXC_DELAY_SEC(s) ((uint32_t)((s) * 1000000UL))
+#define MXC_DELAY_MSEC(ms) ((uint32_t)((ms) * 1000UL))
+#define MXC_DELAY_USEC(us) ((uint32_t)(us))
+
+/** @brief Blocks for the given number of microseconds.
+ *
+ *  @param us The delay, see MXC_DELAY_USEC and friends.
+ *
+ *  @return E_NO_ERROR.
+*/
+int MXC_Delay(uint32_t us);
+
+#endif // __MXC_DELAY_H__
@@ -0,0 +1,122 @@
+/**
+ * @file mxc_device.h
+ * @brief MSDK shim: MAX78000 memory map, registers and CMSIS core functions
+ *
+ * Only what the C decoders touch is provided. Register blocks are plain structs
+ * so that code poking at them compiles and runs, but writing them has no effect
+ * unless noted.
+ */
+
+#ifndef __MXC_DEVICE_H__
+#define __MXC_DEVICE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "mxc_errors.h"
+
+#define TARGET_NUM 78000
+
+/******************************** MEMORY MAP ***************************************/
+#define MXC_FLASH_MEM_BASE 0x10000000UL
+#define MXC_FLASH_PAGE_SIZE 0x00002000UL
+#define MXC_FLASH_MEM_SIZE 0x00080000UL
+
+extern uint32_t SystemCoreClock;
+
+/******************************** INTERRUPTS ***************************************/
+typedef enum {
+    UART0_IRQn = 30,
+    FLC0_IRQn = 39,
+} IRQn_Type;
+
+// There are no interrupts on the host: handlers are registered but never run
+void NVIC_EnableIRQ(IRQn_Type irqn);
+void NVIC_DisableIRQ(IRQn_Type irqn);
+#define __disable_irq() ((void)0)
+#define __enable_irq() ((void)0)
+
+/******************************** REGISTERS ****************************************/
+typedef struct {
+    volatile uint32_t addr;
+    volatile uint32_t clkdiv;
+    volatile uint32_t ctrl;
+    volatile uint32_t rsv0[6];
+    volatile uint32_t intr;
+    volatile uint32_t rsv1[2];
+    volatile uint32_t data[4];
+    volatile uint32_t actrl;
+} mxc_flc_regs_t;
+
+#define MXC_F_FLC_INTR_DONE (1UL << 0)
+#define MXC_F_FLC_INTR_AF (1UL << 1)
+#define MXC_F_FLC_INTR_DONEIE (1UL << 8)
+#define MXC_F_FLC_INTR_AFIE (1UL << 9)
+
+typedef struct {
+    volatile uint32_t info;
+    volatile uint32_t rsv0[63];
+    volatile uint32_t sz;
+    volatile uint32_t rsv1[191];
+    volatile uint32_t ctrl;
+    volatile uint32_t rsv2[255];
+    volatile uint32_t invalidate;
+} mxc_icc_regs_t;
+
+typedef struct {
+    volatile uint32_t ctrl;
+    volatile uint32_t status;
+    volatile uint32_t int_en;
+    volatile uint32_t int_fl;
+    volatile uint32_t clkdiv;
+    volatile uint32_t osr;
+    volatile uint32_t txpeek;
+    volatile uint32_t pnr;
+    volatile uint32_t fifo;
+    volatile uint32_t rsv0[3];
+    volatile uint32_t dma;
+    volatile uint32_t wken;
+    volatile uint32_t wkfl;
+} mxc_uart_regs_t;
+
+#define MXC_F_UART_STATUS_TX_FULL (1UL << 7)
+
+#define MXC_UART_INSTANCES 4
+
+extern mxc_flc_regs_t msdk_shim_flc0;
+extern mxc_icc_regs_t msdk_shim_icc0;
+extern mxc_uart_regs_t msdk_shim_uart[MXC_UART_INSTANCES];
+
+#define MXC_FLC0 (&msdk_shim_flc0)
+#define MXC_ICC0 (&msdk_shim_icc0)
+#define MXC_UART0 (&msdk_shim_uart[0])
+#define MXC_UART1 (&msdk_shim_uart[1])
+#define MXC_UART2 (&msdk_shim_uart[2])
+#define MXC_UART3 (&msdk_shim_uart[3])
+
+/******************************** CYCLE COUNTER ************************************/
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+#define DWT_CTRL_CYCCNTENA_Msk (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+
+/** @brief Returns the cycle counter registers, with CYCCNT derived from the
+ *      host's monotonic clock at SystemCoreClock.
+ *
+ *  @return Pointer to the registers. Writes to CYCCNT are ignored.
+*/
+DWT_Type *msdk_shim_dwt(void);
+
+extern CoreDebug_Type msdk_shim_core_debug;
+
+#define DWT (msdk_shim_dwt())
+#define CoreDebug (&msdk_shim_core_debug)
+
+#endif // __MXC_DEVICE_H__
@@ -0,0 +1,32 @@
+/**
+ * @file mxc_errors.h
+ * @brief MSDK shim: error codes returned by the peripheral drivers
+ *
+ * Same names and values as the MSDK, so decoder code comparing against them
+ * behaves identically on Linux.
+ */
+
+#ifndef __MXC_ERRORS_H__
+#define __MXC_ERRORS_H__
+
+#define E_NO_ERROR 0
+#define E_SUCCESS 0
+#define E_NULL_PTR -1
+#define E_NO_DEVICE -2
+#define E_BAD_PARAM -3
+#define E_INVALID -4
+#define E_UNINITIALIZED -5
+#define E_BUSY -6
+#define E_BAD_STATE -7
+#define E_UNKNOWN -8
+#define E_COMM_ERR -9
+#define E_TIME_OUT -10
+#define E_NO_RESPONSE -11
+#define E_OVERFLOW -12
+#define E_UNDERFLOW -13
+#define E_NONE_AVAIL -14
+#define E_SHUTDOWN -15
+#define E_ABORT -16
+#define E_NOT_SUPPORTED -17
+
+#endif // __MXC_ERRORS_H__
@@ -0,0 +1,18 @@
+/**
+ * @file nvic_table.h
+ * @brief MSDK shim: interrupt vector table
+ */
+
+#ifndef __NVIC_TABLE_H__
+#define __NVIC_TABLE_H__
+
+#include "mxc_device.h"
+
+/** @brief Registers an interrupt handler. Handlers are never called on the host.
+ *
+ *  @param irqn The interrupt.
+ *  @param irq_callback The handler.
+*/
+void MXC_NVIC_SetVector(IRQn_Type irqn, void (*irq_callback)(void));
+
+#endif // __NVIC_TABLE_H__
@@ -0,0 +1,22 @@
+/**
+ * @file tmr.h
+ * @brief MSDK shim: timers
+ *
+ * The decoders include this header but do not use the timers yet, so only the
+ * register type is provided.
+ */
+
+#ifndef __TMR_H__
+#define __TMR_H__
+
+#include "mxc_device.h"
+
+typedef struct {
+    volatile uint32_t cnt;
+    volatile uint32_t cmp;
+    volatile uint32_t pwm;
+    volatile uint32_t intfl;
+    volatile uint32_t ctrl0;
+} mxc_tmr_regs_t;
+
+#endif // __TMR_H__
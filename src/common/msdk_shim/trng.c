@@ -0,0 +1,40 @@
+/**
+ * @file trng.c
+ * @brief MSDK shim: true random number generator, backed by getrandom(2)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/random.h>
+
+#include "trng.h"
+
+int MXC_TRNG_Init(void) {
+    return E_NO_ERROR;
+}
+
+int MXC_TRNG_Shutdown(void) {
+    return E_NO_ERROR;
+}
+
+int MXC_TRNG_Random(uint8_t *data, uint32_t len) {
+    ssize_t n;
+
+    while (len > 0) {
+        n = getrandom(data, len, 0);
+        if (n < 0) {
+            perror("msdk_shim: getrandom");
+            exit(1);
+        }
+        data += n;
+        len -= n;
+    }
+    return E_NO_ERROR;
+}
+
+int MXC_TRNG_RandomInt(void) {
+    int value;
+
+    MXC_TRNG_Random((uint8_t *)&value, sizeof(value));
+    return value;
+}
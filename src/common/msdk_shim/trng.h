@@ -0,0 +1,17 @@
+/**
+ * @file trng.h
+ * @brief MSDK shim: true random number generator, backed by getrandom(2)
+ */
+
+#ifndef __TRNG_H__
+#define __TRNG_H__
+
+#include <stdint.h>
+#include "mxc_device.h"
+
+int MXC_TRNG_Init(void);
+int MXC_TRNG_Shutdown(void);
+int MXC_TRNG_RandomInt(void);
+int MXC_TRNG_Random(uint8_t *data, uint32_t len);
+
+#endif // __TRNG_H__
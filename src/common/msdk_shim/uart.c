@@ -0,0 +1,239 @@
+/**
+ * @file uart.c
+ * @brief MSDK shim: UART, backed by a pseudo-terminal
+ *
+ * Only the console UART is connected. Reads block on the pty master until the
+ * host sends something. Writes that the host does not pick up within
+ * TX_STALL_MS are dropped, because a real UART keeps transmitting whether or
+ * not anyone is listening.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "board.h"
+#include "uart.h"
+
+// Depth of the hardware FIFOs
+#define UART_FIFO_DEPTH 8
+
+// How long a write may wait for the host to read before the output that is
+// still queued in the pty is discarded
+#define TX_STALL_MS 100
+
+mxc_uart_regs_t msdk_shim_uart[MXC_UART_INSTANCES];
+
+static int master_fd = -1;
+static int slave_fd = -1;
+
+/** @brief Returns the pty master of the console UART, allocating it on first use.
+ *
+ *  @param uart The UART instance.
+ *
+ *  @return The file descriptor, or -1 if uart is not the console UART.
+*/
+static int console_fd(mxc_uart_regs_t *uart) {
+    char name[64];
+    const char *link;
+    struct termios tio;
+
+    if (uart != MXC_UART_GET_UART(CONSOLE_UART)) {
+        return -1;
+    }
+    if (master_fd >= 0) {
+        return master_fd;
+    }
+
+    master_fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (master_fd < 0 || grantpt(master_fd) != 0 || unlockpt(master_fd) != 0
+            || ptsname_r(master_fd, name, sizeof(name)) != 0) {
+        perror("msdk_shim: cannot allocate pty");
+        exit(1);
+    }
+    // Keep the slave open so that the master does not see a hangup whenever a
+    // host disconnects
+    slave_fd = open(name, O_RDWR | O_NOCTTY);
+    if (slave_fd < 0 || tcgetattr(slave_fd, &tio) != 0) {
+        perror("msdk_shim: cannot open pty slave");
+        exit(1);
+    }
+    cfmakeraw(&tio);
+    tcsetattr(slave_fd, TCSANOW, &tio);
+
+    link = getenv("MSDK_SHIM_UART");
+    if (link != NULL) {
+        unlink(link);
+        if (symlink(name, link) != 0) {
+            perror("msdk_shim: cannot create MSDK_SHIM_UART link");
+            exit(1);
+        }
+        fprintf(stderr, "msdk_shim: UART on %s (%s)\n", link, name);
+    } else {
+        fprintf(stderr, "msdk_shim: UART on %s\n", name);
+    }
+    return master_fd;
+}
+
+/** @brief Blocks until the pty master is ready for the given events.
+ *
+ *  @param fd The pty master.
+ *  @param events POLLIN or POLLOUT.
+ *  @param timeout_ms How long to wait, or -1 to wait forever.
+ *
+ *  @return 1 if ready, 0 on timeout.
+*/
+static int wait_for(int fd, short events, int timeout_ms) {
+    struct pollfd pfd = { .fd = fd, .events = events };
+    int ret;
+
+    do {
+        ret = poll(&pfd, 1, timeout_ms);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0) {
+        perror("msdk_shim: poll");
+        exit(1);
+    }
+    return ret;
+}
+
+int MXC_UART_Init(mxc_uart_regs_t *uart, unsigned int baud, mxc_uart_clock_t clock) {
+    (void)baud;
+    (void)clock;
+    if (uart < msdk_shim_uart || uart >= msdk_shim_uart + MXC_UART_INSTANCES) {
+        return E_BAD_PARAM;
+    }
+    console_fd(uart);
+    return E_NO_ERROR;
+}
+
+int MXC_UART_Shutdown(mxc_uart_regs_t *uart) {
+    (void)uart;
+    return E_NO_ERROR;
+}
+
+int MXC_UART_ReadCharacterRaw(mxc_uart_regs_t *uart) {
+    unsigned char c;
+    int fd = console_fd(uart);
+
+    if (fd < 0 || read(fd, &c, 1) != 1) {
+        return E_UNDERFLOW;
+    }
+    return c;
+}
+
+int MXC_UART_WriteCharacterRaw(mxc_uart_regs_t *uart, uint8_t character) {
+    int fd = console_fd(uart);
+
+    if (fd >= 0 && !wait_for(fd, POLLOUT, 0)) {
+        return E_OVERFLOW;
+    }
+    MXC_UART_WriteTXFIFO(uart, &character, 1);
+    return E_NO_ERROR;
+}
+
+int MXC_UART_ReadCharacter(mxc_uart_regs_t *uart) {
+    unsigned char c;
+
+    if (console_fd(uart) < 0) {
+        return E_NO_DEVICE;
+    }
+    MXC_UART_ReadRXFIFO(uart, &c, 1);
+    return c;
+}
+
+int MXC_UART_WriteCharacter(mxc_uart_regs_t *uart, uint8_t character) {
+    MXC_UART_WriteTXFIFO(uart, &character, 1);
+    return E_NO_ERROR;
+}
+
+/** @note Unlike the hardware, this waits for at least one byte instead of
+ *      returning 0, so that callers polling the FIFO do not spin.
+*/
+unsigned int MXC_UART_ReadRXFIFO(mxc_uart_regs_t *uart, unsigned char *bytes, unsigned int len) {
+    int fd = console_fd(uart);
+    ssize_t n;
+
+    if (fd < 0 || len == 0) {
+        return 0;
+    }
+    for (;;) {
+        wait_for(fd, POLLIN, -1);
+        n = read(fd, bytes, len);
+        if (n > 0) {
+            return n;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EINTR && errno != EIO) {
+            perror("msdk_shim: UART read");
+            exit(1);
+        }
+    }
+}
+
+/** @note Unlike the hardware, this takes all len bytes (the pty buffer is far
+ *      larger than the FIFO).
+*/
+unsigned int MXC_UART_WriteTXFIFO(mxc_uart_regs_t *uart, const unsigned char *bytes, unsigned int len) {
+    int fd = console_fd(uart);
+    unsigned int written = 0;
+    ssize_t n;
+
+    if (fd < 0) {
+        return len;  // Nothing is connected: the bytes go nowhere
+    }
+    while (written < len) {
+        if (!wait_for(fd, POLLOUT, TX_STALL_MS)) {
+            // Nobody is reading: drop what the host never picked up
+            tcflush(slave_fd, TCIFLUSH);
+            continue;
+        }
+        n = write(fd, bytes + written, len - written);
+        if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            perror("msdk_shim: UART write");
+            exit(1);
+        }
+        if (n > 0) {
+            written += n;
+        }
+    }
+    return len;
+}
+
+unsigned int MXC_UART_GetRXFIFOAvailable(mxc_uart_regs_t *uart) {
+    int fd = console_fd(uart);
+    int available = 0;
+
+    if (fd < 0 || ioctl(fd, FIONREAD, &available) != 0) {
+        return 0;
+    }
+    return available < UART_FIFO_DEPTH ? available : UART_FIFO_DEPTH;
+}
+
+unsigned int MXC_UART_GetTXFIFOAvailable(mxc_uart_regs_t *uart) {
+    (void)uart;
+    return UART_FIFO_DEPTH;
+}
+
+int MXC_UART_ClearRXFIFO(mxc_uart_regs_t *uart) {
+    unsigned char discard[64];
+    int fd = console_fd(uart);
+
+    if (fd < 0) {
+        return E_NO_ERROR;
+    }
+    while (read(fd, discard, sizeof(discard)) > 0) {
+    }
+    return E_NO_ERROR;
+}
+
+int MXC_UART_ClearTXFIFO(mxc_uart_regs_t *uart) {
+    (void)uart;
+    return E_NO_ERROR;
+}
@@ -0,0 +1,40 @@
+/**
+ * @file uart.h
+ * @brief MSDK shim: UART, backed by a pseudo-terminal
+ *
+ * The console UART is a pty that is opened on first use. Its slave device is
+ * printed to stderr, and if MSDK_SHIM_UART is set a symlink with that name is
+ * created to it, so the host tools can be pointed at a stable path. The baud
+ * rate is ignored. Other UART instances behave as if nothing is connected.
+ */
+
+#ifndef __UART_H__
+#define __UART_H__
+
+#include <stdint.h>
+#include "mxc_device.h"
+
+typedef enum {
+    MXC_UART_APB_CLK = 0,
+    MXC_UART_EXT_CLK = 1,
+    MXC_UART_IBRO_CLK = 2,
+    MXC_UART_ERFO_CLK = 3,
+} mxc_uart_clock_t;
+
+#define MXC_UART_GET_UART(i) (&msdk_shim_uart[(i)])
+#define MXC_UART_GET_IDX(p) ((int)((p) - msdk_shim_uart))
+
+int MXC_UART_Init(mxc_uart_regs_t *uart, unsigned int baud, mxc_uart_clock_t clock);
+int MXC_UART_Shutdown(mxc_uart_regs_t *uart);
+int MXC_UART_ReadCharacterRaw(mxc_uart_regs_t *uart);
+int MXC_UART_WriteCharacterRaw(mxc_uart_regs_t *uart, uint8_t character);
+int MXC_UART_ReadCharacter(mxc_uart_regs_t *uart);
+int MXC_UART_WriteCharacter(mxc_uart_regs_t *uart, uint8_t character);
+unsigned int MXC_UART_ReadRXFIFO(mxc_uart_regs_t *uart, unsigned char *bytes, unsigned int len);
+unsigned int MXC_UART_WriteTXFIFO(mxc_uart_regs_t *uart, const unsigned char *bytes, unsigned int len);
+unsigned int MXC_UART_GetRXFIFOAvailable(mxc_uart_regs_t *uart);
+unsigned int MXC_UART_GetTXFIFOAvailable(mxc_uart_regs_t *uart);
+int MXC_UART_ClearRXFIFO(mxc_uart_regs_t *uart);
+int MXC_UART_ClearTXFIFO(mxc_uart_regs_t *uart);
+
+#endif // __UART_H__
@@ -0,0 +1,124 @@
+/**
+ * @file crypto_bench.c
+ * @brief Benchmark of the crypto primitives of the design1 decoder
+ *
+ * Times each primitive of the decoder's simple_crypto.c on the message sizes
+ * decoder.c hands it, built with the wolfSSL configuration of the firmware:
+ *
+ *   - decrypt_sym (key expanded on every call) and decrypt_sym_ctx (key
+ *     schedule expanded once, as decode() uses it) on the 32 byte
+ *     subscription, the 80 byte frame packet and its 64 byte payload, and
+ *   - "subscription" and "frame", the whole AES work of update_subscription()
+ *     and decode().
+ *
+ * design1 has no HMAC, SHA-256 or CBC: "subscription" and "frame" are the
+ * figures to compare with the same ops of design2's crypto_bench.
+ *
+ * Timing and the JSON result lines come from the shared harness in bench.h.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "simple_crypto.h"
+
+// Encrypted subscription_update_packet_t, padded to a block
+#define SUBSCRIPTION_SIZE 32
+// sizeof(frame_packet_t) in decoder.c, and its padded payload
+#define PACKET_SIZE 80
+#define PAYLOAD_OFFSET 16
+#define PAYLOAD_SIZE 64
+
+static const size_t msg_sizes[] = { SUBSCRIPTION_SIZE, PAYLOAD_SIZE, PACKET_SIZE };
+
+typedef struct {
+    uint8_t master_key[KEY_SIZE];
+    uint8_t channel_key[KEY_SIZE];
+    Aes master_ctx;
+    Aes channel_ctx;
+    uint8_t in[PACKET_SIZE];
+    uint8_t out[PACKET_SIZE];
+    uint8_t payload[PAYLOAD_SIZE];
+    size_t len;
+} crypto_case_t;
+
+static int op_decrypt_sym(void *arg) {
+    crypto_case_t *c = arg;
+
+    return decrypt_sym(c->in, c->len, c->master_key, c->out);
+}
+
+static int op_decrypt_sym_ctx(void *arg) {
+    crypto_case_t *c = arg;
+
+    return decrypt_sym_ctx(&c->master_ctx, c->in, c->len, c->out);
+}
+
+// update_subscription(): one pass with the master key
+static int op_subscription(void *arg) {
+    crypto_case_t *c = arg;
+
+    return decrypt_sym_ctx(&c->master_ctx, c->in, SUBSCRIPTION_SIZE, c->out);
+}
+
+// decode(): the packet with the master key, then the payload with the channel key
+static int op_frame(void *arg) {
+    crypto_case_t *c = arg;
+    int result = decrypt_sym_ctx(&c->master_ctx, c->in, PACKET_SIZE, c->out);
+
+    if (result != 0)
+        return result;
+    return decrypt_sym_ctx(&c->channel_ctx, c->out + PAYLOAD_OFFSET, PAYLOAD_SIZE, c->payload);
+}
+
+/** @brief Builds a frame the way the encoder does and checks it round trips.
+ *
+ * @return 0 on success.
+ */
+static int setup(crypto_case_t *c) {
+    uint8_t payload[PAYLOAD_SIZE];
+    uint8_t frame[PACKET_SIZE];
+
+    for (int i = 0; i < KEY_SIZE; i++) {
+        c->master_key[i] = (uint8_t)(0x10 + i);
+        c->channel_key[i] = (uint8_t)(0x80 + i);
+    }
+    for (int i = 0; i < PAYLOAD_SIZE; i++) {
+        payload[i] = (uint8_t)(i * 7);
+    }
+    memset(frame, 0, sizeof(frame));
+    if (encrypt_sym(payload, PAYLOAD_SIZE, c->channel_key, frame + PAYLOAD_OFFSET) != 0 ||
+            encrypt_sym(frame, PACKET_SIZE, c->master_key, c->in) != 0 ||
+            decrypt_key_init(&c->master_ctx, c->master_key) != 0 ||
+            decrypt_key_init(&c->channel_ctx, c->channel_key) != 0) {
+        return -1;
+    }
+    if (op_frame(c) != 0 || memcmp(c->payload, payload, PAYLOAD_SIZE) != 0)
+        return -1;
+    return 0;
+}
+
+int main(void) {
+    static crypto_case_t crypto_case;
+
+    if (setup(&crypto_case) != 0) {
+        fprintf(stderr, "frame does not round trip through simple_crypto\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(msg_sizes) / sizeof(msg_sizes[0]); i++) {
+        crypto_case.len = msg_sizes[i];
+        if (bench("decrypt_sym", crypto_case.len, op_decrypt_sym, &crypto_case) != 0 ||
+                bench("decrypt_sym_ctx", crypto_case.len, op_decrypt_sym_ctx, &crypto_case) != 0) {
+            return 1;
+        }
+    }
+
+    if (bench("subscription", SUBSCRIPTION_SIZE, op_subscription, &crypto_case) != 0)
+        return 1;
+    if (bench("frame", PACKET_SIZE, op_frame, &crypto_case) != 0)
+        return 1;
+    return 0;
+}
@@ -0,0 +1,247 @@
+/**
+ * @file frame_bench.c
+ * @brief Benchmark of the AES work the decoder does for each frame
+ *
+ * decode() decrypts every frame twice: the whole 80 byte packet with the
+ * master key, then the 64 byte padded payload with the channel key. This
+ * times both passes done the old way (decrypt_sym, which expands the key on
+ * every call) and from key schedules expanded once (decrypt_key_init and
+ * decrypt_sym_ctx, as decode() now does), using the decoder's own
+ * simple_crypto.c.
+ *
+ * Before timing, the FIPS-197 known-answer vectors (and the multi-block
+ * SP 800-38A ECB vector) are run through the same functions, so that a build
+ * with a different AES implementation (AES_ASM=1) is checked before it is
+ * measured. Passing "check" as the only argument stops after the vectors.
+ *
+ * Timing and the JSON result lines come from the shared harness in bench.h;
+ * each op is one frame, and us_per_block and cycles_per_block divide it by the
+ * AES blocks of a frame. Cycle counts are null under qemu-arm, where
+ * us_per_block is the figure to compare.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "simple_crypto.h"
+
+// sizeof(frame_packet_t) in decoder.c, and its padded payload
+#define PACKET_SIZE 80
+#define PAYLOAD_OFFSET 16
+#define PAYLOAD_SIZE 64
+#define BLOCKS_PER_FRAME ((PACKET_SIZE + PAYLOAD_SIZE) / BLOCK_SIZE)
+
+typedef struct {
+    const char *name;
+    uint8_t key[KEY_SIZE];
+    uint8_t plaintext[4 * BLOCK_SIZE];
+    uint8_t ciphertext[4 * BLOCK_SIZE];
+    size_t len;
+} aes_vector_t;
+
+static const aes_vector_t aes_vectors[] = {
+    {
+        "fips197_appendix_b",
+        { 0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+          0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c },
+        { 0x32, 0x43, 0xf6, 0xa8, 0x88, 0x5a, 0x30, 0x8d,
+          0x31, 0x31, 0x98, 0xa2, 0xe0, 0x37, 0x07, 0x34 },
+        { 0x39, 0x25, 0x84, 0x1d, 0x02, 0xdc, 0x09, 0xfb,
+          0xdc, 0x11, 0x85, 0x97, 0x19, 0x6a, 0x0b, 0x32 },
+        BLOCK_SIZE,
+    },
+    {
+        "fips197_appendix_c1",
+        { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+          0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f },
+        { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+          0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff },
+        { 0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+          0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a },
+        BLOCK_SIZE,
+    },
+    {
+        "sp800_38a_f11_ecb_aes128",
+        { 0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+          0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c },
+        { 0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+          0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+          0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+          0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+          0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+          0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+          0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
+          0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10 },
+        { 0x3a, 0xd7, 0x7b, 0xb4, 0x0d, 0x7a, 0x36, 0x60,
+          0xa8, 0x9e, 0xca, 0xf3, 0x24, 0x66, 0xef, 0x97,
+          0xf5, 0xd3, 0xd5, 0x85, 0x03, 0xb9, 0x69, 0x9d,
+          0xe7, 0x85, 0x89, 0x5a, 0x96, 0xfd, 0xba, 0xaf,
+          0x43, 0xb1, 0xcd, 0x7f, 0x59, 0x8e, 0xce, 0x23,
+          0x88, 0x1b, 0x00, 0xe3, 0xed, 0x03, 0x06, 0x88,
+          0x7b, 0x0c, 0x78, 0x5e, 0x27, 0xe8, 0xad, 0x3f,
+          0x82, 0x23, 0x20, 0x71, 0x04, 0x72, 0x5d, 0xd4 },
+        4 * BLOCK_SIZE,
+    },
+};
+
+typedef struct {
+    uint8_t master_key[KEY_SIZE];
+    uint8_t channel_key[KEY_SIZE];
+    Aes master_ctx;
+    Aes channel_ctx;
+    uint8_t packet[PACKET_SIZE];
+    uint8_t frame[PACKET_SIZE];
+    uint8_t payload[PAYLOAD_SIZE];
+} frame_case_t;
+
+/** @brief Checks one known-answer vector through every simple_crypto path.
+ *
+ * @return 0 if encrypt_sym, decrypt_sym and decrypt_sym_ctx all match.
+ */
+static int check_vector(const aes_vector_t *v) {
+    uint8_t key[KEY_SIZE];
+    uint8_t in[sizeof(v->plaintext)];
+    uint8_t out[sizeof(v->plaintext)];
+    Aes ctx;
+
+    // simple_crypto takes non-const buffers
+    memcpy(key, v->key, KEY_SIZE);
+    memcpy(in, v->plaintext, v->len);
+    if (encrypt_sym(in, v->len, key, out) != 0 || memcmp(out, v->ciphertext, v->len) != 0)
+        return -1;
+
+    memcpy(in, v->ciphertext, v->len);
+    if (decrypt_sym(in, v->len, key, out) != 0 || memcmp(out, v->plaintext, v->len) != 0)
+        return -1;
+
+    memset(out, 0, sizeof(out));
+    if (decrypt_key_init(&ctx, key) != 0 || decrypt_sym_ctx(&ctx, in, v->len, out) != 0 ||
+            memcmp(out, v->plaintext, v->len) != 0)
+        return -1;
+    return 0;
+}
+
+/** @brief Runs all known-answer vectors and prints one result line for each.
+ *
+ * @return 0 if all of them pass.
+ */
+static int check_vectors(void) {
+    int failed = 0;
+
+    for (size_t i = 0; i < sizeof(aes_vectors) / sizeof(aes_vectors[0]); i++) {
+        int result = check_vector(&aes_vectors[i]);
+        printf("{\"design\": \"%s\", \"config\": \"%s\", \"op\": \"kat\", "
+                "\"vector\": \"%s\", \"blocks\": %u, \"result\": \"%s\"}\n",
+                BENCH_DESIGN, BENCH_CONFIG, aes_vectors[i].name,
+                (unsigned)(aes_vectors[i].len / BLOCK_SIZE), result == 0 ? "pass" : "fail");
+        failed |= result;
+    }
+    fflush(stdout);
+    return failed;
+}
+
+/** @brief Both decryption passes of decode(), expanding each key per call.
+*/
+static int decode_per_call(void *arg) {
+    frame_case_t *c = arg;
+    int result = decrypt_sym(c->packet, PACKET_SIZE, c->master_key, c->frame);
+    if (result != 0)
+        return result;
+    return decrypt_sym(c->frame + PAYLOAD_OFFSET, PAYLOAD_SIZE, c->channel_key, c->payload);
+}
+
+/** @brief Both decryption passes of decode(), from the cached key schedules.
+*/
+static int decode_cached(void *arg) {
+    frame_case_t *c = arg;
+    int result = decrypt_sym_ctx(&c->master_ctx, c->packet, PACKET_SIZE, c->frame);
+    if (result != 0)
+        return result;
+    return decrypt_sym_ctx(&c->channel_ctx, c->frame + PAYLOAD_OFFSET, PAYLOAD_SIZE, c->payload);
+}
+
+/** @brief Builds a frame encrypted the way the encoder does it.
+ *
+ * @return 0 on success, non-zero on error.
+ */
+static int setup(frame_case_t *c) {
+    uint8_t payload[PAYLOAD_SIZE];
+    uint8_t frame[PACKET_SIZE];
+    int result;
+
+    for (int i = 0; i < KEY_SIZE; i++) {
+        c->master_key[i] = (uint8_t)i;
+        c->channel_key[i] = (uint8_t)(0xA0 + i);
+    }
+    for (int i = 0; i < PAYLOAD_SIZE; i++) {
+        payload[i] = (uint8_t)(i * 7);
+    }
+    memset(frame, 0, sizeof(frame));
+    frame[0] = 1;                    // channel
+    frame[12] = PAYLOAD_SIZE;        // size
+    result = encrypt_sym(payload, PAYLOAD_SIZE, c->channel_key, frame + PAYLOAD_OFFSET);
+    if (result == 0)
+        result = encrypt_sym(frame, PACKET_SIZE, c->master_key, c->packet);
+    if (result == 0)
+        result = decrypt_key_init(&c->master_ctx, c->master_key);
+    if (result == 0)
+        result = decrypt_key_init(&c->channel_ctx, c->channel_key);
+    if (result != 0)
+        return result;
+
+    // Both variants must recover the payload
+    if (decode_per_call(c) != 0 || memcmp(c->payload, payload, PAYLOAD_SIZE) != 0)
+        return -1;
+    memset(c->payload, 0, PAYLOAD_SIZE);
+    if (decode_cached(c) != 0 || memcmp(c->payload, payload, PAYLOAD_SIZE) != 0)
+        return -1;
+    return 0;
+}
+
+/** @brief Times one variant and prints its result line, with per-block figures.
+ *
+ * @return 0 on success, non-zero on error.
+ */
+static int bench_frame(const char *name, bench_op_t op, frame_case_t *c) {
+    bench_result_t result;
+    int retcode = bench_run(op, c, &result);
+
+    if (retcode != 0) {
+        fprintf(stderr, "%s failed during timing\n", name);
+        return retcode;
+    }
+
+    bench_print_result(name, PACKET_SIZE + PAYLOAD_SIZE, &result);
+    printf(", \"us_per_block\": %.4f, ", result.seconds * 1e6 / result.count / BLOCKS_PER_FRAME);
+#ifdef BENCH_HAVE_CYCLE_COUNTER
+    printf("\"cycles_per_block\": %.1f", (double)result.cycles / result.count / BLOCKS_PER_FRAME);
+#else
+    printf("\"cycles_per_block\": null");
+#endif
+    bench_print_end();
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    static frame_case_t frame_case;
+
+    if (check_vectors() != 0) {
+        fprintf(stderr, "AES known-answer tests failed\n");
+        return 1;
+    }
+    if (argc > 1 && strcmp(argv[1], "check") == 0) {
+        return 0;
+    }
+
+    if (setup(&frame_case) != 0) {
+        fprintf(stderr, "frame setup failed\n");
+        return 1;
+    }
+    if (bench_frame("decode_per_call_key", decode_per_call, &frame_case) != 0 ||
+            bench_frame("decode_cached_key", decode_cached, &frame_case) != 0) {
+        return 1;
+    }
+    return 0;
+}
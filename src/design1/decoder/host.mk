@@ -0,0 +1,17 @@
+# Linux build of this decoder against the MSDK shim, so the host tools can be
+# run against it without a board. See ../../common/msdk_shim/host.mk.
+#
+#   make -f host.mk DECODER_ID=0xdeadbeef SECRETS_DIR=secrets
+#   MSDK_SHIM_UART=/tmp/design1.pty build/host/decoder
+
+# The Makefile always builds wolfSSL
+CRYPTO_EXAMPLE := 1
+
+# The Thumb-2 assembly AES only runs on the Cortex-M4
+override AES_ASM := 0
+
+# Directory holding global.secrets (mounted at /secrets for the firmware build)
+SECRETS_DIR ?= secrets
+HOST_CPPFLAGS += -I$(SECRETS_DIR)
+
+include ../../common/msdk_shim/host.mk
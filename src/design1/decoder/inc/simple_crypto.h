@@ -53,6 +53,32 @@ int encrypt_sym(uint8_t *plaintext, size_t len, uint8_t *key, uint8_t *ciphertex
  */
 int decrypt_sym(uint8_t *ciphertext, size_t len, uint8_t *key, uint8_t *plaintext);
 
+/** @brief Expands a key into a decryption context that can be reused
+ *
+ * @param ctx A pointer to the context to initialize
+ * @param key A pointer to a buffer of length KEY_SIZE (16 bytes) containing
+ *           the key to use for decryption
+ *
+ * @return 0 on success, non-zero for other error
+ */
+int decrypt_key_init(Aes *ctx, uint8_t *key);
+
+/** @brief Decrypts ciphertext with an already expanded key
+ *
+ * Same as decrypt_sym, without the cost of expanding the key on every call.
+ *
+ * @param ctx A pointer to a context initialized by decrypt_key_init
+ * @param ciphertext A pointer to a buffer of length len containing the
+ *           ciphertext to decrypt
+ * @param len The length of the ciphertext to decrypt. Must be a multiple of
+ *           BLOCK_SIZE (16 bytes)
+ * @param plaintext A pointer to a buffer of length len where the resulting
+ *           plaintext will be written to
+ *
+ * @return 0 on success, -1 on bad length, other non-zero for other error
+ */
+int decrypt_sym_ctx(Aes *ctx, uint8_t *ciphertext, size_t len, uint8_t *plaintext);
+
 /** @brief Hashes arbitrary-length data
  *
  * @param data A pointer to a buffer of length len containing the data
@@ -24,6 +24,36 @@ IPATH+=/secrets
 IPATH+=/
 VPATH+=src/
 
+# Shared host messaging library. In the Docker build, mount src/common at
+# /common, which is where this path resolves from /decoder.
+COMMON_DIR ?= ../../common
+IPATH+=$(COMMON_DIR)/host_messaging
+VPATH+=$(COMMON_DIR)/host_messaging
+# Shared flash driver and the record store that persists subscriptions
+IPATH+=$(COMMON_DIR)/flash_store
+VPATH+=$(COMMON_DIR)/flash_store
+
+# Set AES_ASM=1 to replace wolfSSL's portable aes.c with its Thumb-2 assembly
+# port for the Cortex-M4. The inline-assembly build of thumb2-aes-asm.S is used,
+# since the MSDK only picks up C sources.
+# bench/ builds the same variant to check and time it under qemu-arm.
+#
+# The firmware variant has not yet passed crypto_bench's known-answer tests
+# under qemu-arm or on hardware, so it also needs AES_ASM_UNTESTED=1. Drop
+# that requirement once `make -C bench ARCH=arm AES_ASM=1 check` has passed.
+AES_ASM ?= 0
+AES_ASM_UNTESTED ?= 0
+AES_ASM_CFLAGS := -DWOLFSSL_ARMASM -DWOLFSSL_ARMASM_THUMB2 -DWOLFSSL_ARMASM_INLINE
+AES_ASM_CFLAGS += -DWOLFSSL_ARMASM_NO_HW_CRYPTO -DWOLFSSL_ARMASM_NO_NEON
+AES_ASM_SRCS := port/arm/armv8-aes.c port/arm/thumb2-aes-asm_c.c
+ifeq ($(AES_ASM),1)
+ifneq ($(AES_ASM_UNTESTED),1)
+$(error AES_ASM=1 has not passed the crypto_bench known-answer tests; set AES_ASM_UNTESTED=1 to build it anyway)
+endif
+PROJ_CFLAGS += $(AES_ASM_CFLAGS)
+SRCS += $(addprefix wolfssl/wolfcrypt/src/,$(AES_ASM_SRCS))
+endif
+
 # ****************** eCTF Bootloader *******************
 # DO NOT REMOVE
 LINKERFILE=firmware.ld
@@ -6,6 +6,7 @@
 #include "status_led.h"
 #include "board.h"
 #include "mxc_delay.h"
+#include "flash_store.h"
 #include "simple_flash.h"
 #include "host_messaging.h"
 #include "trng.h"
@@ -27,6 +28,7 @@
 #define channel_id_t uint32_t
 #define decoder_id_t uint32_t
 #define pkt_len_t uint16_t
+#define MAX_PACKET_SIZE 100
 #define data_len_t uint32_t // just making it size of unsigned int so that packing the packet is easier > python has limited options
 
 /**********************************************************
@@ -37,15 +39,6 @@
 #define EMERGENCY_CHANNEL 0
 #define FRAME_SIZE 64
 #define DEFAULT_CHANNEL_TIMESTAMP 0xFFFFFFFFFFFFFFFF
-// This is a canary value so we can confirm whether this decoder has booted before
-#define FLASH_FIRST_BOOT 0xDEADBEEF
-
-/**********************************************************
- ********************* STATE MACROS ***********************
- **********************************************************/
-
-// Calculate the flash address where we will store channel info as the 2nd to last page available
-#define FLASH_STATUS_ADDR ((MXC_FLASH_MEM_BASE + MXC_FLASH_MEM_SIZE) - (2 * MXC_FLASH_PAGE_SIZE))
 
 /**********************************************************
  *********** COMMUNICATION PACKET DEFINITIONS *************
@@ -92,11 +85,19 @@ typedef struct {
     timestamp_t end_timestamp;
 } channel_status_t;
 
+// Each subscription slot is kept in the flash store under its index
 typedef struct {
-    uint32_t first_boot; // if set to FLASH_FIRST_BOOT, device has booted before.
     channel_status_t subscribed_channels[MAX_CHANNEL_COUNT];
 } flash_entry_t;
 
+// Earlier firmware kept every slot in FLASH_STORE_LEGACY_PAGE, behind this canary
+#define FLASH_FIRST_BOOT 0xDEADBEEF
+
+typedef struct {
+    uint32_t first_boot; // if set to FLASH_FIRST_BOOT, earlier firmware wrote the page
+    channel_status_t subscribed_channels[MAX_CHANNEL_COUNT];
+} legacy_flash_entry_t;
+
 /**********************************************************
  ************************ GLOBALS *************************
  **********************************************************/
@@ -107,16 +108,33 @@ flash_entry_t decoder_status;
 // global array to track the last processed timestamp per channel
 static timestamp_t last_timestamps;
 
+// Expanded decryption keys, so that frames do not pay for the key schedule.
+// channel_key_ctx[i] belongs to decoder_status.subscribed_channels[i].
+static Aes secret_key_ctx;
+static Aes channel_key_ctx[MAX_CHANNEL_COUNT];
+
 /**********************************************************
  ******************* UTILITY FUNCTIONS ********************
  **********************************************************/
 
+/** @brief Expands the channel key of a subscription slot into its cached context
+ *
+ *  @param slot The index into decoder_status.subscribed_channels.
+ *  @return 0 if successful, non-zero on error.
+*/
+int cache_channel_key(int slot) {
+    channel_id_t channel = decoder_status.subscribed_channels[slot].id;
+
+    return decrypt_key_init(&channel_key_ctx[slot], (uint8_t*)channel_keys[channel % 10007]);
+}
+
 /** @brief Checks whether the decoder is subscribed to a given channel
  *
  *  @param channel The channel number to be checked.
+ *  @param slot Set to the subscription slot of the channel if subscribed.
  *  @return 0 if emergency channel. returns 1 if subscribed channel. -1 if not subscribed.
 */
-int is_subscribed(channel_id_t channel, timestamp_t timestamp) {
+int is_subscribed(channel_id_t channel, timestamp_t timestamp, int *slot) {
     // Check if this is an emergency broadcast message
     if (channel == EMERGENCY_CHANNEL) {
         return 0;
@@ -141,6 +159,7 @@ int is_subscribed(channel_id_t channel, timestamp_t timestamp) {
 
             // Update last processed timestamp (stored in RAM only)
             last_timestamps = timestamp;
+            *slot = i;
             return 1;
         }
     }
@@ -200,7 +219,7 @@ int update_subscription(pkt_len_t pkt_len, uint8_t *update) {
     uint8_t decrypted_update[sizeof(subscription_update_packet_t)];  
 
 
-    if(decrypt_sym(update, pkt_len, (uint8_t*)secret_key, decrypted_update) != 0){
+    if(decrypt_sym_ctx(&secret_key_ctx, update, pkt_len, decrypted_update) != 0){
         print_error("Decryption Failed! Invalid subscription update.");
         return -1;
     }
@@ -232,12 +251,20 @@ int update_subscription(pkt_len_t pkt_len, uint8_t *update) {
     // Find the first empty slot in the subscription array
     for (i = 0; i < MAX_CHANNEL_COUNT; i++) {
         if (decoder_status.subscribed_channels[i].id == safe_update->channel || !decoder_status.subscribed_channels[i].active) {
+            channel_status_t previous = decoder_status.subscribed_channels[i];
 
             // Update the subscription with new information
             decoder_status.subscribed_channels[i].active = true;
             decoder_status.subscribed_channels[i].id = safe_update->channel;
             decoder_status.subscribed_channels[i].start_timestamp = safe_update->start_timestamp;
             decoder_status.subscribed_channels[i].end_timestamp = safe_update->end_timestamp;
+            if (cache_channel_key(i) != 0) {
+                // Leave the slot as it was, so that no subscription is active without its key
+                decoder_status.subscribed_channels[i] = previous;
+                STATUS_LED_RED();
+                print_error("Failed to update subscription - cannot expand channel key\n");
+                return -1;
+            }
             break;
         }
     }
@@ -249,9 +276,12 @@ int update_subscription(pkt_len_t pkt_len, uint8_t *update) {
         return -1;
     }
 
-    // Write the updated subscription data to flash memory
-    flash_simple_erase_page(FLASH_STATUS_ADDR);
-    flash_simple_write(FLASH_STATUS_ADDR, &decoder_status, sizeof(flash_entry_t));
+    // Write the updated slot to flash memory
+    if (flash_store_write(i, &decoder_status.subscribed_channels[i], sizeof(channel_status_t)) != 0) {
+        STATUS_LED_RED();
+        print_error("Failed to update subscription - cannot write flash\n");
+        return -1;
+    }
 
     // Success message with an empty body
     write_packet(SUBSCRIBE_MSG, NULL, 0);
@@ -288,7 +318,7 @@ int decode(pkt_len_t pkt_len, uint8_t *new_frame) {
     }
 
     // Perform first round of decryption on entire packet
-    if (decrypt_sym(new_frame, pkt_len, (uint8_t*)secret_key, decrypted_frame) != 0) {
+    if (decrypt_sym_ctx(&secret_key_ctx, new_frame, pkt_len, decrypted_frame) != 0) {
         print_error("failed to decrypt");
         return -1; // decryption failed
     }
@@ -322,11 +352,12 @@ int decode(pkt_len_t pkt_len, uint8_t *new_frame) {
     0 -> channel 0
     1 -> use that key (channel % 10007)
     */
-    int subscribe_ret = is_subscribed(decrypted_packet->channel, decrypted_packet->timestamp);
+    int slot = 0;
+    int subscribe_ret = is_subscribed(decrypted_packet->channel, decrypted_packet->timestamp, &slot);
     // Subscribed Channel
     if (subscribe_ret == 1) {
-        uint8_t *second_key = (uint8_t*)channel_keys[((decrypted_packet->channel) % 10007)];
-        if (decrypt_sym(trimmed_encrypted_data, padded_data_size, second_key, decrypted_message) != 0) {
+        // channel_key_ctx[slot] holds channel_keys[channel % 10007]
+        if (decrypt_sym_ctx(&channel_key_ctx[slot], trimmed_encrypted_data, padded_data_size, decrypted_message) != 0) {
             print_error("Failed to decrypt frame");
             return -1; // decryption failed
         }
@@ -338,7 +369,7 @@ int decode(pkt_len_t pkt_len, uint8_t *new_frame) {
     }
     // Channel 0
     else if(subscribe_ret == 0){
-        if (decrypt_sym(trimmed_encrypted_data, padded_data_size, (uint8_t*)secret_key, decrypted_message) != 0) {
+        if (decrypt_sym_ctx(&secret_key_ctx, trimmed_encrypted_data, padded_data_size, decrypted_message) != 0) {
             print_error("Failed to decrypt frame");
             return -1;
         }
@@ -368,35 +399,52 @@ int decode(pkt_len_t pkt_len, uint8_t *new_frame) {
 void init() {
     int ret;
 
-    // Initialize the flash peripheral to enable access to persistent memory
-    flash_simple_init();
-
-
-    // Read starting flash values into our flash status struct
-    flash_simple_read(FLASH_STATUS_ADDR, &decoder_status, sizeof(flash_entry_t));
-    
-
+    // Initialize the flash peripheral and the store that keeps subscriptions
+    ret = flash_store_init();
+    if (ret < 0) {
+        STATUS_LED_ERROR();
+        // if flash fails to initialize, do not continue to execute
+        while (1);
+    }
 
-    if (decoder_status.first_boot != FLASH_FIRST_BOOT) {
-        /* If this is the first boot of this decoder, mark all channels as unsubscribed.
-        *  This data will be persistent across reboots of the decoder. Whenever the decoder
-        *  processes a subscription update, this data will be updated.
-        */
-        decoder_status.first_boot = FLASH_FIRST_BOOT;
+    /* Read each subscription slot from the flash store. A slot that has never
+    *  been written, e.g. on the first boot of this decoder, is unsubscribed,
+    *  unless earlier firmware left an active subscription for it in its status
+    *  page: that one is copied into the store. Whenever the decoder processes
+    *  a subscription update, the slot's record will be updated.
+    */
+    static legacy_flash_entry_t legacy_status;
+    flash_simple_read(FLASH_STORE_LEGACY_PAGE, &legacy_status, sizeof(legacy_flash_entry_t));
 
-        channel_status_t subscription[MAX_CHANNEL_COUNT];
+    for (int i = 0; i < MAX_CHANNEL_COUNT; i++) {
+        channel_status_t *subscription = &decoder_status.subscribed_channels[i];
 
-        for (int i = 0; i < MAX_CHANNEL_COUNT; i++){
-            subscription[i].start_timestamp = DEFAULT_CHANNEL_TIMESTAMP;
-            subscription[i].end_timestamp = DEFAULT_CHANNEL_TIMESTAMP;
-            subscription[i].active = false;
+        if (flash_store_read(i, subscription, sizeof(channel_status_t)) == sizeof(channel_status_t)) {
+            continue;
         }
+        if (legacy_status.first_boot == FLASH_FIRST_BOOT && legacy_status.subscribed_channels[i].active) {
+            // If the write fails, the slot is still used until the next boot, which retries it
+            *subscription = legacy_status.subscribed_channels[i];
+            flash_store_write(i, subscription, sizeof(channel_status_t));
+        } else {
+            memset(subscription, 0, sizeof(channel_status_t));
+            subscription->start_timestamp = DEFAULT_CHANNEL_TIMESTAMP;
+            subscription->end_timestamp = DEFAULT_CHANNEL_TIMESTAMP;
+            subscription->active = false;
+        }
+    }
 
-        // Write the starting channel subscriptions into flash.
-        memcpy(decoder_status.subscribed_channels, subscription, MAX_CHANNEL_COUNT*sizeof(channel_status_t));
-
-        flash_simple_erase_page(FLASH_STATUS_ADDR);
-        flash_simple_write(FLASH_STATUS_ADDR, &decoder_status, sizeof(flash_entry_t));
+    // Expand the master key and the keys of the stored subscriptions once, at boot
+    ret = decrypt_key_init(&secret_key_ctx, (uint8_t*)secret_key);
+    for (int i = 0; ret == 0 && i < MAX_CHANNEL_COUNT; i++) {
+        if (decoder_status.subscribed_channels[i].active) {
+            ret = cache_channel_key(i);
+        }
+    }
+    if (ret != 0) {
+        STATUS_LED_ERROR();
+        // without the keys no subscription or frame can be decrypted
+        while (1);
     }
 
     // Initialize the uart peripheral to enable serial I/O
@@ -442,7 +490,7 @@ void init() {
          STATUS_LED_GREEN();
  
         
-         result = read_packet(&cmd, uart_buf, &pkt_len);
+         result = read_packet(&cmd, uart_buf, sizeof(uart_buf), &pkt_len);
  
          if (result < 0) {
              STATUS_LED_ERROR();
@@ -76,13 +76,47 @@ int decrypt_sym(uint8_t *ciphertext, size_t len, uint8_t *key, uint8_t *plaintex
         return -1;
 
     // Set the key for decryption
-    result = wc_AesSetKey(&ctx, key, 16, NULL, AES_DECRYPTION);
+    result = decrypt_key_init(&ctx, key);
     if (result != 0)
         return result; // Report error
 
+    return decrypt_sym_ctx(&ctx, ciphertext, len, plaintext);
+}
+
+/** @brief Expands a key into a decryption context that can be reused
+ *
+ * @param ctx A pointer to the context to initialize
+ * @param key A pointer to a buffer of length KEY_SIZE (16 bytes) containing
+ *          the key to use for decryption
+ *
+ * @return 0 on success, non-zero for other error
+ */
+int decrypt_key_init(Aes *ctx, uint8_t *key) {
+    return wc_AesSetKey(ctx, key, KEY_SIZE, NULL, AES_DECRYPTION);
+}
+
+/** @brief Decrypts ciphertext with an already expanded key
+ *
+ * @param ctx A pointer to a context initialized by decrypt_key_init
+ * @param ciphertext A pointer to a buffer of length len containing the
+ *          ciphertext to decrypt
+ * @param len The length of the ciphertext to decrypt. Must be a multiple of
+ *          BLOCK_SIZE (16 bytes)
+ * @param plaintext A pointer to a buffer of length len where the resulting
+ *          plaintext will be written to
+ *
+ * @return 0 on success, -1 on bad length, other non-zero for other error
+ */
+int decrypt_sym_ctx(Aes *ctx, uint8_t *ciphertext, size_t len, uint8_t *plaintext) {
+    int result; // Library result
+
+    // Ensure valid length
+    if (len <= 0 || len % BLOCK_SIZE)
+        return -1;
+
     // Decrypt each block
     for (int i = 0; i < len - 1; i += BLOCK_SIZE) {
-        result = wc_AesDecryptDirect(&ctx, plaintext + i, ciphertext + i);
+        result = wc_AesDecryptDirect(ctx, plaintext + i, ciphertext + i);
         if (result != 0)
             return result; // Report error
     }
@@ -0,0 +1,174 @@
+/**
+ * @file crypto_bench.c
+ * @brief Benchmark of the crypto primitives of the design2 decoder
+ *
+ * Times each primitive of the decoder's crypto_utils.c on the message sizes
+ * decoder.c hands it, built with the wolfSSL configuration of the firmware:
+ *
+ *   - hmac_verify and hmac_verify_state on the 48 byte subscription and the
+ *     80 byte frame bodies,
+ *   - decrypt_cbc_sym (including the PKCS#7 check) on the same bodies, with
+ *     AES-256 for subscriptions and AES-128 for frames,
+ *   - sha256_hash on the 20 byte input of the subscription key, and
+ *   - "subscription" and "frame", the whole crypto work of
+ *     update_subscription() and decode() (hmac_verify_state, then
+ *     decrypt_cbc_sym).
+ *
+ * "subscription" and "frame" are the figures to compare with the same ops of
+ * design1's crypto_bench.
+ *
+ * Timing and the JSON result lines come from the shared harness in bench.h.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "crypto_utils.h"
+
+#define HMAC_LEN 32
+#define HMAC_KEY_LEN 32
+// sizeof(subscription_update_payload_t) and sizeof(frame_packet_payload_t)
+// in decoder.c, both ending in 8 bytes of PKCS#7 padding
+#define SUBSCRIPTION_SIZE 48
+#define FRAME_SIZE 80
+#define PAD_SIZE 8
+// sizeof(decoder_id_t) + sizeof(secrets.subupdate_salt) in decoder.c
+#define PREHASH_SIZE 20
+
+typedef struct {
+    const char *name;
+    size_t len;
+    int key_size;
+    uint8_t key[AES256];
+    uint8_t iv[AES_BLOCK_SIZE];
+    uint8_t ciphertext[FRAME_SIZE];
+    uint8_t plaintext[FRAME_SIZE];
+    uint8_t tag[HMAC_LEN];
+} crypto_msg_t;
+
+typedef struct {
+    uint8_t hmac_key[HMAC_KEY_LEN];
+    hmac_key_state_t hmac_state;
+    crypto_msg_t *msg;
+} crypto_case_t;
+
+static int op_hmac_verify(void *arg) {
+    crypto_case_t *c = arg;
+    crypto_msg_t *m = c->msg;
+
+    return hmac_verify(m->ciphertext, m->len, m->tag, c->hmac_key, sizeof(c->hmac_key));
+}
+
+static int op_hmac_verify_state(void *arg) {
+    crypto_case_t *c = arg;
+    crypto_msg_t *m = c->msg;
+
+    return hmac_verify_state(&c->hmac_state, m->ciphertext, m->len, m->tag);
+}
+
+static int op_decrypt_cbc_sym(void *arg) {
+    crypto_case_t *c = arg;
+    crypto_msg_t *m = c->msg;
+    int pt_len;
+
+    return decrypt_cbc_sym(m->ciphertext, m->len, m->key, m->key_size, m->iv, m->plaintext, &pt_len);
+}
+
+static int op_sha256_hash(void *arg) {
+    crypto_case_t *c = arg;
+    uint8_t digest[HMAC_LEN];
+
+    sha256_hash(c->msg->ciphertext, PREHASH_SIZE, digest);
+    return 0;
+}
+
+// update_subscription() and decode(): authenticate, then decrypt
+static int op_message(void *arg) {
+    int result = op_hmac_verify_state(arg);
+
+    if (result != 0)
+        return result;
+    return op_decrypt_cbc_sym(arg);
+}
+
+/** @brief Encrypts and authenticates a padded body the way the encoder does.
+ *
+ * @return 0 if it round trips through decrypt_cbc_sym and hmac_verify.
+ */
+static int setup_msg(crypto_case_t *c, crypto_msg_t *m) {
+    uint8_t body[FRAME_SIZE];
+    Aes aes;
+    int pt_len;
+    int result;
+
+    for (int i = 0; i < m->key_size; i++) {
+        m->key[i] = (uint8_t)(0x20 + i);
+    }
+    for (int i = 0; i < AES_BLOCK_SIZE; i++) {
+        m->iv[i] = (uint8_t)(0xC0 + i);
+    }
+    for (size_t i = 0; i < m->len - PAD_SIZE; i++) {
+        body[i] = (uint8_t)(i * 7);
+    }
+    memset(body + m->len - PAD_SIZE, PAD_SIZE, PAD_SIZE);
+
+    result = wc_AesInit(&aes, NULL, INVALID_DEVID);
+    if (result == 0)
+        result = wc_AesSetKey(&aes, m->key, m->key_size, m->iv, AES_ENCRYPTION);
+    if (result == 0)
+        result = wc_AesCbcEncrypt(&aes, m->ciphertext, body, m->len);
+    wc_AesFree(&aes);
+    if (result != 0)
+        return -1;
+    hmac_digest(m->ciphertext, m->len, c->hmac_key, sizeof(c->hmac_key), m->tag);
+
+    c->msg = m;
+    if (op_hmac_verify(c) != 0 || op_message(c) != 0)
+        return -1;
+    if (decrypt_cbc_sym(m->ciphertext, m->len, m->key, m->key_size, m->iv, m->plaintext, &pt_len) != 0 ||
+            pt_len != (int)(m->len - PAD_SIZE) || memcmp(m->plaintext, body, pt_len) != 0)
+        return -1;
+    return 0;
+}
+
+int main(void) {
+    static crypto_case_t crypto_case;
+    static crypto_msg_t msgs[] = {
+        { .name = "subscription", .len = SUBSCRIPTION_SIZE, .key_size = AES256 },
+        { .name = "frame", .len = FRAME_SIZE, .key_size = AES128 },
+    };
+
+    for (int i = 0; i < HMAC_KEY_LEN; i++) {
+        crypto_case.hmac_key[i] = (uint8_t)(0x40 + i);
+    }
+    if (hmac_key_init(&crypto_case.hmac_state, crypto_case.hmac_key, HMAC_KEY_LEN) != 0) {
+        fprintf(stderr, "hmac_key_init failed\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(msgs) / sizeof(msgs[0]); i++) {
+        crypto_msg_t *m = &msgs[i];
+
+        if (setup_msg(&crypto_case, m) != 0) {
+            fprintf(stderr, "%s does not round trip through crypto_utils\n", m->name);
+            return 1;
+        }
+        if (bench("hmac_verify", m->len, op_hmac_verify, &crypto_case) != 0 ||
+                bench("hmac_verify_state", m->len, op_hmac_verify_state, &crypto_case) != 0 ||
+                bench("decrypt_cbc_sym", m->len, op_decrypt_cbc_sym, &crypto_case) != 0) {
+            return 1;
+        }
+    }
+
+    if (bench("sha256_hash", PREHASH_SIZE, op_sha256_hash, &crypto_case) != 0)
+        return 1;
+
+    for (size_t i = 0; i < sizeof(msgs) / sizeof(msgs[0]); i++) {
+        crypto_case.msg = &msgs[i];
+        if (bench(msgs[i].name, msgs[i].len, op_message, &crypto_case) != 0)
+            return 1;
+    }
+    return 0;
+}
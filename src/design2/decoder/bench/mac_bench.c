@@ -0,0 +1,135 @@
+/**
+ * @file mac_bench.c
+ * @brief Benchmark of the HMAC work the decoder does for each message
+ *
+ * decode() and update_subscription() verify an HMAC-SHA-256 over the encrypted
+ * body (80 bytes for a frame, 48 for a subscription) with the constant
+ * hmac_auth_key. This times hmac_verify, which keys a fresh context on every
+ * call, against hmac_verify_state, which resumes from the midstates that
+ * hmac_key_init computes once at boot. It also times the
+ * sha256(DEVICE_ID || subupdate_salt) that subscriptions no longer repeat.
+ *
+ * Before timing, hmac_verify_state is checked against wolfSSL's Hmac (through
+ * hmac_digest) for short and longer-than-a-block keys.
+ *
+ * Timing and the JSON result lines come from the shared harness in bench.h.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "crypto_utils.h"
+
+#define HMAC_LEN 32
+#define KEY_LEN 32
+#define MAX_MSG_SIZE 80
+// sizeof(decoder_id_t) + sizeof(secrets.subupdate_salt) in decoder.c
+#define PREHASH_SIZE 20
+
+// Encrypted body sizes of a subscription update and of a frame in decoder.c
+static const size_t msg_sizes[] = { 48, 80 };
+
+typedef struct {
+    uint8_t key[KEY_LEN];
+    hmac_key_state_t state;
+    uint8_t msg[MAX_MSG_SIZE];
+    size_t len;
+    uint8_t tag[HMAC_LEN];
+} mac_case_t;
+
+static int verify_per_call(void *arg) {
+    mac_case_t *c = arg;
+
+    return hmac_verify(c->msg, c->len, c->tag, c->key, sizeof(c->key));
+}
+
+static int verify_state(void *arg) {
+    mac_case_t *c = arg;
+
+    return hmac_verify_state(&c->state, c->msg, c->len, c->tag);
+}
+
+static int derive_subupdate_key(void *arg) {
+    mac_case_t *c = arg;
+    uint8_t digest[HMAC_LEN];
+
+    sha256_hash(c->msg, PREHASH_SIZE, digest);
+    return 0;
+}
+
+/** @brief Checks hmac_verify_state against hmac_digest for one key.
+ *
+ * @return 0 if every message length verifies and a corrupted tag does not.
+ */
+static int check_key(uint8_t *key, size_t key_size) {
+    hmac_key_state_t state;
+    uint8_t msg[MAX_MSG_SIZE + 1];
+    uint8_t tag[HMAC_LEN];
+
+    for (size_t i = 0; i < sizeof(msg); i++) {
+        msg[i] = (uint8_t)(i * 13 + 1);
+    }
+    if (hmac_key_init(&state, key, key_size) != 0)
+        return -1;
+    for (size_t len = 0; len <= sizeof(msg); len++) {
+        hmac_digest(msg, len, key, key_size, tag);
+        if (hmac_verify_state(&state, msg, len, tag) != 0)
+            return -1;
+        tag[len % HMAC_LEN] ^= 1;
+        if (hmac_verify_state(&state, msg, len, tag) == 0)
+            return -1;
+    }
+    return 0;
+}
+
+/** @brief Checks the midstate verification with a short and a long key.
+ *
+ * @return 0 on success.
+ */
+static int check(void) {
+    uint8_t key[131];  // longer than a block, like RFC 4231 test case 6
+
+    for (size_t i = 0; i < sizeof(key); i++) {
+        key[i] = (uint8_t)(0xAA ^ i);
+    }
+    if (check_key(key, KEY_LEN) != 0 || check_key(key, sizeof(key)) != 0)
+        return -1;
+    return 0;
+}
+
+int main(void) {
+    static mac_case_t mac_case;
+
+    if (check() != 0) {
+        fprintf(stderr, "hmac_verify_state does not match hmac_digest\n");
+        return 1;
+    }
+
+    for (int i = 0; i < KEY_LEN; i++) {
+        mac_case.key[i] = (uint8_t)(0x40 + i);
+    }
+    for (int i = 0; i < MAX_MSG_SIZE; i++) {
+        mac_case.msg[i] = (uint8_t)(i * 7);
+    }
+    if (hmac_key_init(&mac_case.state, mac_case.key, sizeof(mac_case.key)) != 0) {
+        fprintf(stderr, "hmac_key_init failed\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(msg_sizes) / sizeof(msg_sizes[0]); i++) {
+        mac_case.len = msg_sizes[i];
+        hmac_digest(mac_case.msg, mac_case.len, mac_case.key, sizeof(mac_case.key), mac_case.tag);
+        if (bench("hmac_verify", mac_case.len, verify_per_call, &mac_case) != 0 ||
+                bench("hmac_verify_state", mac_case.len, verify_state, &mac_case) != 0) {
+            return 1;
+        }
+    }
+
+    mac_case.len = PREHASH_SIZE;
+    if (bench("subupdate_key_derive", mac_case.len, derive_subupdate_key, &mac_case) != 0) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,10 @@
+# Linux build of this decoder against the MSDK shim, so the host tools can be
+# run against it without a board. See ../../common/msdk_shim/host.mk.
+#
+#   make -f host.mk DECODER_ID=0xdeadbeef WOLFSSL_ROOT=/path/to/wolfssl
+#   MSDK_SHIM_UART=/tmp/design2.pty build/host/decoder
+
+# Generated from ../global.secrets by project.mk
+HOST_PREREQS := inc/global.secrets.h
+
+include ../../common/msdk_shim/host.mk
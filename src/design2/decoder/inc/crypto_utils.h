@@ -8,9 +8,22 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/aes.h>
+#include <wolfssl/wolfcrypt/sha256.h>
+
 #define AES128 16
 #define AES256 32
 
+/**
+ * HMAC-SHA-256 key, expanded into the SHA-256 states after the ipad and opad
+ * blocks. Verifying with it costs two compressions less than hmac_verify.
+ */
+typedef struct {
+    wc_Sha256 inner;
+    wc_Sha256 outer;
+} hmac_key_state_t;
+
 /**
  * @brief Decrypt with AES-128-CBC.
  * 
@@ -26,6 +39,41 @@
  */
 int decrypt_cbc_sym(uint8_t *ciphertext, size_t len, uint8_t *key, int key_size, uint8_t *iv, uint8_t *plaintext, int *pt_len);
 
+/**
+ * @brief Starts an AES-CBC decryption that is fed in pieces.
+ * 
+ * @param aes Pointer to the context to initialize.
+ * @param key Pointer to the decryption key.
+ * @param key_size Size of the decryption key (AES128 or AES256).
+ * @param iv Pointer to the initialization vector.
+ * 
+ * @return 0 on success
+ */
+int decrypt_cbc_init(Aes *aes, uint8_t *key, int key_size, uint8_t *iv);
+
+/**
+ * @brief Decrypts the next whole blocks of a decryption started by decrypt_cbc_init.
+ * 
+ * @param aes Pointer to the context, which carries the chaining value.
+ * @param ciphertext Pointer to the next ciphertext blocks.
+ * @param len Length of the ciphertext, a multiple of the AES block size.
+ * @param plaintext Pointer to the buffer where the decrypted blocks will be stored.
+ * 
+ * @return 0 on success
+ */
+int decrypt_cbc_update(Aes *aes, uint8_t *ciphertext, size_t len, uint8_t *plaintext);
+
+/**
+ * @brief Checks and removes the PKCS#7 padding of a decrypted message.
+ * 
+ * @param plaintext Pointer to the whole decrypted message.
+ * @param len Length of the decrypted message.
+ * @param pt_len Pointer to an integer where the length of the plaintext (excluding padding) will be stored.
+ * 
+ * @return 0 on success
+ */
+int decrypt_cbc_final(uint8_t *plaintext, size_t len, int *pt_len);
+
 /**
  * @brief Hash data with SHA256.
  * 
@@ -59,4 +107,69 @@ void hmac_digest(uint8_t *in, size_t len, uint8_t *key, size_t key_size, uint8_t
  */
 int hmac_verify(uint8_t *data, size_t len, uint8_t *hmac, uint8_t *key, size_t key_size);
 
+/**
+ * HMAC-SHA-256 computation that is fed in pieces.
+ */
+typedef struct {
+    wc_Sha256 sha;
+} hmac_stream_t;
+
+/**
+ * @brief Expands an HMAC-SHA-256 key into its inner and outer midstates.
+ * 
+ * @param state Pointer to the state to initialize.
+ * @param key Pointer to the HMAC key.
+ * @param key_size Size of the HMAC key.
+ * 
+ * @return 0 on success, -1 on failure
+ */
+int hmac_key_init(hmac_key_state_t *state, const uint8_t *key, size_t key_size);
+
+/**
+ * @brief Verifies HMAC signature with a key expanded by hmac_key_init.
+ * 
+ * Same result as hmac_verify with that key. The state is not modified, so it
+ * can be reused for every message.
+ * 
+ * @param state Pointer to the expanded key.
+ * @param data Pointer to the data to be verified.
+ * @param len Length of the data.
+ * @param hmac Pointer to the HMAC signature to be verified.
+ * 
+ * @return 0 on success, -1 on failure
+ */
+int hmac_verify_state(const hmac_key_state_t *state, uint8_t *data, size_t len, uint8_t *hmac);
+
+/**
+ * @brief Starts an HMAC computation from a key expanded by hmac_key_init.
+ * 
+ * @param stream Pointer to the computation to start.
+ * @param state Pointer to the expanded key.
+ * 
+ * @return 0 on success, -1 on failure
+ */
+int hmac_stream_init(hmac_stream_t *stream, const hmac_key_state_t *state);
+
+/**
+ * @brief Adds the next part of the message to an HMAC computation.
+ * 
+ * @param stream Pointer to the computation.
+ * @param data Pointer to the next part of the message.
+ * @param len Length of that part.
+ * 
+ * @return 0 on success, -1 on failure
+ */
+int hmac_stream_update(hmac_stream_t *stream, const uint8_t *data, size_t len);
+
+/**
+ * @brief Finishes an HMAC computation and compares it with a signature in constant time.
+ * 
+ * @param stream Pointer to the computation, which cannot be updated afterwards.
+ * @param state Pointer to the expanded key that started it.
+ * @param hmac Pointer to the HMAC signature to be verified.
+ * 
+ * @return 0 on success, -1 on failure
+ */
+int hmac_stream_verify(hmac_stream_t *stream, const hmac_key_state_t *state, const uint8_t *hmac);
+
 #endif
\ No newline at end of file
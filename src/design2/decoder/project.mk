@@ -56,6 +56,15 @@ IPATH+=../deployment
 IPATH+=inc/
 VPATH+=src/
 
+# Shared host messaging library. In the Docker build, mount src/common at
+# /common, which is where this path resolves from /decoder.
+COMMON_DIR ?= ../../common
+IPATH+=$(COMMON_DIR)/host_messaging
+VPATH+=$(COMMON_DIR)/host_messaging
+# Shared flash driver and the record store that persists subscriptions
+IPATH+=$(COMMON_DIR)/flash_store
+VPATH+=$(COMMON_DIR)/flash_store
+
 # ****************** eCTF Bootloader *******************
 # DO NOT REMOVE
 LINKERFILE=firmware.ld
@@ -12,6 +12,9 @@
 
 #define HMAC_LEN    SHA256_DIGEST_SIZE
 
+#define HMAC_IPAD   0x36
+#define HMAC_OPAD   0x5c
+
 /**
  * Verify and unpad bytes. 
  * 
@@ -36,6 +39,20 @@ static int pkcs7_unpad(uint8_t *in, size_t len, int *pt_len) {
     return 0;
 }
 
+/**
+ * Compare two buffers without an early exit, so that the time taken does not
+ * tell how many leading bytes of a forged signature were right.
+ */
+static int constant_time_compare(const uint8_t *a, const uint8_t *b, size_t len) {
+    uint8_t diff = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        diff |= a[i] ^ b[i];
+    }
+
+    return diff == 0 ? 0 : -1;
+}
+
 int decrypt_cbc_sym(uint8_t *ciphertext, size_t len, uint8_t *key, int key_size, uint8_t *iv, uint8_t *plaintext, int *pt_len) {
     Aes aes;
     int result;
@@ -43,29 +60,47 @@ int decrypt_cbc_sym(uint8_t *ciphertext, size_t len, uint8_t *key, int key_size,
     if (len <= 0)
         return -1;
 
+    result = decrypt_cbc_init(&aes, key, key_size, iv);
+    if (result != 0)
+        return -1;
+
+    result = decrypt_cbc_update(&aes, ciphertext, len, plaintext);
+    if (result != 0) 
+        return -1;
+
+    // Remove padding
+    return decrypt_cbc_final(plaintext, len, pt_len);
+}
+
+int decrypt_cbc_init(Aes *aes, uint8_t *key, int key_size, uint8_t *iv) {
     if (key_size != AES128 && key_size != AES256)
         return -1;
 
     // Init Aes ctx
-    wc_AesInit(&aes, NULL, INVALID_DEVID);
+    wc_AesInit(aes, NULL, INVALID_DEVID);
 
     // Set Aes key
-    result = wc_AesSetKey(&aes, key, key_size, iv, AES_DECRYPTION);
-    if (result != 0)
+    if (wc_AesSetKey(aes, key, key_size, iv, AES_DECRYPTION) != 0)
         return -1;
 
-    result = wc_AesCbcDecrypt(&aes, plaintext, ciphertext, len);
-    if (result != 0) 
-        return -1;
+    return 0;
+}
 
-    // Remove padding
-    result = pkcs7_unpad(plaintext, len, pt_len);
-    if (result != 0) 
+int decrypt_cbc_update(Aes *aes, uint8_t *ciphertext, size_t len, uint8_t *plaintext) {
+    // wc_AesCbcDecrypt keeps the last ciphertext block in aes as the next IV
+    if (wc_AesCbcDecrypt(aes, plaintext, ciphertext, len) != 0)
         return -1;
 
     return 0;
 }
 
+int decrypt_cbc_final(uint8_t *plaintext, size_t len, int *pt_len) {
+    if (len <= 0)
+        return -1;
+
+    return pkcs7_unpad(plaintext, len, pt_len);
+}
+
 void sha256_hash(uint8_t *in, size_t len, uint8_t *digest) {
     wc_Sha256 sha;
     wc_InitSha256(&sha);
@@ -85,8 +120,80 @@ int hmac_verify(uint8_t *data, size_t len, uint8_t *hmac, uint8_t *key, size_t k
 
     hmac_digest(data, len, key, key_size, our_hmac);
 
-    if (memcmp(hmac, our_hmac, HMAC_LEN) != 0)
+    return constant_time_compare(hmac, our_hmac, HMAC_LEN);
+}
+
+int hmac_key_init(hmac_key_state_t *state, const uint8_t *key, size_t key_size) {
+    uint8_t block[WC_SHA256_BLOCK_SIZE];
+    uint8_t key_hash[WC_SHA256_DIGEST_SIZE];
+    int result;
+
+    // Keys longer than a block are hashed first (RFC 2104)
+    if (key_size > WC_SHA256_BLOCK_SIZE) {
+        sha256_hash((uint8_t *)key, key_size, key_hash);
+        key = key_hash;
+        key_size = sizeof(key_hash);
+    }
+
+    memset(block, 0, sizeof(block));
+    memcpy(block, key, key_size);
+    for (int i = 0; i < WC_SHA256_BLOCK_SIZE; i++)
+        block[i] ^= HMAC_IPAD;
+    result = wc_InitSha256(&state->inner);
+    if (result == 0)
+        result = wc_Sha256Update(&state->inner, block, sizeof(block));
+
+    // block ^ ipad ^ opad = key ^ opad
+    for (int i = 0; i < WC_SHA256_BLOCK_SIZE; i++)
+        block[i] ^= HMAC_IPAD ^ HMAC_OPAD;
+    if (result == 0)
+        result = wc_InitSha256(&state->outer);
+    if (result == 0)
+        result = wc_Sha256Update(&state->outer, block, sizeof(block));
+
+    memset(block, 0, sizeof(block));
+    memset(key_hash, 0, sizeof(key_hash));
+    return result == 0 ? 0 : -1;
+}
+
+int hmac_verify_state(const hmac_key_state_t *state, uint8_t *data, size_t len, uint8_t *hmac) {
+    hmac_stream_t stream;
+
+    if (hmac_stream_init(&stream, state) != 0 || hmac_stream_update(&stream, data, len) != 0)
+        return -1;
+
+    return hmac_stream_verify(&stream, state, hmac);
+}
+
+int hmac_stream_init(hmac_stream_t *stream, const hmac_key_state_t *state) {
+    // Resume from H(K ^ ipad ...)
+    if (wc_Sha256Copy((wc_Sha256 *)&state->inner, &stream->sha) != 0)
         return -1;
 
     return 0;
-}
\ No newline at end of file
+}
+
+int hmac_stream_update(hmac_stream_t *stream, const uint8_t *data, size_t len) {
+    if (wc_Sha256Update(&stream->sha, data, len) != 0)
+        return -1;
+
+    return 0;
+}
+
+int hmac_stream_verify(hmac_stream_t *stream, const hmac_key_state_t *state, const uint8_t *hmac) {
+    uint8_t our_hmac[HMAC_LEN];
+    int result;
+
+    // H((K ^ opad) || H((K ^ ipad) || data))
+    result = wc_Sha256Final(&stream->sha, our_hmac);
+    if (result == 0)
+        result = wc_Sha256Copy((wc_Sha256 *)&state->outer, &stream->sha);
+    if (result == 0)
+        result = wc_Sha256Update(&stream->sha, our_hmac, sizeof(our_hmac));
+    if (result == 0)
+        result = wc_Sha256Final(&stream->sha, our_hmac);
+    if (result != 0)
+        return -1;
+
+    return constant_time_compare(hmac, our_hmac, HMAC_LEN);
+}
@@ -13,12 +13,14 @@
 
 /*********************** INCLUDES *************************/
 #include <stdio.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 #include "mxc_device.h"
 #include "status_led.h"
 #include "board.h"
 #include "mxc_delay.h"
+#include "flash_store.h"
 #include "simple_flash.h"
 #include "host_messaging.h"
 
@@ -73,18 +75,8 @@ typedef struct {
 #define EMERGENCY_CHANNEL 0
 #define FRAME_SIZE 64
 #define DEFAULT_CHANNEL_TIMESTAMP 0xFFFFFFFFFFFFFFFF
-// This is a canary value so we can confirm whether this decoder has booted before
-#define FLASH_FIRST_BOOT 0xDEADBEEF
 #define HASH_SIZE 32
 
-/**
- * State Macros
- */
-
-// Calculate the flash address where we will store channel info as the 2nd to last page available
-#define FLASH_STATUS_ADDR ((MXC_FLASH_MEM_BASE + MXC_FLASH_MEM_SIZE) - (2 * MXC_FLASH_PAGE_SIZE))
-
-
 /**********************************************************
  *********** COMMUNICATION PACKET DEFINITIONS *************
  **********************************************************/
@@ -157,11 +149,30 @@ typedef struct {
     channel_key_t key;
 } channel_status_t;
 
+// Each subscription slot is kept in the flash store under its index
 typedef struct {
-    uint32_t first_boot; // if set to FLASH_FIRST_BOOT, device has booted before.
     channel_status_t subscribed_channels[MAX_CHANNEL_COUNT];
 } flash_entry_t;
 
+// Earlier firmware kept every slot in FLASH_STORE_LEGACY_PAGE, behind this canary
+#define FLASH_FIRST_BOOT 0xDEADBEEF
+
+typedef struct {
+    uint32_t first_boot; // if set to FLASH_FIRST_BOOT, earlier firmware wrote the page
+    channel_status_t subscribed_channels[MAX_CHANNEL_COUNT];
+} legacy_flash_entry_t;
+
+// Work on a frame that is done while the frame is still being received
+typedef struct {
+    bool active;       // The packet being received has the size of a frame
+    bool started;      // The channel and IV have arrived and were looked at
+    bool decrypting;   // AES-CBC was started with the channel's key
+    uint16_t done;     // Bytes of encrypted_data MACed (and decrypted) so far
+    hmac_stream_t hmac;
+    Aes aes;
+    frame_packet_payload_t payload;
+} frame_stream_t;
+
 /**
  * Globals
  */
@@ -185,6 +196,13 @@ static const secrets_t secrets = {
     .emergency_key = SECRET_EMERGENCY_KEY,
 };
 
+// Derived from the secrets once at boot, see init_keys()
+static hmac_key_state_t hmac_auth_state;
+static uint8_t subupdate_key[HASH_SIZE];
+
+// Filled in by the receive hooks, see frame_rx_data()
+static frame_stream_t frame_stream;
+
 /**
  * Utility functions
  */
@@ -244,6 +262,80 @@ channel_status_t *find_subscription(channel_id_t channel) {
 }
 
 
+/**
+ * @brief Looks up the AES key that decrypts a channel's frames.
+ * 
+ * @param channel ID of the channel
+ * @param key Set to the key if the channel can be decoded
+ * 
+ * @return 0 if found, -1 if the decoder is not subscribed to the channel
+ */
+int find_channel_key(channel_id_t channel, channel_key_t *key) {
+    if (channel == EMERGENCY_CHANNEL) {
+        memcpy(&key->bytes, secrets.emergency_key, sizeof(secrets.emergency_key));
+        return 0;
+    }
+
+    channel_status_t *channel_status = find_subscription(channel);
+    if (channel_status == NULL) {
+        return -1;
+    }
+    *key = channel_status->key;
+    return 0;
+}
+
+/**
+ * Receive hook: called after a packet header, before its body arrives.
+ */
+void frame_rx_start(void *ctx, msg_type_t cmd, uint16_t len) {
+    frame_stream_t *stream = ctx;
+
+    stream->active = cmd == DECODE_MSG && len == sizeof(frame_packet_t)
+        && hmac_stream_init(&stream->hmac, &hmac_auth_state) == 0;
+    stream->started = false;
+    stream->decrypting = false;
+    stream->done = 0;
+}
+
+/**
+ * Receive hook: MACs and decrypts each block of encrypted_data as soon as it
+ * is in the buffer, so that decode() is left with only the final steps.
+ */
+void frame_rx_data(void *ctx, const uint8_t *body, uint16_t received) {
+    frame_stream_t *stream = ctx;
+    frame_packet_t *frame = (frame_packet_t *)body;
+    const uint16_t data_offset = offsetof(frame_packet_t, encrypted_data);
+
+    if (!stream->active || received < data_offset) {
+        return;
+    }
+
+    // The channel and IV come before the encrypted data
+    if (!stream->started) {
+        channel_key_t key;
+
+        stream->started = true;
+        if (find_channel_key(frame->channel, &key) == 0) {
+            stream->decrypting = decrypt_cbc_init(&stream->aes, key.bytes, AES128, frame->iv.bytes) == 0;
+        }
+        memset(&key, 0, sizeof(key));
+    }
+
+    while (stream->done + AES_BLOCK_SIZE <= received - data_offset) {
+        uint8_t *block = frame->encrypted_data + stream->done;
+
+        if (hmac_stream_update(&stream->hmac, block, AES_BLOCK_SIZE) != 0) {
+            stream->active = false;
+            return;
+        }
+        if (stream->decrypting && decrypt_cbc_update(&stream->aes, block, AES_BLOCK_SIZE,
+                (uint8_t *)&stream->payload + stream->done) != 0) {
+            stream->decrypting = false;
+        }
+        stream->done += AES_BLOCK_SIZE;
+    }
+}
+
 /**********************************************************
  ********************* CORE FUNCTIONS *********************
  **********************************************************/
@@ -289,29 +381,19 @@ int list_channels() {
 int update_subscription(pkt_len_t pkt_len, subscription_update_packet_t *update) {
     int i;
 
-    int hmac_status = hmac_verify(update->encrypted_data, sizeof(update->encrypted_data), update->hmac_signature.bytes, secrets.hmac_auth_key, sizeof(secrets.hmac_auth_key));
+    int hmac_status = hmac_verify_state(&hmac_auth_state, update->encrypted_data, sizeof(update->encrypted_data), update->hmac_signature.bytes);
     if (hmac_status != 0) {
         STATUS_LED_RED();
         print_error("Failed to update subscription - HMAC verification failed\n");
         return -1;
     }
 
-    char prehash[sizeof(decoder_id_t) + sizeof(secrets.subupdate_salt)];
-    char subupdate_key[HASH_SIZE];
     subscription_update_payload_t payload;
     
     // IMPORTANT - Zero out stack variables to prevent stack-based attacks!!!
 #define ZERO_PRIVATES() do { \
-    memset(prehash, 0, sizeof(prehash)); \
-    memset(subupdate_key, 0, sizeof(subupdate_key)); \
     memset(&payload, 0, sizeof(subscription_update_payload_t)); \
 } while (0)
-    
-    ((decoder_id_t *)prehash)[0] = DEVICE_ID;
-    memcpy(prehash + sizeof(decoder_id_t), secrets.subupdate_salt, sizeof(secrets.subupdate_salt));
-
-    // Hash the prehash to get the key
-    sha256_hash(prehash, sizeof(prehash), subupdate_key);
 
     // Decrypt the sub update
     int payload_size;
@@ -362,8 +444,12 @@ int update_subscription(pkt_len_t pkt_len, subscription_update_packet_t *update)
     ZERO_PRIVATES();
 #undef ZERO_PRIVATES
 
-    flash_simple_erase_page(FLASH_STATUS_ADDR);
-    flash_simple_write(FLASH_STATUS_ADDR, &decoder_status, sizeof(flash_entry_t));
+    // Only the slot that changed is written to flash
+    if (flash_store_write(i, &decoder_status.subscribed_channels[i], sizeof(channel_status_t)) != 0) {
+        STATUS_LED_RED();
+        print_error("Failed to update subscription - cannot write flash\n");
+        return -1;
+    }
     // Success message with an empty body
     write_packet(SUBSCRIBE_MSG, NULL, 0);
     print_debug("Subscription successfully decoded!\n");
@@ -399,19 +485,28 @@ int decode(pkt_len_t pkt_len, frame_packet_t *new_frame) {
 #define ZERO_PRIVATES() do { \
     payload_size = 0; \
     memset(&payload, 0, sizeof(frame_packet_payload_t)); \
+    memset(&frame_stream, 0, sizeof(frame_stream_t)); \
 } while (0)
 
     // Frame size is the size of the packet minus the size of non-frame elements
     payload_size = pkt_len - (sizeof(new_frame->channel) + sizeof(new_frame->hmac_signature) + sizeof(new_frame->iv));
     channel = new_frame->channel;
 
+    // Whether the receive hooks already went through all of encrypted_data
+    bool streamed = frame_stream.active && frame_stream.done == sizeof(new_frame->encrypted_data);
+
     // Check that we are subscribed to the channel...
     print_debug("Checking subscription\n");
     if (is_subscribed(channel)) {
         print_debug("Subscription Valid\n");
         
         int result;
-        int hmac_status = hmac_verify(new_frame->encrypted_data, sizeof(new_frame->encrypted_data), new_frame->hmac_signature.bytes, secrets.hmac_auth_key, sizeof(secrets.hmac_auth_key));
+        int hmac_status;
+        if (streamed) {
+            hmac_status = hmac_stream_verify(&frame_stream.hmac, &hmac_auth_state, new_frame->hmac_signature.bytes);
+        } else {
+            hmac_status = hmac_verify_state(&hmac_auth_state, new_frame->encrypted_data, sizeof(new_frame->encrypted_data), new_frame->hmac_signature.bytes);
+        }
         
         if (hmac_status != 0) {
             ZERO_PRIVATES();
@@ -421,31 +516,33 @@ int decode(pkt_len_t pkt_len, frame_packet_t *new_frame) {
         }
 
         channel_key_t key;
-        if (channel == EMERGENCY_CHANNEL) {
-            memcpy(&key.bytes, secrets.emergency_key, sizeof(secrets.emergency_key));
-        } else {
-            channel_status_t *channel_status = find_subscription(channel);
-            if (channel_status == NULL) {
-                ZERO_PRIVATES();
-                STATUS_LED_RED();
-                print_error("Failed to decode - channel not found\n");
-                return -1;
-            }
-            key = channel_status->key;
+        if (find_channel_key(channel, &key) != 0) {
+            ZERO_PRIVATES();
+            STATUS_LED_RED();
+            print_error("Failed to decode - channel not found\n");
+            return -1;
         }
 
         // pt_len is the length of the decrypted payload
         int pt_len;
 
-        result = decrypt_cbc_sym(
-            new_frame->encrypted_data,
-            payload_size, 
-            key.bytes,
-            AES128,
-            new_frame->iv.bytes, 
-            (uint8_t *)&payload, 
-            &pt_len
-        );
+        if (streamed && frame_stream.decrypting) {
+            // Only the padding is left to check
+            memcpy(&payload, &frame_stream.payload, sizeof(frame_packet_payload_t));
+            result = decrypt_cbc_final((uint8_t *)&payload, payload_size, &pt_len);
+        } else {
+            result = decrypt_cbc_sym(
+                new_frame->encrypted_data,
+                payload_size, 
+                key.bytes,
+                AES128,
+                new_frame->iv.bytes, 
+                (uint8_t *)&payload, 
+                &pt_len
+            );
+        }
+        memset(&key, 0, sizeof(key));
+        memset(&frame_stream, 0, sizeof(frame_stream_t));
 
         if (result != 0) {
             ZERO_PRIVATES();
@@ -515,38 +612,74 @@ int decode(pkt_len_t pkt_len, frame_packet_t *new_frame) {
     }
 }
 
+/** @brief Derives the keys that only depend on the secrets and DEVICE_ID.
+ *
+ *  Both are constant for the life of the decoder, so this saves the HMAC
+ *  ipad/opad compressions on every frame and subscription, and the
+ *  sha256(DEVICE_ID || subupdate_salt) on every subscription.
+ *
+ *  @return 0 if successful.  -1 if error.
+*/
+int init_keys() {
+    uint8_t prehash[sizeof(decoder_id_t) + sizeof(secrets.subupdate_salt)];
+
+    if (hmac_key_init(&hmac_auth_state, secrets.hmac_auth_key, sizeof(secrets.hmac_auth_key)) != 0) {
+        return -1;
+    }
+
+    ((decoder_id_t *)prehash)[0] = DEVICE_ID;
+    memcpy(prehash + sizeof(decoder_id_t), secrets.subupdate_salt, sizeof(secrets.subupdate_salt));
+
+    // Hash the prehash to get the key
+    sha256_hash(prehash, sizeof(prehash), subupdate_key);
+    memset(prehash, 0, sizeof(prehash));
+    return 0;
+}
+
 /** @brief Initializes peripherals for system boot.
 */
 void init() {
     int ret;
 
-    // Initialize the flash peripheral to enable access to persistent memory
-    flash_simple_init();
-
-    // Read starting flash values into our flash status struct
-    flash_simple_read(FLASH_STATUS_ADDR, &decoder_status, sizeof(flash_entry_t));
-    if (decoder_status.first_boot != FLASH_FIRST_BOOT) {
-        /* If this is the first boot of this decoder, mark all channels as unsubscribed.
-        *  This data will be persistent across reboots of the decoder. Whenever the decoder
-        *  processes a subscription update, this data will be updated.
-        */
-        print_debug("First boot.  Setting flash...\n");
+    // Initialize the flash peripheral and the store that keeps subscriptions
+    ret = flash_store_init();
+    if (ret < 0) {
+        STATUS_LED_ERROR();
+        // if flash fails to initialize, do not continue to execute
+        while (1);
+    }
 
-        decoder_status.first_boot = FLASH_FIRST_BOOT;
+    /* Read each subscription slot from the flash store. A slot that has never
+    *  been written, e.g. on the first boot of this decoder, is unsubscribed,
+    *  unless earlier firmware left an active subscription for it in its status
+    *  page: that one is copied into the store. Whenever the decoder processes
+    *  a subscription update, the slot's record will be updated.
+    */
+    static legacy_flash_entry_t legacy_status;
+    flash_simple_read(FLASH_STORE_LEGACY_PAGE, &legacy_status, sizeof(legacy_flash_entry_t));
 
-        channel_status_t subscription[MAX_CHANNEL_COUNT];
+    for (int i = 0; i < MAX_CHANNEL_COUNT; i++) {
+        channel_status_t *subscription = &decoder_status.subscribed_channels[i];
 
-        for (int i = 0; i < MAX_CHANNEL_COUNT; i++){
-            subscription[i].start_timestamp = DEFAULT_CHANNEL_TIMESTAMP;
-            subscription[i].end_timestamp = DEFAULT_CHANNEL_TIMESTAMP;
-            subscription[i].active = false;
+        if (flash_store_read(i, subscription, sizeof(channel_status_t)) == sizeof(channel_status_t)) {
+            continue;
         }
+        if (legacy_status.first_boot == FLASH_FIRST_BOOT && legacy_status.subscribed_channels[i].active) {
+            // If the write fails, the slot is still used until the next boot, which retries it
+            *subscription = legacy_status.subscribed_channels[i];
+            flash_store_write(i, subscription, sizeof(channel_status_t));
+        } else {
+            memset(subscription, 0, sizeof(channel_status_t));
+            subscription->start_timestamp = DEFAULT_CHANNEL_TIMESTAMP;
+            subscription->end_timestamp = DEFAULT_CHANNEL_TIMESTAMP;
+            subscription->active = false;
+        }
+    }
 
-        // Write the starting channel subscriptions into flash.
-        memcpy(decoder_status.subscribed_channels, subscription, MAX_CHANNEL_COUNT*sizeof(channel_status_t));
-
-        flash_simple_erase_page(FLASH_STATUS_ADDR);
-        flash_simple_write(FLASH_STATUS_ADDR, &decoder_status, sizeof(flash_entry_t));
+    if (init_keys() != 0) {
+        STATUS_LED_ERROR();
+        // without the keys nothing can be verified, do not continue to execute
+        while (1);
     }
     
     // Initialize the uart peripheral to enable serial I/O
@@ -563,6 +696,13 @@ void init() {
  **********************************************************/
 
 int main(void) {
+    // MAC and decrypt frames block by block while they are received
+    const msg_rx_hooks_t rx_hooks = {
+        .start = frame_rx_start,
+        .data = frame_rx_data,
+        .ctx = &frame_stream,
+        .chunk_size = AES_BLOCK_SIZE,
+    };
     char output_buf[128] = {0};
     uint8_t uart_buf[UART_BUF_MAX];
     msg_type_t cmd;
@@ -580,7 +720,7 @@ int main(void) {
 
         STATUS_LED_GREEN();
 
-        result = read_packet(&cmd, uart_buf, &pkt_len);
+        result = read_packet_streamed(&cmd, uart_buf, sizeof(uart_buf), &pkt_len, &rx_hooks);
 
         if (result < 0) {
             STATUS_LED_ERROR();
@@ -0,0 +1,318 @@
+// Benchmark of the wolfCrypt calls made by the design3 decoder.
+//
+// The measurement loop is the shared one in bench.h, which follows
+// wolfcrypt/benchmark/benchmark.c: every operation is repeated in blocks until
+// at least BENCH_MIN_RUNTIME_SEC has elapsed. Unlike the upstream benchmark,
+// only the exact call sequences used by the decoder are measured (see
+// src/crypto.cpp), on the message sizes the decoder sees:
+//
+//   - wc_ChaCha20Poly1305_Decrypt on 96..208 byte ciphertexts (frames and
+//     subscription updates), and
+//   - wc_ed25519_init / import_public / verify_msg / free on 77..95 byte
+//     messages.
+//
+// For each operation the peak stack depth (by running it on a painted stack
+// of its own) and the peak heap usage of one call (through
+// wolfSSL_SetAllocators) are reported as well. Results are printed as one JSON object per line so that
+// bench_matrix.py can collect them across configurations.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Ed25519 verification is slow: check the elapsed time more often
+#ifndef BENCH_NUM_BLOCKS
+#define BENCH_NUM_BLOCKS 16
+#endif
+#include "bench.h"
+
+#include "wolfssl/wolfcrypt/settings.h"
+#include "wolfssl/wolfcrypt/chacha20_poly1305.h"
+#include "wolfssl/wolfcrypt/ed25519.h"
+#include "wolfssl/wolfcrypt/memory.h"
+
+#ifndef BENCH_STACK_PAINT_SIZE
+#define BENCH_STACK_PAINT_SIZE (16 * 1024)
+#endif
+
+#define STACK_PAINT_BYTE 0xA5
+#define NOINLINE __attribute__((noinline))
+
+static const size_t kChaChaSizes[] = { 96, 144, 208 };
+static const size_t kEdSizes[] = { 77, 86, 95 };
+#define MAX_CHACHA_SIZE 208
+#define MAX_ED_SIZE 95
+
+// ----------------------------------------------------------------------------
+// Heap accounting
+
+typedef struct {
+	size_t size;
+	size_t pad;  // keep the payload 8-byte aligned
+} AllocHeader;
+
+static size_t heap_current;
+static size_t heap_peak;
+
+static void* CountingMalloc(size_t size) {
+	AllocHeader* header = malloc(sizeof(AllocHeader) + size);
+	if (header == NULL) {
+		return NULL;
+	}
+	header->size = size;
+	heap_current += size;
+	if (heap_current > heap_peak) {
+		heap_peak = heap_current;
+	}
+	return header + 1;
+}
+
+static void CountingFree(void* ptr) {
+	if (ptr == NULL) {
+		return;
+	}
+	AllocHeader* header = (AllocHeader*) ptr - 1;
+	heap_current -= header->size;
+	free(header);
+}
+
+static void* CountingRealloc(void* ptr, size_t size) {
+	void* result = CountingMalloc(size);
+	if (result != NULL && ptr != NULL) {
+		size_t old_size = ((AllocHeader*) ptr - 1)->size;
+		memcpy(result, ptr, old_size < size ? old_size : size);
+		CountingFree(ptr);
+	}
+	return result;
+}
+
+// ----------------------------------------------------------------------------
+// Stack accounting
+//
+// The call whose footprint is measured runs on a stack of its own, which is
+// painted beforehand; the bytes no longer holding the paint at the bottom of
+// the region are the ones it used. RunOnStack switches to that stack, calls
+// op(arg) and switches back.
+
+int RunOnStack(bench_op_t op, void* arg, void* stack_top);
+
+#if defined(__x86_64__)
+__asm__(
+	".text\n"
+	".globl RunOnStack\n"
+	".type RunOnStack, @function\n"
+	"RunOnStack:\n"
+	"	pushq %rbp\n"
+	"	movq %rsp, %rbp\n"
+	"	movq %rdx, %rsp\n"
+	"	movq %rdi, %rax\n"
+	"	movq %rsi, %rdi\n"
+	"	call *%rax\n"
+	"	movq %rbp, %rsp\n"
+	"	popq %rbp\n"
+	"	ret\n");
+#elif defined(__aarch64__)
+__asm__(
+	".text\n"
+	".globl RunOnStack\n"
+	".type RunOnStack, %function\n"
+	"RunOnStack:\n"
+	"	stp x29, x30, [sp, #-16]!\n"
+	"	mov x29, sp\n"
+	"	mov sp, x2\n"
+	"	mov x3, x0\n"
+	"	mov x0, x1\n"
+	"	blr x3\n"
+	"	mov sp, x29\n"
+	"	ldp x29, x30, [sp], #16\n"
+	"	ret\n");
+#elif defined(__thumb__)
+__asm__(
+	".text\n"
+	".syntax unified\n"
+	".globl RunOnStack\n"
+	".type RunOnStack, %function\n"
+	".thumb_func\n"
+	"RunOnStack:\n"
+	"	push {r4, lr}\n"
+	"	mov r4, sp\n"
+	"	mov sp, r2\n"
+	"	mov r3, r0\n"
+	"	mov r0, r1\n"
+	"	blx r3\n"
+	"	mov sp, r4\n"
+	"	pop {r4, pc}\n");
+#else
+#error "RunOnStack is not implemented for this architecture"
+#endif
+
+// 16-byte aligned at both ends, as the x86-64 and AArch64 ABIs require
+static uint8_t stack_region[BENCH_STACK_PAINT_SIZE] __attribute__((aligned(16)));
+
+// Runs op(arg) on the painted stack and stores the number of bytes it used.
+static int MeasureStack(bench_op_t op, void* arg, size_t* stack_bytes) {
+	memset(stack_region, STACK_PAINT_BYTE, sizeof(stack_region));
+	int retcode = RunOnStack(op, arg, stack_region + sizeof(stack_region));
+	size_t i = 0;
+	while (i < sizeof(stack_region) && stack_region[i] == STACK_PAINT_BYTE) {
+		i++;
+	}
+	*stack_bytes = sizeof(stack_region) - i;
+	return retcode;
+}
+
+// ----------------------------------------------------------------------------
+// Operations under test
+
+typedef struct {
+	byte key[CHACHA20_POLY1305_AEAD_KEYSIZE];
+	byte iv[CHACHA20_POLY1305_AEAD_IV_SIZE];
+	byte tag[CHACHA20_POLY1305_AEAD_AUTHTAG_SIZE];
+	byte ciphertext[MAX_CHACHA_SIZE];
+	byte plaintext[MAX_CHACHA_SIZE];
+	size_t size;
+} ChaChaCase;
+
+typedef struct {
+	byte public_key[ED25519_PUB_KEY_SIZE];
+	byte signature[ED25519_SIG_SIZE];
+	byte message[MAX_ED_SIZE];
+	size_t size;
+} EdCase;
+
+// Mirrors ChaChaCrypt::Decrypt without the decoys (which are just two more
+// calls to the same function).
+static NOINLINE int ChaChaDecrypt(ChaChaCase* c) {
+	return wc_ChaCha20Poly1305_Decrypt(c->key, c->iv, NULL, 0, c->ciphertext,
+			c->size, c->tag, c->plaintext);
+}
+
+// Mirrors EdCrypt::VerifySignature, including the heap-allocated key object.
+static NOINLINE int EdVerify(EdCase* c) {
+	ed25519_key* key = CountingMalloc(sizeof(ed25519_key));
+	if (key == NULL) {
+		return -1;
+	}
+	wc_ed25519_init(key);
+	int retcode = wc_ed25519_import_public(c->public_key, ED25519_PUB_KEY_SIZE,
+			key);
+	int is_valid = 0;
+	if (retcode == 0) {
+		retcode = wc_ed25519_verify_msg(c->signature, ED25519_SIG_SIZE, c->message,
+				c->size, &is_valid, key);
+	}
+	wc_ed25519_free(key);
+	memset(key, 0, sizeof(ed25519_key));
+	CountingFree(key);
+	return (retcode == 0 && is_valid) ? 0 : -1;
+}
+
+static void FillPattern(byte* data, size_t size, byte seed) {
+	for (size_t i = 0; i < size; i++) {
+		data[i] = (byte) (seed + i * 31);
+	}
+}
+
+static int SetupChaCha(ChaChaCase* c, size_t size) {
+	FillPattern(c->key, sizeof(c->key), 1);
+	FillPattern(c->iv, sizeof(c->iv), 2);
+	FillPattern(c->plaintext, size, 3);
+	c->size = size;
+	return wc_ChaCha20Poly1305_Encrypt(c->key, c->iv, NULL, 0, c->plaintext,
+			size, c->ciphertext, c->tag);
+}
+
+static int SetupEd(EdCase* c, size_t size) {
+	byte seed[ED25519_KEY_SIZE];
+	ed25519_key key;
+	word32 signature_size = ED25519_SIG_SIZE;
+	FillPattern(seed, sizeof(seed), 4);
+	FillPattern(c->message, size, 5);
+	c->size = size;
+
+	int retcode = wc_ed25519_init(&key);
+	if (retcode == 0) {
+		retcode = wc_ed25519_import_private_only(seed, sizeof(seed), &key);
+	}
+	if (retcode == 0) {
+		retcode = wc_ed25519_make_public(&key, c->public_key,
+				sizeof(c->public_key));
+	}
+	if (retcode == 0) {
+		retcode = wc_ed25519_import_private_key(seed, sizeof(seed), c->public_key,
+				sizeof(c->public_key), &key);
+	}
+	if (retcode == 0) {
+		retcode = wc_ed25519_sign_msg(c->message, size, c->signature,
+				&signature_size, &key);
+	}
+	wc_ed25519_free(&key);
+	return retcode;
+}
+
+// ----------------------------------------------------------------------------
+// Runner
+
+static int RunChaCha(void* arg) { return ChaChaDecrypt(arg); }
+static int RunEd(void* arg) { return EdVerify(arg); }
+
+static int Bench(const char* name, size_t size, bench_op_t op, void* arg) {
+	// Footprint of a single call, after one call that resolves lazy bindings
+	// and any other one-time setup. Allocations still held from before the
+	// call are not part of it.
+	int retcode = op(arg);
+	size_t stack_bytes = 0;
+	size_t heap_baseline = heap_current;
+	heap_peak = heap_current;
+	if (retcode == 0) {
+		retcode = MeasureStack(op, arg, &stack_bytes);
+	}
+	size_t heap_bytes = heap_peak - heap_baseline;
+	if (retcode != 0) {
+		fprintf(stderr, "%s(%u) failed: %d\n", name, (unsigned) size, retcode);
+		return retcode;
+	}
+
+	// Throughput
+	bench_result_t result;
+	retcode = bench_run(op, arg, &result);
+	if (retcode != 0) {
+		fprintf(stderr, "%s(%u) failed during timing\n", name, (unsigned) size);
+		return retcode;
+	}
+
+	bench_print_result(name, size, &result);
+	printf(", \"ops_per_sec\": %.3f, \"stack_bytes\": %u, \"heap_bytes\": %u",
+			result.count / result.seconds, (unsigned) stack_bytes,
+			(unsigned) heap_bytes);
+	bench_print_end();
+	return 0;
+}
+
+int main(void) {
+	static ChaChaCase chacha_case;
+	static EdCase ed_case;
+	int retcode = wolfSSL_SetAllocators(CountingMalloc, CountingFree,
+			CountingRealloc);
+	if (retcode != 0) {
+		fprintf(stderr, "wolfSSL_SetAllocators failed: %d\n", retcode);
+		return 1;
+	}
+
+	for (size_t i = 0; i < sizeof(kChaChaSizes) / sizeof(kChaChaSizes[0]); i++) {
+		if (SetupChaCha(&chacha_case, kChaChaSizes[i]) != 0 ||
+				Bench("chacha20_poly1305_decrypt", kChaChaSizes[i], RunChaCha,
+						&chacha_case) != 0) {
+			return 1;
+		}
+	}
+	for (size_t i = 0; i < sizeof(kEdSizes) / sizeof(kEdSizes[0]); i++) {
+		if (SetupEd(&ed_case, kEdSizes[i]) != 0 ||
+				Bench("ed25519_verify", kEdSizes[i], RunEd, &ed_case) != 0) {
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <optional>
+#include <span>
 #include <string_view>
 #include <tuple>
 #include "buffer.h"
@@ -23,6 +24,27 @@ public:
 	// generated keys, before and after the actual decryption operation.
 	static std::optional<SecureString> Decrypt(std::string_view ciphertext,
 			const ChaChaKey& key, const ChaChaIV& iv, const ChaChaTag& auth_tag);
+	// Returns the ciphertext (same length as the plaintext) after encrypting the
+	// given plaintext using the provided key and initialization vector, and
+	// stores the authentication tag in auth_tag.
+	static SecureString Encrypt(std::string_view plaintext, const ChaChaKey& key,
+			const ChaChaIV& iv, ChaChaTag& auth_tag);
+	// Same as Decrypt, but overwrites the ciphertext with the plaintext instead
+	// of allocating any buffers. The authentication tag is checked before
+	// anything is decrypted, so the buffer is left untouched (and false is
+	// returned) on mismatch. The decoy operations only write to a fixed-size
+	// scratch buffer on the stack.
+	static bool DecryptInPlace(std::span<char> buffer, const ChaChaKey& key,
+			const ChaChaIV& iv, const ChaChaTag& auth_tag);
+};
+
+// Utility class for deriving keys from other key material.
+class KeyDerivation {
+public:
+	// Returns a ChaCha20-Poly1305 key derived from the given secret and salt:
+	// the first CHACHA_KEY_SIZE bytes of HMAC-SHA512 keyed with the secret.
+	static ChaChaKey DeriveChaChaKey(std::string_view secret,
+			std::string_view salt);
 };
 
 // Utility class for verifying messages signed with Ed25519.
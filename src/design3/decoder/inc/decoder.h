@@ -3,11 +3,13 @@
 
 #include <memory>
 #include <optional>
+#include <span>
 #include <string_view>
 
 #include "buffer.h"
 #include "channel.h"
 #include "crypto.h"
+#include "message_bus.h"
 #include "secrets.h"
 #include "types.h"
 
@@ -26,8 +28,9 @@ private:
 	// the encrypted subscription message to flash.
 	bool ProcessSubscriptionData(std::string_view data, const SecretData& secrets,
 			bool save_to_flash);
-	// Tries to decode a frame, returning the decoded value on success.
-	std::optional<SecureString> TryDecodeFrame(std::string_view data);
+	// Tries to decode a frame, returning the decoded value on success. The
+	// frame is decrypted in place, and the returned value points into data.
+	std::optional<std::string_view> TryDecodeFrame(std::span<char> data);
 
 	// Processes a List command and returns a response over UART.
 	// The response (opcode L) will include the number of channels that the device
@@ -48,7 +51,23 @@ private:
 	// is monotonically increasing, a response with opcode D will be sent back,
 	// containing the decrypted frame data.
 	// Otherwise, a zero-length response with opcode E will be sent.
-	void DecodeFrame(std::string_view data);
+	// The payload is overwritten with the plaintext and erased afterwards.
+	void DecodeFrame(std::span<char> data);
+
+	// Processes a Negotiate command payload (requested baud rate as a 4-byte
+	// integer, maximum chunk size and feature bits as 2-byte integers,
+	// optionally followed by a 1-byte ACK window) and returns a response over
+	// UART.
+	// The response (opcode N) has the same layout and holds the settings the
+	// decoder switches to: the highest supported baud rate not above the
+	// requested one, the requested chunk size capped at 256 (0 requests 256),
+	// the requested features that are supported, and the window, capped by the
+	// receive buffer size. Windowed ACKs are only granted if every message fits
+	// in the window. The settings take effect from the next command on.
+	// A malformed payload gets a zero-length response with opcode E and leaves
+	// the settings unchanged. Negotiate must not be pipelined with other
+	// commands.
+	void NegotiateLink(std::string_view data);
 public:
 	Decoder() {}
 	~Decoder() {}
@@ -56,6 +75,10 @@ public:
 	// keys stored in SecretData and all subscriptions stored in flash will
 	// be loaded.
 	void Initialize();
+	// Processes a single command that has already been read from UART and
+	// sends the response. Commands other than List, Subscribe, Decode and
+	// Negotiate are answered with an Error response. The body may be modified.
+	void HandleCommand(OpCode op_code, std::span<char> body);
 	// Listens for and processes commands over UART. This function never returns.
 	void RunLoop();
 };
@@ -1,6 +1,8 @@
 #ifndef __MESSAGE_BUS_H__
 #define __MESSAGE_BUS_H__
 
+#include <cstdint>
+#include <span>
 #include <string_view>
 #include <tuple>
 
@@ -12,27 +14,80 @@ namespace ectf {
 // The maximum possible size of any valid command payload (with 16 bytes added
 // as a safety margin).
 constexpr int MAX_INPUT_PAYLOAD_SIZE = 208 + 16;
+// The maximum size of any response payload.
+constexpr int MAX_OUTPUT_PAYLOAD_SIZE = 164;
+
+constexpr int HEADER_SIZE = 4;
+
+// Payloads are sent in chunks of at most this many bytes, each of which is
+// ACKed separately. A Negotiate command can lower the chunk size.
+constexpr int MAX_CHUNK_SIZE = 256;
+constexpr int MIN_CHUNK_SIZE = 16;
+
+// Baud rate used at boot and whenever a negotiated session is abandoned.
+constexpr int DEFAULT_BAUD_RATE = 115200;
+// Baud rates that can be negotiated, in increasing order. All of them divide
+// the 7.3728 MHz IBRO clock that drives the UART.
+constexpr int SUPPORTED_BAUD_RATES[] = {115200, 230400, 460800, 921600};
+
+// Optional protocol features, negotiated as a bit mask.
+constexpr uint16_t FEATURE_BATCHED_FRAMES = 1 << 0;
+constexpr uint16_t FEATURE_WINDOWED_ACK = 1 << 1;
+// Features this decoder is able to enable.
+constexpr uint16_t SUPPORTED_FEATURES = FEATURE_WINDOWED_ACK;
+
+// Size of the buffer that UART input is received into (by an interrupt
+// handler, so that input arriving while a command is processed is kept).
+// Bounds the window that can be granted for windowed ACKs.
+constexpr int RX_BUFFER_SIZE = 2048;
 
 // Enum type describing all possible command types.
 enum class OpCode {
-	Decode, Subscribe, List,
+	Decode, Subscribe, List, Negotiate,
 	Ack, Error, Debug, Unknown
 };
 
+// Parameters of the UART session, see Decoder::NegotiateLink. The defaults
+// are the settings every host can rely on after boot.
+struct LinkSettings {
+	int baud_rate = DEFAULT_BAUD_RATE;
+	int chunk_size = MAX_CHUNK_SIZE;
+	uint16_t features = 0;
+	// With FEATURE_WINDOWED_ACK, the number of headers and chunks the host may
+	// send before it has to wait for an ACK.
+	int window = 1;
+};
+
 // Utility class for sending and receiving messages over UART. Each message
 // consists of:
 // - 4 byte header = '%' character + opcode character + payload size as 2-byte
 //   little endian integer
-// - payload, sent in chunks of 256 bytes (except for last chunk)
+// - payload, sent in chunks of 256 bytes (except for last chunk), or of the
+//   chunk size agreed on with a Negotiate command
 // The protocol being used requires each header or payload chunk to be ACKed by
 // the other side (an ACK is a message with opcode A and length 0).
+// With FEATURE_WINDOWED_ACK, the host may instead send up to a window of
+// headers and chunks (across commands) before waiting, and each ACK carries
+// the number of headers and chunks it acknowledges in its length field. The
+// decoder ACKs when a window is full and at the end of each command. Its own
+// responses go out without waiting for ACKs, since the host can buffer them;
+// the host still sends one ACK per response, which the decoder skips.
 class MessageBus {
 public:
 	// Performs boot time initialization, primarily enabling the console UART
 	// channel (UART0) at baud 115200.
 	static void Initialize();
-	// Reads one message from UART and returns the opcode and payload.
-	static std::tuple<OpCode, SecureString> ReadCommand();
+	// Returns the settings of the current UART session.
+	static const LinkSettings& GetLinkSettings();
+	// Switches to the given settings. Must be called right after the response
+	// announcing them was written. If the next command header does not arrive
+	// correctly within a second, the default settings are restored, so a host
+	// that failed to follow the switch can always fall back to them.
+	static void SetLinkSettings(const LinkSettings& settings);
+	// Reads one message from UART and returns the opcode and payload. The
+	// payload is held in a static buffer, which is only valid (and may be
+	// modified) until the next call.
+	static std::tuple<OpCode, std::span<char>> ReadCommand();
 	// Writes a message with the given opcode and payload to UART.
 	static void WriteResponse(OpCode opcode, std::string_view body);
 	// Returns a Timer that measures the time since the last command was
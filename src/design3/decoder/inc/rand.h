@@ -23,6 +23,9 @@ public:
 	static uint32_t FastRandomRange(uint32_t min, uint32_t max);
 	// Fills the given buffer with random bytes generated using the PRNG.
 	static void FastRandomBuffer(char* buf, int size);
+	// Fills the given buffer with random bytes generated using the TRNG,
+	// without reseeding the PRNG with them (for key material).
+	static void SecureRandomBuffer(char* buf, int size);
 };
 
 }
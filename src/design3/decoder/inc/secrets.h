@@ -9,6 +9,38 @@
 
 namespace ectf {
 
+// Size of the data held by SealedKeys: decoder ID and subscription keys.
+constexpr int SEALED_KEYS_SIZE = 4 + CHACHA_KEY_SIZE + ED_PUBLIC_KEY_SIZE;
+// Size of the per-boot salt the sealing key is derived from.
+constexpr int SEALING_SALT_SIZE = 32;
+
+// Resident copy of the secrets needed to process subscriptions, so that a
+// Subscribe command does not have to decrypt all the firmware secrets again.
+// It is encrypted with ChaCha20-Poly1305 under a key that is never stored:
+// the key is derived, each time it is needed, from the flash key and a salt
+// drawn from the TRNG at boot (SealingSalt), which is kept apart from it.
+//
+// What the seal protects against is a read of this region alone, e.g. SRAM
+// contents that survive a reset or leak through a stray pointer: the keys
+// are only recovered by whoever also has the flash key and the salt. It adds
+// nothing against an attacker who can read the firmware and all of SRAM.
+// On the device it lives in its own SRAM region (.sealed_keys, see
+// firmware.ld), which the startup code leaves alone; it is wiped at boot and
+// on assertion failure instead.
+struct SealedKeys {
+	char iv[CHACHA_IV_SIZE];
+	char tag[CHACHA_TAG_SIZE];
+	char ciphertext[SEALED_KEYS_SIZE];
+	// True once the fields above have been filled in since the last wipe.
+	bool sealed;
+};
+
+// Salt of the current sealing key. Regenerated by every seal; on the device it
+// lives in .bss, away from the sealed keys.
+struct SealingSalt {
+	char salt[SEALING_SALT_SIZE];
+};
+
 // Utility class used to decrypt the secret information stored inside the
 // decoder firmware.
 class SecretData {
@@ -22,13 +54,25 @@ private:
 	// Keys used to decode subscription messages
 	EdPublicKey subscription_public_key_;
 	ChaChaKey subscription_symmetric_key_;
+
+	// Seals the decoder ID and subscription keys into GetSealedKeys(), under a
+	// new sealing key.
+	void Seal() const;
+	// Derives the sealing key from the flash key and GetSealingSalt().
+	static ChaChaKey GetSealingKey();
 public:
 	SecretData() {}
 	~SecretData() {}
 	// Loads all the firmware secrets, using the key returned by GetFlashKey()
 	// and initialization vector returned by GetFlashIV() to decrypt data
-	// returned by GetFlashSecretData().
+	// returned by GetFlashSecretData(). The decoder ID and subscription keys
+	// are then sealed for LoadSubscriptionKeys().
 	void Load();
+	// Loads only the decoder ID and subscription keys, by unsealing the copy
+	// made by the last Load(). Asserts if there is none or it was tampered with.
+	void LoadSubscriptionKeys();
+	// Erases the sealed keys along with the salt of their sealing key.
+	static void WipeSealedKeys();
 
 	DeviceID GetDecoderID() const { return decoder_id_; }
 	const EdPublicKey& GetChannel0PublicKey() const { return channel0_public_key_; }
@@ -44,6 +88,11 @@ extern std::string_view GetFlashKey();
 extern std::string_view GetFlashIV();
 extern std::string_view GetFlashSecretData();
 
+// Return the region holding the sealed keys and the salt of their sealing key.
+// Provided by the platform (src/sealed_keys.cpp on the device).
+extern SealedKeys& GetSealedKeys();
+extern SealingSalt& GetSealingSalt();
+
 }
 
 #endif // __SECRETS_H__
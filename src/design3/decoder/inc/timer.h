@@ -12,9 +12,6 @@ private:
 	// Stores the start time of the timer.
 	uint32_t start_time_micros_;
 
-	// Returns the number of microseconds elapsed since the timer was started.
-	uint32_t GetElapsedMicros() const;
-
 	// Returns a global counter that counts the number of microseconds since
 	// the RTC was started. This number will eventually overflow and wrap around
 	// to 0, so it should only be used to compute differences.
@@ -24,6 +21,8 @@ public:
 	Timer();
 	// Resets the timer, so that its elapsed time becomes zero.
 	void Reset();
+	// Returns the number of microseconds elapsed since the timer was started.
+	uint32_t GetElapsedMicros() const;
 	// Delays execution until the specified number of microseconds have elapsed
 	// since the timer was created.
 	void WaitUntilElapsedMicros(int deadline) const;
@@ -0,0 +1,138 @@
+import argparse
+import json
+import os
+import subprocess
+import sys
+from dataclasses import dataclass, field
+
+# Builds bench/crypto_bench.c once per wolfSSL configuration and architecture,
+# runs it, and collects speed, code size and RAM figures into one JSON table.
+#
+# Usage: python3 py/bench_matrix.py [--arch host arm] [--config NAME ...]
+#                                   [--wolfssl-root DIR] [--output FILE]
+
+BENCH_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'bench')
+
+ARMASM_CFLAGS = ['-DWOLFSSL_ARMASM', '-DWOLFSSL_ARMASM_THUMB2',
+	'-DWOLFSSL_ARMASM_NO_HW_CRYPTO', '-DWOLFSSL_ARMASM_NO_NEON']
+ARMASM_SRCS = ['port/arm/thumb2-chacha.c', 'port/arm/thumb2-chacha-asm.S',
+	'port/arm/thumb2-poly1305.c', 'port/arm/thumb2-poly1305-asm.S',
+	'port/arm/thumb2-curve25519.S', 'port/arm/armv8-sha512.c',
+	'port/arm/thumb2-sha512-asm.S']
+
+@dataclass
+class Config:
+	name: str
+	description: str
+	cflags: list = field(default_factory=list)
+	srcs: list = field(default_factory=list)
+	archs: tuple = ('host', 'arm')
+
+CONFIGS = [
+	Config('baseline', 'Release flags from the decoder Makefile (fe_operations/ge_operations)'),
+	Config('ed25519_small', 'ED25519_SMALL: fe_low_mem/ge_low_mem for Ed25519',
+		['-DED25519_SMALL']),
+	Config('curved25519_small', 'CURVED25519_SMALL: small math for Curve25519 and Ed25519',
+		['-DCURVED25519_SMALL']),
+	Config('sp_cortex_m', 'SP math with Cortex-M assembly (does not touch Ed25519 field math)',
+		['-DWOLFSSL_SP_MATH_ALL', '-DWOLFSSL_SP_ARM_CORTEX_M_ASM'], archs=('arm',)),
+	Config('armasm_thumb2', 'Thumb-2 assembly ports of ChaCha, Poly1305, Curve25519 and SHA-512',
+		ARMASM_CFLAGS, ARMASM_SRCS, archs=('arm',)),
+]
+
+def MakeArgs(config: Config, arch: str, wolfssl_root: str) -> list:
+	return ['make', '-C', BENCH_DIR, '--no-print-directory',
+		'WOLFSSL_ROOT=' + wolfssl_root, 'ARCH=' + arch, 'CONFIG=' + config.name,
+		'CONFIG_CFLAGS=' + ' '.join(config.cflags),
+		'CONFIG_SRCS=' + ' '.join(config.srcs)]
+
+def CodeSize(config: Config, arch: str, wolfssl_root: str) -> dict:
+	# Attribute the symbols that survived --gc-sections to wolfCrypt if they
+	# are defined in one of its objects
+	make_args = MakeArgs(config, arch, wolfssl_root)
+	wolfcrypt_symbols = set(subprocess.run(make_args + ['-s', 'symbols'],
+		check=True, capture_output=True, text=True).stdout.split())
+	nm = 'arm-none-eabi-nm' if arch == 'arm' else 'nm'
+	elf = os.path.join(BENCH_DIR, 'build', arch, config.name, 'crypto_bench.elf')
+	output = subprocess.run([nm, '-S', '--defined-only', elf], check=True,
+		capture_output=True, text=True).stdout
+
+	sizes = {'text': 0, 'rodata': 0, 'data': 0, 'bss': 0}
+	kinds = {'t': 'text', 'r': 'rodata', 'd': 'data', 'b': 'bss'}
+	for line in output.splitlines():
+		parts = line.split()
+		if len(parts) != 4 or parts[3] not in wolfcrypt_symbols:
+			continue
+		kind = kinds.get(parts[2].lower())
+		if kind is not None:
+			sizes[kind] += int(parts[1], 16)
+	sizes['flash'] = sizes['text'] + sizes['rodata'] + sizes['data']
+	sizes['static_ram'] = sizes['data'] + sizes['bss']
+	return sizes
+
+def RunConfig(config: Config, arch: str, wolfssl_root: str, jobs: int) -> dict:
+	make_args = MakeArgs(config, arch, wolfssl_root)
+	print('[%s/%s] building' % (arch, config.name), file=sys.stderr)
+	build = subprocess.run(make_args + ['-j%d' % jobs, 'all'], capture_output=True,
+		text=True)
+	if build.returncode != 0:
+		sys.exit('[%s/%s] build failed:\n%s' % (arch, config.name, build.stderr))
+	print('[%s/%s] running' % (arch, config.name), file=sys.stderr)
+	output = subprocess.run(make_args + ['-s', 'run'], check=True,
+		capture_output=True, text=True).stdout
+	ops = [json.loads(line) for line in output.splitlines() if line.startswith('{')]
+	for op in ops:
+		del op['config']
+	return {
+		'config': config.name,
+		'arch': arch,
+		'description': config.description,
+		'cflags': config.cflags,
+		'code': CodeSize(config, arch, wolfssl_root),
+		'peak_stack_bytes': max(op['stack_bytes'] for op in ops),
+		'peak_heap_bytes': max(op['heap_bytes'] for op in ops),
+		'ops': ops,
+	}
+
+def PrintSummary(results: list):
+	print('%-6s %-20s %8s %8s %8s %10s %10s' % ('arch', 'config', 'flash',
+		'ram', 'stack', 'chacha208', 'ed25519'), file=sys.stderr)
+	for result in results:
+		chacha = [op for op in result['ops'] if op['op'].startswith('chacha')]
+		ed = [op for op in result['ops'] if op['op'].startswith('ed25519')]
+		print('%-6s %-20s %8d %8d %8d %8.1fus %8.1fus' % (result['arch'],
+			result['config'], result['code']['flash'],
+			result['code']['static_ram'], result['peak_stack_bytes'],
+			chacha[-1]['us_per_op'], max(op['us_per_op'] for op in ed)),
+			file=sys.stderr)
+
+def main():
+	parser = argparse.ArgumentParser(description='wolfCrypt configuration matrix benchmark')
+	parser.add_argument('--arch', nargs='+', choices=['host', 'arm'], default=['host'])
+	parser.add_argument('--config', nargs='+', choices=[c.name for c in CONFIGS],
+		help='Configurations to run (default: all that apply to each arch)')
+	parser.add_argument('--wolfssl-root', default='/root/wolfssl-stable')
+	parser.add_argument('--output', help='Write the JSON table here instead of stdout')
+	parser.add_argument('-j', '--jobs', type=int, default=os.cpu_count() or 1)
+	args = parser.parse_args()
+
+	results = []
+	for arch in args.arch:
+		for config in CONFIGS:
+			if arch not in config.archs:
+				continue
+			if args.config and config.name not in args.config:
+				continue
+			results.append(RunConfig(config, arch, os.path.abspath(args.wolfssl_root),
+				args.jobs))
+
+	PrintSummary(results)
+	table = json.dumps({'results': results}, indent=2)
+	if args.output:
+		with open(args.output, 'w') as f:
+			f.write(table + '\n')
+	else:
+		print(table)
+
+if __name__ == '__main__':
+	main()
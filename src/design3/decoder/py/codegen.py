@@ -28,10 +28,8 @@ def Escape(byte_str: bytes) -> str:
 def MakeFunction(func_name: str, data: bytes) -> str:
 	return 'std::string_view %s() { return {"%s", %d}; }\n' % (func_name, Escape(data), len(data))
 
-def main():
-	device_id = int(sys.argv[1], 0)
-	with open('/global.secrets', 'rb') as f:
-		secret_data = pickle.loads(f.read())
+# Returns the flash key, flash IV and encrypted secret blob for one decoder.
+def GenerateSecrets(device_id: int, secret_data: dict) -> tuple:
 	channel0_keys = secret_data['channel_keys'][0]
 	subscription_seed = secret_data['sub_seed']
 	subscription_priv_key = GenerateDeterministicECCKey(subscription_seed, device_id)
@@ -50,14 +48,29 @@ def main():
 	ciphertext, tag = flash_key.encrypt_and_digest(payload)
 	cipher_len = len(ciphertext)
 	secret_string = RandomSalt(50, 80) + cipher_len.to_bytes(2, 'little') + ciphertext + tag + RandomSalt(50, 80)
-	
-	with open('/root/gencode/secret_data.cpp', 'w') as f:
-		f.write('#include <string_view>\n')
-		f.write('namespace ectf {\n')
-		f.write(MakeFunction('GetFlashKey', flash_key_raw))
-		f.write(MakeFunction('GetFlashIV', flash_iv))
-		f.write(MakeFunction('GetFlashSecretData', secret_string))
-		f.write('}\n')
+	return flash_key_raw, flash_iv, secret_string
+
+def GenerateSecretSource(device_id: int, secret_data: dict) -> str:
+	flash_key_raw, flash_iv, secret_string = GenerateSecrets(device_id, secret_data)
+	source = '#include <string_view>\n'
+	source += 'namespace ectf {\n'
+	source += MakeFunction('GetFlashKey', flash_key_raw)
+	source += MakeFunction('GetFlashIV', flash_iv)
+	source += MakeFunction('GetFlashSecretData', secret_string)
+	source += '}\n'
+	return source
+
+def LoadGlobalSecrets(path: str = '/global.secrets') -> dict:
+	with open(path, 'rb') as f:
+		return pickle.loads(f.read())
+
+# Usage: codegen.py <device_id> [output_file]
+def main():
+	device_id = int(sys.argv[1], 0)
+	output_file = sys.argv[2] if len(sys.argv) > 2 else '/root/gencode/secret_data.cpp'
+	source = GenerateSecretSource(device_id, LoadGlobalSecrets())
+	with open(output_file, 'w') as f:
+		f.write(source)
 
 if __name__ == '__main__':
 	main()
@@ -0,0 +1,33 @@
+import argparse
+import sys
+
+import codegen
+
+# Writes the per-decoder secrets for the fleet simulator (sim/decoder_fleet).
+# Each line holds what codegen.py would compile into one decoder's firmware:
+#   <decoder id> <flash key hex> <flash iv hex> <secret data hex>
+#
+# Usage: python3 py/fleet_manifest.py [--secrets FILE] [--first-id ID]
+#                                     [--count N | DECODER_ID ...] > fleet.txt
+
+def main():
+	parser = argparse.ArgumentParser(description='Generate a decoder fleet manifest')
+	parser.add_argument('decoder_ids', nargs='*', help='Decoder IDs (e.g. 0xdeadbeef)')
+	parser.add_argument('--secrets', default='/global.secrets')
+	parser.add_argument('--count', type=int, default=0,
+		help='Generate COUNT consecutive decoder IDs starting at --first-id')
+	parser.add_argument('--first-id', default='0x10000000')
+	args = parser.parse_args()
+
+	device_ids = [int(x, 0) for x in args.decoder_ids]
+	first_id = int(args.first_id, 0)
+	device_ids += range(first_id, first_id + args.count)
+	if not device_ids:
+		sys.exit('No decoder IDs given')
+	secrets = codegen.LoadGlobalSecrets(args.secrets)
+	for device_id in device_ids:
+		flash_key, flash_iv, secret_data = codegen.GenerateSecrets(device_id, secrets)
+		print('0x%08x %s %s %s' % (device_id, flash_key.hex(), flash_iv.hex(), secret_data.hex()))
+
+if __name__ == '__main__':
+	main()
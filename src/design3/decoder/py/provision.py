@@ -0,0 +1,155 @@
+import argparse
+import concurrent.futures
+import json
+import os
+import shutil
+import subprocess
+import sys
+import time
+from typing import Optional
+
+import codegen
+
+# Builds firmware images for many decoder IDs at once.
+#
+# Only secret_data.cpp differs between devices, so the firmware and wolfCrypt
+# are compiled once into a base build directory. Each device then gets its own
+# build directory populated with hard links to the base objects plus a freshly
+# generated secret_data.cpp, and the regular MSDK makefile only has to compile
+# that one file and link. The hard-linked files are passed to make as "old"
+# files (-o) so that it never rewrites them, which would otherwise modify the
+# shared base build through the link.
+#
+# Usage: python3 py/provision.py --out /out [--ids-file FILE] [DECODER_ID ...]
+
+DECODER_DIR = os.path.normpath(os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+PROJECT = 'max78000'
+OUTPUTS = [PROJECT + '.elf', PROJECT + '.bin']
+
+def Make(build_dir: str, gencode_dir: str, debug_mode: int,
+		extra_args: Optional[list] = None):
+	args = ['make', '-C', DECODER_DIR, 'release', 'BUILD_DIR=' + build_dir,
+		'GENCODE_DIR=' + gencode_dir, 'DEBUG_MODE=%d' % debug_mode]
+	if extra_args:
+		args += extra_args
+	result = subprocess.run(args, capture_output=True, text=True)
+	if result.returncode != 0:
+		raise RuntimeError('%s\n%s' % (' '.join(args[:4]), result.stdout + result.stderr))
+
+def WriteSecretSource(gencode_dir: str, device_id: int, secrets: dict):
+	os.makedirs(gencode_dir, exist_ok=True)
+	with open(os.path.join(gencode_dir, 'secret_data.cpp'), 'w') as f:
+		f.write(codegen.GenerateSecretSource(device_id, secrets))
+
+def IsDeviceSpecific(name: str) -> bool:
+	return name.startswith('secret_data.') or name.startswith(PROJECT + '.')
+
+def LinkBaseBuild(base_dir: str, build_dir: str) -> list:
+	linked = []
+	for root, _, files in os.walk(base_dir):
+		target_root = os.path.normpath(os.path.join(build_dir, os.path.relpath(root, base_dir)))
+		os.makedirs(target_root, exist_ok=True)
+		for name in files:
+			if root == base_dir and IsDeviceSpecific(name):
+				continue
+			target = os.path.join(target_root, name)
+			os.link(os.path.join(root, name), target)
+			linked.append(target)
+	return linked
+
+def BuildBase(work_dir: str, secrets: dict, debug_mode: int) -> str:
+	base_dir = os.path.join(work_dir, 'base')
+	gencode_dir = os.path.join(work_dir, 'base_gencode')
+	shutil.rmtree(base_dir, ignore_errors=True)
+	WriteSecretSource(gencode_dir, 0, secrets)
+	Make(base_dir, gencode_dir, debug_mode, ['-j%d' % (os.cpu_count() or 1)])
+	return base_dir
+
+def BuildDevice(device_id: int, base_dir: str, work_dir: str, out_dir: str,
+		secrets: dict, debug_mode: int, keep: bool) -> float:
+	start = time.monotonic()
+	device_dir = os.path.join(work_dir, '%08x' % device_id)
+	build_dir = os.path.join(device_dir, 'build')
+	gencode_dir = os.path.join(device_dir, 'gencode')
+	shutil.rmtree(device_dir, ignore_errors=True)
+
+	linked = LinkBaseBuild(base_dir, build_dir)
+	WriteSecretSource(gencode_dir, device_id, secrets)
+	Make(build_dir, gencode_dir, debug_mode, ['-o' + path for path in linked])
+
+	device_out = os.path.join(out_dir, '%08x' % device_id)
+	os.makedirs(device_out, exist_ok=True)
+	for name in OUTPUTS:
+		shutil.copy(os.path.join(build_dir, name), device_out)
+	if not keep:
+		shutil.rmtree(device_dir)
+	return time.monotonic() - start
+
+def ReadDeviceIds(args) -> list:
+	ids = [int(x, 0) for x in args.decoder_ids]
+	if args.ids_file:
+		with open(args.ids_file) as f:
+			ids += [int(line.split('#')[0], 0) for line in f if line.split('#')[0].strip()]
+	if len(set(ids)) != len(ids):
+		sys.exit('Duplicate decoder IDs')
+	return ids
+
+def main():
+	parser = argparse.ArgumentParser(description='Build firmware images for many decoder IDs')
+	parser.add_argument('decoder_ids', nargs='*', help='Decoder IDs (e.g. 0xdeadbeef)')
+	parser.add_argument('--ids-file', help='File with one decoder ID per line')
+	parser.add_argument('--out', required=True, help='Images are written to OUT/<id>/')
+	parser.add_argument('--work-dir', default=os.path.join(DECODER_DIR, 'build', 'provision'))
+	parser.add_argument('--secrets', default='/global.secrets')
+	parser.add_argument('--debug-mode', type=int, default=int(os.environ.get('DEBUG_MODE') or 0))
+	parser.add_argument('-j', '--jobs', type=int, default=os.cpu_count() or 1)
+	parser.add_argument('--keep', action='store_true', help='Keep per-device build dirs')
+	parser.add_argument('--report', help='Write per-device build times as JSON')
+	args = parser.parse_args()
+
+	device_ids = ReadDeviceIds(args)
+	if not device_ids:
+		sys.exit('No decoder IDs given')
+	secrets = codegen.LoadGlobalSecrets(args.secrets)
+	work_dir = os.path.abspath(args.work_dir)
+	out_dir = os.path.abspath(args.out)
+
+	start = time.monotonic()
+	base_dir = BuildBase(work_dir, secrets, args.debug_mode)
+	base_time = time.monotonic() - start
+	print('base build: %.1fs' % base_time)
+
+	times = {}
+	failures = {}
+	with concurrent.futures.ThreadPoolExecutor(args.jobs) as pool:
+		futures = {pool.submit(BuildDevice, device_id, base_dir, work_dir, out_dir,
+				secrets, args.debug_mode, args.keep): device_id
+			for device_id in device_ids}
+		for future in concurrent.futures.as_completed(futures):
+			device_id = futures[future]
+			try:
+				times[device_id] = future.result()
+				print('%08x: %.2fs' % (device_id, times[device_id]))
+			except Exception as e:
+				failures[device_id] = str(e)
+				print('%08x: FAILED\n%s' % (device_id, e), file=sys.stderr)
+
+	total_time = time.monotonic() - start
+	if times:
+		per_device = sorted(times.values())
+		print('%d images in %.1fs (base %.1fs, per device min %.2fs / median %.2fs / max %.2fs)'
+			% (len(times), total_time, base_time, per_device[0],
+				per_device[len(per_device) // 2], per_device[-1]))
+	if args.report:
+		with open(args.report, 'w') as f:
+			json.dump({
+				'base_seconds': base_time,
+				'total_seconds': total_time,
+				'devices': {'0x%08x' % k: v for k, v in sorted(times.items())},
+				'failures': {'0x%08x' % k: v for k, v in sorted(failures.items())},
+			}, f, indent=2)
+	if failures:
+		sys.exit('%d device builds failed' % len(failures))
+
+if __name__ == '__main__':
+	main()
@@ -0,0 +1,129 @@
+import argparse
+import asyncio
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+# Link protocol checks against the fleet simulator (sim/decoder_fleet) and
+# against the firmware message bus (src/message_bus.cpp, built for the host as
+# sim/decoder_uart), driven by the host library in tools/ectf25. Each check
+# renegotiates the link of a fresh decoder and then sends commands, which must
+# all be answered.
+#
+# Usage: PYTHONPATH=<repo>/tools python3 py/sim_link_test.py --secrets FILE
+#        (or make -C sim test SECRETS=FILE)
+
+from loguru import logger
+
+from ectf25.utils.decoder import (AsyncDecoderIntf, DecoderError, DEFAULT_BAUDRATE,
+	FEATURE_WINDOWED_ACK, MAX_BAUDRATE)
+
+PY_DIR = os.path.dirname(os.path.abspath(__file__))
+DEFAULT_FLEET = os.path.join(PY_DIR, '..', 'sim', 'build', 'decoder_fleet')
+DEFAULT_UART_DECODER = os.path.join(PY_DIR, '..', 'sim', 'build', 'decoder_uart')
+# Seconds for each command, so that a lost header fails instead of hanging
+TIMEOUT = 5
+
+async def ListAfter(decoder: AsyncDecoderIntf, settings: list) -> None:
+	for baudrate, features, window in settings:
+		link = await decoder.negotiate(baudrate, features, window)
+		# The decoder may shrink the window, but must keep the features
+		if link.features != features:
+			raise DecoderError('Decoder settled on %s' % (link,))
+		# Several commands in flight, so a header eaten by the decoder shows up
+		# as a missing response
+		await asyncio.gather(*(decoder.list() for _ in range(4)))
+
+CHECKS = {
+	'windowed to windowed, same baud rate': [
+		(DEFAULT_BAUDRATE, FEATURE_WINDOWED_ACK, 8),
+		(DEFAULT_BAUDRATE, FEATURE_WINDOWED_ACK, 6),
+	],
+	'windowed to windowed, new baud rate': [
+		(DEFAULT_BAUDRATE, FEATURE_WINDOWED_ACK, 8),
+		(MAX_BAUDRATE, FEATURE_WINDOWED_ACK, 8),
+	],
+	'windowed to stop-and-wait and back': [
+		(MAX_BAUDRATE, FEATURE_WINDOWED_ACK, 8),
+		(MAX_BAUDRATE, 0, 1),
+		(MAX_BAUDRATE, FEATURE_WINDOWED_ACK, 8),
+	],
+}
+
+async def RunCheck(port: str, settings: list) -> None:
+	decoder = AsyncDecoderIntf(port, negotiate=False, timeout=TIMEOUT)
+	try:
+		await decoder.open()
+		await ListAfter(decoder, settings)
+	finally:
+		decoder.close()
+
+def WaitForPorts(ports: list) -> None:
+	for _ in range(100):
+		if all(os.path.exists(port) for port in ports):
+			return
+		time.sleep(0.1)
+
+def RunChecks(label: str, ports: list) -> int:
+	failed = 0
+	for (name, settings), port in zip(CHECKS.items(), ports):
+		try:
+			asyncio.run(RunCheck(port, settings))
+			print('PASS %s: %s' % (label, name))
+		except Exception as e:
+			print('FAIL %s: %s: %r' % (label, name, e))
+			failed += 1
+	return failed
+
+def main():
+	parser = argparse.ArgumentParser(description='Check link renegotiation on the simulated decoders')
+	parser.add_argument('--secrets', default='/global.secrets')
+	parser.add_argument('--fleet', default=DEFAULT_FLEET)
+	parser.add_argument('--uart-decoder', default=DEFAULT_UART_DECODER)
+	args = parser.parse_args()
+	logger.remove()
+	logger.add(sys.stderr, level='INFO')
+
+	failed = 0
+	with tempfile.TemporaryDirectory() as work_dir:
+		manifest = os.path.join(work_dir, 'fleet.txt')
+		pty_dir = os.path.join(work_dir, 'pty')
+		os.mkdir(pty_dir)
+		with open(manifest, 'w') as f:
+			subprocess.run([sys.executable, os.path.join(PY_DIR, 'fleet_manifest.py'),
+				'--secrets', args.secrets, '--count', str(len(CHECKS))], stdout=f, check=True)
+
+		fleet = subprocess.Popen([args.fleet, '--manifest', manifest, '--pty-dir', pty_dir,
+			'--no-timing', '--stats-interval', '0'])
+		try:
+			ports = []
+			with open(manifest) as f:
+				for line in f:
+					ports.append(os.path.join(pty_dir, '%08x' % int(line.split()[0], 0)))
+			WaitForPorts(ports)
+			failed += RunChecks('fleet', ports)
+		finally:
+			fleet.terminate()
+			fleet.wait()
+
+		# One process per decoder, as the firmware message bus is a singleton
+		decoders = []
+		try:
+			ports = []
+			for i in range(len(CHECKS)):
+				port = os.path.join(work_dir, 'uart%d' % i)
+				decoders.append(subprocess.Popen([args.uart_decoder, '--manifest', manifest,
+					'--index', str(i), '--pty', port]))
+				ports.append(port)
+			WaitForPorts(ports)
+			failed += RunChecks('firmware message bus', ports)
+		finally:
+			for decoder in decoders:
+				decoder.terminate()
+				decoder.wait()
+	sys.exit(1 if failed else 0)
+
+if __name__ == '__main__':
+	main()
@@ -0,0 +1,51 @@
+// Simulator implementation of Debug (see src/debug.cpp for the firmware
+// version).
+
+#include "debug.h"
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include "instance.h"
+#include "message_bus.h"
+#include "secrets.h"
+#include "system.h"
+
+namespace {
+
+// Infinite recursion guard for Print().
+thread_local bool is_printing_ = false;
+
+}  // namespace
+
+namespace ectf {
+
+// Unlike the firmware, a failed assertion always reboots the instance, even in
+// debug mode: blinking forever would take a worker thread down with it.
+void Debug::AssertImpl(bool expression, std::string_view message) {
+	if (expression) return;
+	sim::Instance* instance = sim::CurrentInstanceOrNull();
+	std::fprintf(stderr, "sim: decoder %08x assertion failed: %.*s\n",
+			instance ? instance->GetDecoderID() : 0, (int) message.size(),
+			message.data());
+	if (!instance) std::abort();
+	SecretData::WipeSealedKeys();
+	Print(message);
+	System::Reboot();
+}
+
+void Debug::PrintImpl(std::string_view message) {
+	if (!IsDebugMode()) return;
+	if (is_printing_) return;
+	is_printing_ = true;
+	MessageBus::WriteResponse(OpCode::Debug, message);
+	is_printing_ = false;
+}
+
+void Debug::SetLedColor(LedColor color) {
+	if (!IsDebugMode()) return;
+	sim::CurrentInstance().SetLedColor(color);
+}
+
+}  // namespace ectf
@@ -0,0 +1,54 @@
+// Simulator implementation of FlashStorage (see src/flash.cpp for the
+// firmware version), using the current instance's flash image. The image
+// holds the last MAX_CHANNELS pages of flash with the same layout as on the
+// device.
+
+#include "flash.h"
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+
+#include "buffer.h"
+#include "channel.h"
+#include "debug.h"
+#include "instance.h"
+#include "message_bus.h"
+
+namespace {
+
+int GetPageOffset(ectf::PageNumber page_num) {
+	ectf::Debug::Assert(page_num < ectf::MAX_CHANNELS);
+	return (ectf::MAX_CHANNELS - 1 - page_num) * ectf::sim::FLASH_PAGE_SIZE;
+}
+
+}  // namespace
+
+namespace ectf {
+
+std::optional<SecureString> FlashStorage::ReadPage(PageNumber page_num) {
+	const sim::Instance& instance = sim::CurrentInstance();
+	const int page_offset = GetPageOffset(page_num);
+	uint16_t length;
+	std::memcpy(&length, instance.ReadFlash(page_offset, sizeof(length)).data(),
+			sizeof(length));
+	// Erased pages are full of FF so length == FFFF means the page is empty,
+	// while 0 length means the page was invalidated.
+	if (length == 0xFFFF || length == 0) return std::nullopt;
+	Debug::Assert(length <= MAX_INPUT_PAYLOAD_SIZE);
+	return SecureString(instance.ReadFlash(page_offset + sizeof(length), length));
+}
+
+void FlashStorage::WritePage(PageNumber page_num, std::string_view data) {
+	const int page_offset = GetPageOffset(page_num);
+	const uint16_t length = data.size();
+	Debug::Assert(length <= MAX_INPUT_PAYLOAD_SIZE,
+			"Flash write size too large");
+	SecureString buffer(length + sizeof(length));
+	std::memcpy(buffer.data(), &length, sizeof(length));
+	std::memcpy(buffer.data() + sizeof(length), data.data(), length);
+	sim::CurrentInstance().WriteFlashPage(page_offset, buffer.GetView());
+}
+
+}  // namespace ectf
@@ -0,0 +1,697 @@
+#include "fleet.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "instance.h"
+#include "message_bus.h"
+#include "protocol.h"
+#include "stats.h"
+
+namespace ectf::sim {
+
+// Where a node is in the command/response cycle (see Fleet::Advance).
+enum class LinkState {
+	// Waiting for a command header
+	Header,
+	// Receiving the command payload
+	Body,
+	// A worker owns the instance
+	Processing,
+	// Sending the responses produced by the command
+	Responding,
+};
+
+// Which ACK the node is waiting for while sending a response.
+enum class AckWait { None, Header, Body };
+
+struct Node {
+	std::unique_ptr<Instance> instance;
+	int index = 0;
+	std::string name;
+	std::string endpoint;
+	std::string pty_link;
+
+	int listen_fd = -1;
+	int fd = -1;
+	int pty_slave_fd = -1;
+	bool want_write = false;
+	std::string in;
+	std::string out;
+
+	LinkState state = LinkState::Processing;
+	bool boot_pending = true;
+	OpCode op_code = OpCode::Unknown;
+	int length = 0;
+	int received = 0;
+	std::string body;
+	Clock::time_point command_start;
+
+	// Filled in by the worker
+	std::vector<Response> produced;
+	double service_micros = 0;
+
+	std::deque<Response> responses;
+	AckWait ack_wait = AckWait::None;
+	// Bytes of the front response's body sent so far
+	int sent = 0;
+	// Headers and chunks received but not ACKed yet (windowed ACKs only)
+	int unacked = 0;
+	OpCode result = OpCode::Unknown;
+
+	InstanceStats stats;
+};
+
+namespace {
+
+// epoll user data: node index in the upper bits, kind in the lowest bits
+constexpr uint64_t KIND_CONNECTION = 0;
+constexpr uint64_t KIND_LISTEN = 1;
+constexpr uint64_t WAKE_TAG = UINT64_MAX;
+
+uint64_t Tag(int index, uint64_t kind) {
+	return ((uint64_t) index << 1) | kind;
+}
+
+double MicrosBetween(Clock::time_point start, Clock::time_point end) {
+	return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+const std::string ACK = EncodeHeader(OpCode::Ack, 0);
+
+bool IsWindowed(const Node& node) {
+	return node.instance->Link().features & FEATURE_WINDOWED_ACK;
+}
+
+}  // namespace
+
+Fleet::Fleet(FleetOptions options) : options_(std::move(options)) {}
+
+Fleet::~Fleet() {
+	for (auto& node : nodes_) {
+		if (node->fd >= 0) close(node->fd);
+		if (node->listen_fd >= 0) close(node->listen_fd);
+		if (node->pty_slave_fd >= 0) close(node->pty_slave_fd);
+		if (!node->pty_link.empty()) unlink(node->pty_link.c_str());
+	}
+	if (epoll_fd_ >= 0) close(epoll_fd_);
+	if (wake_fd_ >= 0) close(wake_fd_);
+}
+
+void Fleet::AddDecoder(DecoderSecrets secrets) {
+	auto node = std::make_unique<Node>();
+	char name[16];
+	std::snprintf(name, sizeof(name), "%08x", secrets.decoder_id);
+	node->name = name;
+	node->index = nodes_.size();
+	std::string flash_path;
+	if (!options_.state_dir.empty()) {
+		flash_path = options_.state_dir + "/" + node->name + ".flash";
+	}
+	node->instance = std::make_unique<Instance>(std::move(secrets), flash_path,
+			options_.timing_enabled);
+	nodes_.push_back(std::move(node));
+}
+
+void Fleet::OpenEndpoint(Node& node) {
+	const int index = node.index;
+	epoll_event event = {};
+	if (options_.tcp_port) {
+		const int port = options_.tcp_port + index;
+		node.listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+		int one = 1;
+		setsockopt(node.listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+		sockaddr_in addr = {};
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(port);
+		if (inet_pton(AF_INET, options_.bind_address.c_str(), &addr.sin_addr) != 1
+				|| bind(node.listen_fd, (sockaddr*) &addr, sizeof(addr)) != 0
+				|| listen(node.listen_fd, 1) != 0) {
+			throw std::runtime_error("cannot listen on port " + std::to_string(port)
+					+ ": " + std::strerror(errno));
+		}
+		node.endpoint = "socket://" + options_.bind_address + ":"
+				+ std::to_string(port);
+		event.events = EPOLLIN;
+		event.data.u64 = Tag(index, KIND_LISTEN);
+		epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, node.listen_fd, &event);
+		return;
+	}
+
+	node.fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+	char slave_name[64];
+	if (node.fd < 0 || grantpt(node.fd) != 0 || unlockpt(node.fd) != 0
+			|| ptsname_r(node.fd, slave_name, sizeof(slave_name)) != 0) {
+		throw std::runtime_error(std::string("cannot allocate pty: ")
+				+ std::strerror(errno));
+	}
+	// Keep the slave side open so the master never sees a hangup when clients
+	// come and go, and make it raw so the protocol bytes pass through as-is.
+	node.pty_slave_fd = open(slave_name, O_RDWR | O_NOCTTY);
+	termios tio;
+	if (node.pty_slave_fd < 0 || tcgetattr(node.pty_slave_fd, &tio) != 0) {
+		throw std::runtime_error(std::string("cannot open ") + slave_name);
+	}
+	cfmakeraw(&tio);
+	tcsetattr(node.pty_slave_fd, TCSANOW, &tio);
+	node.endpoint = slave_name;
+	if (!options_.pty_dir.empty()) {
+		node.pty_link = options_.pty_dir + "/" + node.name;
+		unlink(node.pty_link.c_str());
+		if (symlink(slave_name, node.pty_link.c_str()) != 0) {
+			throw std::runtime_error("cannot create " + node.pty_link);
+		}
+		node.endpoint = node.pty_link;
+	}
+	event.events = EPOLLIN;
+	event.data.u64 = Tag(index, KIND_CONNECTION);
+	epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, node.fd, &event);
+}
+
+void Fleet::WorkerLoop() {
+	while (true) {
+		Node* node;
+		{
+			std::unique_lock lock(jobs_mutex_);
+			jobs_cv_.wait(lock, [this] { return workers_exit_ || !jobs_.empty(); });
+			if (workers_exit_) return;
+			node = jobs_.front();
+			jobs_.pop_front();
+		}
+		const Clock::time_point start = Clock::now();
+		if (node->boot_pending) {
+			node->instance->PowerOn();
+		} else {
+			node->instance->Execute(node->op_code, node->body);
+		}
+		node->produced = node->instance->TakeResponses();
+		node->service_micros = MicrosBetween(start, Clock::now());
+		{
+			std::lock_guard lock(done_mutex_);
+			done_.push_back(node);
+		}
+		const uint64_t one = 1;
+		if (write(wake_fd_, &one, sizeof(one)) < 0) {}
+	}
+}
+
+void Fleet::Submit(Node* node) {
+	node->state = LinkState::Processing;
+	{
+		std::lock_guard lock(jobs_mutex_);
+		jobs_.push_back(node);
+	}
+	jobs_cv_.notify_one();
+}
+
+void Fleet::HandleCompletions() {
+	std::vector<Node*> done;
+	{
+		std::lock_guard lock(done_mutex_);
+		done.swap(done_);
+	}
+	const Clock::time_point now = Clock::now();
+	for (Node* node : done) {
+		if (node->boot_pending) {
+			node->boot_pending = false;
+			node->state = LinkState::Header;
+		} else {
+			node->stats.service_time.Add(node->service_micros);
+			node->result = OpCode::Unknown;
+			for (const Response& response : node->produced) {
+				if (response.op_code != OpCode::Debug) {
+					node->result = response.op_code;
+					break;
+				}
+			}
+			node->responses.assign(std::make_move_iterator(node->produced.begin()),
+					std::make_move_iterator(node->produced.end()));
+			node->state = LinkState::Responding;
+			node->ack_wait = AckWait::None;
+		}
+		node->produced.clear();
+		node->body.clear();
+		if (node->fd < 0) {
+			// Nobody to talk to (TCP client went away while processing)
+			node->responses.clear();
+			node->state = LinkState::Header;
+			SwitchLink(*node);
+		}
+		Advance(*node, now);
+	}
+}
+
+void Fleet::Accept(Node& node) {
+	int fd = accept4(node.listen_fd, nullptr, nullptr, SOCK_NONBLOCK);
+	if (fd < 0) return;
+	int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	// The newest client wins, like replugging a serial cable
+	if (node.fd >= 0) Disconnect(node);
+	node.fd = fd;
+	epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.u64 = Tag(node.index, KIND_CONNECTION);
+	epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+}
+
+void Fleet::Disconnect(Node& node) {
+	epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, node.fd, nullptr);
+	close(node.fd);
+	node.fd = -1;
+	node.want_write = false;
+	node.in.clear();
+	node.out.clear();
+	if (node.state != LinkState::Processing) {
+		node.responses.clear();
+		node.ack_wait = AckWait::None;
+		node.state = LinkState::Header;
+		SwitchLink(node);
+	}
+}
+
+void Fleet::HandleReadable(Node& node) {
+	char buf[4096];
+	while (true) {
+		ssize_t n = read(node.fd, buf, sizeof(buf));
+		if (n > 0) {
+			node.in.append(buf, n);
+			continue;
+		}
+		if (n == 0 && node.listen_fd >= 0) {
+			Disconnect(node);
+			return;
+		}
+		if (n < 0 && errno == EINTR) continue;
+		break;
+	}
+	Advance(node, Clock::now());
+}
+
+void Fleet::HandleWritable(Node& node) {
+	Send(node, "");
+}
+
+void Fleet::Send(Node& node, std::string_view data) {
+	if (node.fd < 0) return;
+	node.out.append(data);
+	while (!node.out.empty()) {
+		ssize_t n = write(node.fd, node.out.data(), node.out.size());
+		if (n > 0) {
+			node.out.erase(0, n);
+		} else if (n < 0 && errno == EINTR) {
+			continue;
+		} else {
+			break;
+		}
+	}
+	const bool want_write = !node.out.empty();
+	if (want_write != node.want_write) {
+		node.want_write = want_write;
+		epoll_event event = {};
+		event.events = EPOLLIN | (want_write ? EPOLLOUT : 0);
+		event.data.u64 = Tag(node.index, KIND_CONNECTION);
+		epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, node.fd, &event);
+	}
+}
+
+void Fleet::FinishCommand(Node& node, Clock::time_point now) {
+	InstanceStats& stats = node.stats;
+	stats.commands++;
+	switch (node.op_code) {
+	case OpCode::Decode:
+		stats.decode_latency.Add(MicrosBetween(node.command_start, now));
+		(node.result == OpCode::Decode ? stats.decodes : stats.decode_errors)++;
+		break;
+	case OpCode::Subscribe:
+		(node.result == OpCode::Subscribe ? stats.subscribes : stats.subscribe_errors)++;
+		break;
+	case OpCode::List:
+		stats.lists++;
+		break;
+	default:
+		stats.other_commands++;
+	}
+	node.state = LinkState::Header;
+	SwitchLink(node);
+}
+
+void Fleet::AckReceived(Node& node, bool last) {
+	if (!IsWindowed(node)) {
+		Send(node, ACK);
+		return;
+	}
+	node.unacked++;
+	if (last || node.unacked >= node.instance->Link().window) {
+		Send(node, EncodeHeader(OpCode::Ack, node.unacked));
+		node.unacked = 0;
+	}
+}
+
+void Fleet::SwitchLink(Node& node) {
+	std::optional<LinkSettings>& pending = node.instance->PendingLink();
+	if (!pending) return;
+	node.instance->Link() = *pending;
+	node.unacked = 0;
+	pending.reset();
+}
+
+// Mirrors MessageBus::ReadCommand and MessageBus::WriteResponse in
+// src/message_bus.cpp, but driven by whatever input is available instead of
+// blocking on the UART.
+void Fleet::Advance(Node& node, Clock::time_point now) {
+	while (true) {
+		switch (node.state) {
+		case LinkState::Header: {
+			std::optional<Header> header = ConsumeHeader(node.in);
+			if (!header) return;
+			if (header->op_code == OpCode::Ack) {
+				// The host's ACK for an earlier response
+				break;
+			}
+			node.op_code = header->op_code;
+			node.length = header->length;
+			node.received = 0;
+			node.body.clear();
+			node.command_start = now;
+			node.instance->CommandTimer().Reset();
+			AckReceived(node, node.length == 0 || node.op_code == OpCode::Negotiate);
+			if (node.length == 0) {
+				Submit(&node);
+				return;
+			}
+			node.state = LinkState::Body;
+			break;
+		}
+		case LinkState::Body: {
+			// ACK each chunk. Oversized payloads are read and discarded, and the
+			// command is processed as if the payload was empty.
+			const int chunk_size = node.instance->Link().chunk_size;
+			const int chunk_end = std::min(node.length,
+					(node.received / chunk_size + 1) * chunk_size);
+			const int take = std::min<int>(chunk_end - node.received, node.in.size());
+			if (take == 0) return;
+			if (node.length <= MAX_INPUT_PAYLOAD_SIZE) {
+				node.body.append(node.in, 0, take);
+			}
+			node.in.erase(0, take);
+			node.received += take;
+			if (node.received == chunk_end) {
+				AckReceived(node, node.received == node.length);
+			}
+			if (node.received == node.length) {
+				Submit(&node);
+				return;
+			}
+			break;
+		}
+		case LinkState::Processing:
+			return;
+		case LinkState::Responding: {
+			if (node.ack_wait != AckWait::None) {
+				std::optional<Header> header = ConsumeHeader(node.in);
+				if (!header) return;
+				if (header->op_code != OpCode::Ack) {
+					node.stats.aborted_responses++;
+					node.responses.clear();
+					node.ack_wait = AckWait::None;
+				} else if (node.sent < (int) node.responses.front().body.size()) {
+					const std::string& body = node.responses.front().body;
+					const int chunk = std::min<int>(node.instance->Link().chunk_size,
+							body.size() - node.sent);
+					Send(node, std::string_view(body).substr(node.sent, chunk));
+					node.sent += chunk;
+					node.ack_wait = AckWait::Body;
+				} else {
+					node.ack_wait = AckWait::None;
+					node.responses.pop_front();
+				}
+				break;
+			}
+			if (node.responses.empty()) {
+				FinishCommand(node, now);
+				break;
+			}
+			const Response& response = node.responses.front();
+			if (now < response.not_before) return;
+			Send(node, EncodeHeader(response.op_code, response.body.size()));
+			node.sent = 0;
+			if (response.op_code == OpCode::Debug || IsWindowed(node)) {
+				// Debug messages are not ACKed, and with windowed ACKs the decoder
+				// does not wait for the host's ACK
+				Send(node, response.body);
+				node.responses.pop_front();
+			} else {
+				node.ack_wait = AckWait::Header;
+			}
+			break;
+		}
+		}
+	}
+}
+
+int Fleet::NextTimeoutMillis(Clock::time_point now) {
+	Clock::time_point next = now + std::chrono::milliseconds(100);
+	for (auto& node : nodes_) {
+		if (node->state == LinkState::Responding && node->ack_wait == AckWait::None
+				&& !node->responses.empty()) {
+			next = std::min(next, node->responses.front().not_before);
+		}
+	}
+	if (next <= now) return 0;
+	// Round up so we do not wake up just before the deadline
+	return (std::chrono::duration_cast<std::chrono::microseconds>(next - now)
+			.count() + 999) / 1000;
+}
+
+void Fleet::PrintStats(double elapsed, uint64_t& last_decodes,
+		double& last_elapsed) {
+	InstanceStats total;
+	for (auto& node : nodes_) {
+		total.Merge(node->stats);
+	}
+	const uint64_t decodes = total.decodes + total.decode_errors;
+	const double rate = (decodes - last_decodes) / std::max(elapsed - last_elapsed,
+			1e-9);
+	std::fprintf(stderr, "[%7.1fs] decodes %llu (%.1f/s) errors %llu "
+			"subscribes %llu/%llu | latency p50 %.1fms p99 %.1fms "
+			"| service p50 %.2fms p99 %.2fms\n", elapsed,
+			(unsigned long long) decodes, rate,
+			(unsigned long long) total.decode_errors,
+			(unsigned long long) total.subscribes,
+			(unsigned long long) (total.subscribes + total.subscribe_errors),
+			total.decode_latency.Percentile(50) / 1000,
+			total.decode_latency.Percentile(99) / 1000,
+			total.service_time.Percentile(50) / 1000,
+			total.service_time.Percentile(99) / 1000);
+	last_decodes = decodes;
+	last_elapsed = elapsed;
+}
+
+namespace {
+
+void WriteStatsJson(FILE* f, const InstanceStats& stats, double elapsed) {
+	const uint64_t decodes = stats.decodes + stats.decode_errors;
+	std::fprintf(f, "\"commands\": %llu, \"decodes\": %llu, "
+			"\"decode_errors\": %llu, \"subscribes\": %llu, "
+			"\"subscribe_errors\": %llu, \"lists\": %llu, \"other_commands\": %llu, "
+			"\"aborted_responses\": %llu, \"decodes_per_sec\": %.3f, "
+			"\"decode_latency_ms\": {\"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, "
+			"\"p99\": %.3f, \"max\": %.3f}, "
+			"\"service_time_ms\": {\"mean\": %.3f, \"p50\": %.3f, \"p99\": %.3f, "
+			"\"max\": %.3f}",
+			(unsigned long long) stats.commands, (unsigned long long) stats.decodes,
+			(unsigned long long) stats.decode_errors,
+			(unsigned long long) stats.subscribes,
+			(unsigned long long) stats.subscribe_errors,
+			(unsigned long long) stats.lists,
+			(unsigned long long) stats.other_commands,
+			(unsigned long long) stats.aborted_responses,
+			elapsed > 0 ? decodes / elapsed : 0,
+			stats.decode_latency.Mean() / 1000,
+			stats.decode_latency.Percentile(50) / 1000,
+			stats.decode_latency.Percentile(90) / 1000,
+			stats.decode_latency.Percentile(99) / 1000,
+			stats.decode_latency.Max() / 1000,
+			stats.service_time.Mean() / 1000,
+			stats.service_time.Percentile(50) / 1000,
+			stats.service_time.Percentile(99) / 1000,
+			stats.service_time.Max() / 1000);
+}
+
+}  // namespace
+
+void Fleet::WriteReport(double elapsed) {
+	InstanceStats total;
+	std::fprintf(stderr, "%-10s %9s %9s %9s %9s %9s %8s\n", "decoder",
+			"commands", "decodes", "errors", "p50 ms", "p99 ms", "reboots");
+	for (auto& node : nodes_) {
+		const InstanceStats& stats = node->stats;
+		total.Merge(stats);
+		if (stats.commands == 0) continue;
+		std::fprintf(stderr, "%-10s %9llu %9llu %9llu %9.1f %9.1f %8d\n",
+				node->name.c_str(), (unsigned long long) stats.commands,
+				(unsigned long long) stats.decodes,
+				(unsigned long long) stats.decode_errors,
+				stats.decode_latency.Percentile(50) / 1000,
+				stats.decode_latency.Percentile(99) / 1000,
+				node->instance->GetRebootCount());
+	}
+	std::fprintf(stderr, "%-10s %9llu %9llu %9llu %9.1f %9.1f\n", "total",
+			(unsigned long long) total.commands, (unsigned long long) total.decodes,
+			(unsigned long long) total.decode_errors,
+			total.decode_latency.Percentile(50) / 1000,
+			total.decode_latency.Percentile(99) / 1000);
+
+	if (options_.stats_json.empty()) return;
+	FILE* f = std::fopen(options_.stats_json.c_str(), "w");
+	if (!f) {
+		std::perror(options_.stats_json.c_str());
+		return;
+	}
+	std::fprintf(f, "{\"elapsed_seconds\": %.3f, \"instances\": %zu, "
+			"\"workers\": %d, \"timing_enabled\": %s,\n\"aggregate\": {", elapsed,
+			nodes_.size(), options_.workers,
+			options_.timing_enabled ? "true" : "false");
+	WriteStatsJson(f, total, elapsed);
+	std::fprintf(f, "},\n\"per_instance\": [\n");
+	for (size_t i = 0; i < nodes_.size(); i++) {
+		const Node& node = *nodes_[i];
+		std::fprintf(f, "  {\"decoder_id\": \"0x%s\", \"endpoint\": \"%s\", "
+				"\"reboots\": %d, \"alive\": %s, \"baud_rate\": %d, "
+				"\"chunk_size\": %d, ", node.name.c_str(),
+				node.endpoint.c_str(), node.instance->GetRebootCount(),
+				node.instance->IsAlive() ? "true" : "false",
+				node.instance->Link().baud_rate, node.instance->Link().chunk_size);
+		WriteStatsJson(f, node.stats, elapsed);
+		std::fprintf(f, "}%s\n", i + 1 < nodes_.size() ? "," : "");
+	}
+	std::fprintf(f, "]}\n");
+	std::fclose(f);
+}
+
+int Fleet::Run() {
+	epoll_fd_ = epoll_create1(0);
+	wake_fd_ = eventfd(0, EFD_NONBLOCK);
+	epoll_event wake_event = {};
+	wake_event.events = EPOLLIN;
+	wake_event.data.u64 = WAKE_TAG;
+	epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &wake_event);
+
+	try {
+		for (auto& node : nodes_) {
+			OpenEndpoint(*node);
+		}
+	} catch (const std::exception& e) {
+		std::fprintf(stderr, "sim: %s\n", e.what());
+		return 1;
+	}
+	for (auto& node : nodes_) {
+		std::printf("0x%s %s\n", node->name.c_str(), node->endpoint.c_str());
+	}
+	std::fflush(stdout);
+
+	for (int i = 0; i < options_.workers; i++) {
+		workers_.emplace_back([this] { WorkerLoop(); });
+	}
+	for (auto& node : nodes_) {
+		Submit(node.get());
+	}
+
+	const Clock::time_point start = Clock::now();
+	Clock::time_point next_stats = start
+			+ std::chrono::duration_cast<Clock::duration>(
+					std::chrono::duration<double>(options_.stats_interval));
+	uint64_t last_decodes = 0;
+	double last_elapsed = 0;
+	std::vector<epoll_event> events(256);
+	while (!stopping_) {
+		Clock::time_point now = Clock::now();
+		int timeout = NextTimeoutMillis(now);
+		if (options_.stats_interval > 0) {
+			timeout = std::min<int>(timeout, std::max<int64_t>(0,
+					std::chrono::duration_cast<std::chrono::milliseconds>(
+							next_stats - now).count()));
+		}
+		int n = epoll_wait(epoll_fd_, events.data(), events.size(), timeout);
+		if (n < 0 && errno != EINTR) {
+			std::perror("epoll_wait");
+			break;
+		}
+		for (int i = 0; i < n; i++) {
+			const uint64_t tag = events[i].data.u64;
+			if (tag == WAKE_TAG) {
+				uint64_t value;
+				if (read(wake_fd_, &value, sizeof(value)) < 0) {}
+				HandleCompletions();
+				continue;
+			}
+			Node& node = *nodes_[tag >> 1];
+			if ((tag & 1) == KIND_LISTEN) {
+				Accept(node);
+				continue;
+			}
+			if (node.fd < 0) continue;
+			if (events[i].events & EPOLLOUT) HandleWritable(node);
+			if (node.fd >= 0 && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+				HandleReadable(node);
+			}
+		}
+		// Release responses whose padding has elapsed
+		now = Clock::now();
+		for (auto& node : nodes_) {
+			if (node->state == LinkState::Responding
+					&& node->ack_wait == AckWait::None) {
+				Advance(*node, now);
+			}
+		}
+		if (options_.stats_interval > 0 && now >= next_stats) {
+			PrintStats(std::chrono::duration<double>(now - start).count(),
+					last_decodes, last_elapsed);
+			next_stats += std::chrono::duration_cast<Clock::duration>(
+					std::chrono::duration<double>(options_.stats_interval));
+		}
+	}
+
+	{
+		std::lock_guard lock(jobs_mutex_);
+		workers_exit_ = true;
+	}
+	jobs_cv_.notify_all();
+	for (std::thread& worker : workers_) {
+		worker.join();
+	}
+	WriteReport(std::chrono::duration<double>(Clock::now() - start).count());
+	return 0;
+}
+
+void Fleet::Stop() {
+	stopping_ = true;
+	const uint64_t one = 1;
+	if (write(wake_fd_, &one, sizeof(one)) < 0) {}
+}
+
+}  // namespace ectf::sim
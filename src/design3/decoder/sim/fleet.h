@@ -0,0 +1,97 @@
+#ifndef __SIM_FLEET_H__
+#define __SIM_FLEET_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "instance.h"
+#include "stats.h"
+
+namespace ectf::sim {
+
+struct FleetOptions {
+	// Number of worker threads running decoder code.
+	int workers = 1;
+	// If set, each decoder gets a pty with a symlink <pty_dir>/<decoder id>.
+	std::string pty_dir;
+	// If non-zero, decoder i listens on TCP port tcp_port + i instead.
+	int tcp_port = 0;
+	std::string bind_address = "127.0.0.1";
+	// If set, flash images are persisted as <state_dir>/<decoder id>.flash.
+	std::string state_dir;
+	// Simulate the decoder's constant-time response padding.
+	bool timing_enabled = true;
+	// Seconds between aggregate stats lines (0 to disable).
+	double stats_interval = 5;
+	// If set, the final per-instance and aggregate stats are written here.
+	std::string stats_json;
+};
+
+struct Node;
+
+// Hosts many simulated decoders in one process. A single I/O thread owns
+// every endpoint and speaks the UART protocol (headers, chunking, ACKs) on
+// each decoder's behalf; complete commands are handed to a pool of worker
+// threads which run them through the decoder code. An instance is never
+// given to two workers at once, but any worker may pick up any instance.
+class Fleet {
+private:
+	FleetOptions options_;
+	std::vector<std::unique_ptr<Node>> nodes_;
+	int epoll_fd_ = -1;
+	// Signals the I/O thread: completed jobs or a stop request
+	int wake_fd_ = -1;
+	std::atomic<bool> stopping_ = false;
+
+	// Work queue (I/O thread -> workers)
+	std::mutex jobs_mutex_;
+	std::condition_variable jobs_cv_;
+	std::deque<Node*> jobs_;
+	bool workers_exit_ = false;
+	std::vector<std::thread> workers_;
+
+	// Completion queue (workers -> I/O thread)
+	std::mutex done_mutex_;
+	std::vector<Node*> done_;
+
+	void OpenEndpoint(Node& node);
+	void WorkerLoop();
+	void Submit(Node* node);
+	void HandleCompletions();
+	void HandleReadable(Node& node);
+	void HandleWritable(Node& node);
+	void Accept(Node& node);
+	void Disconnect(Node& node);
+	// Runs the protocol state machine of a node as far as its input allows.
+	void Advance(Node& node, Clock::time_point now);
+	void Send(Node& node, std::string_view data);
+	void FinishCommand(Node& node, Clock::time_point now);
+	// ACKs a received header or chunk as the node's link settings require.
+	void AckReceived(Node& node, bool last);
+	// Applies settings requested by a Negotiate command once its response is
+	// out (or was dropped).
+	void SwitchLink(Node& node);
+	int NextTimeoutMillis(Clock::time_point now);
+	void PrintStats(double elapsed, uint64_t& last_decodes, double& last_elapsed);
+	void WriteReport(double elapsed);
+public:
+	explicit Fleet(FleetOptions options);
+	~Fleet();
+	// Adds a decoder. Must be called before Run.
+	void AddDecoder(DecoderSecrets secrets);
+	// Boots all decoders, opens their endpoints and serves them until Stop()
+	// is called. Returns nonzero on setup failure.
+	int Run();
+	// Async-signal-safe.
+	void Stop();
+};
+
+}
+
+#endif // __SIM_FLEET_H__
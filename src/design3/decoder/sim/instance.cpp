@@ -0,0 +1,159 @@
+#include "instance.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "channel.h"
+#include "debug.h"
+#include "decoder.h"
+#include "rand.h"
+
+namespace {
+
+thread_local ectf::sim::Instance* current_instance_ = nullptr;
+
+// Number of consecutive reboots after which an instance is considered dead
+// (e.g. because its flash holds data that makes Initialize assert).
+constexpr int MAX_BOOT_ATTEMPTS = 3;
+
+}  // namespace
+
+namespace ectf::sim {
+
+Instance& CurrentInstance() {
+	if (!current_instance_) {
+		std::fprintf(stderr, "sim: platform call outside of a decoder instance\n");
+		std::abort();
+	}
+	return *current_instance_;
+}
+
+Instance* CurrentInstanceOrNull() {
+	return current_instance_;
+}
+
+ScopedInstance::ScopedInstance(Instance* instance)
+		: previous_(current_instance_) {
+	current_instance_ = instance;
+}
+
+ScopedInstance::~ScopedInstance() {
+	current_instance_ = previous_;
+}
+
+Instance::Instance(DecoderSecrets secrets, std::string flash_path,
+		bool timing_enabled)
+		: secrets_(std::move(secrets)),
+			flash_(MAX_CHANNELS * FLASH_PAGE_SIZE, 0xFF),
+			flash_path_(std::move(flash_path)),
+			timing_enabled_(timing_enabled) {
+	if (flash_path_.empty()) return;
+	int fd = open(flash_path_.c_str(), O_RDONLY);
+	if (fd < 0) {
+		// New image: start out fully erased
+		fd = open(flash_path_.c_str(), O_WRONLY | O_CREAT, 0644);
+		if (fd >= 0 && write(fd, flash_.data(), flash_.size()) < 0) {
+			std::fprintf(stderr, "sim: failed to create %s\n", flash_path_.c_str());
+		}
+		if (fd >= 0) close(fd);
+		return;
+	}
+	ssize_t n = pread(fd, flash_.data(), flash_.size(), 0);
+	close(fd);
+	if (n >= 0 && (size_t) n < flash_.size()) {
+		std::fill(flash_.begin() + n, flash_.end(), 0xFF);
+	}
+}
+
+Instance::~Instance() {}
+
+void Instance::Boot() {
+	ScopedInstance scope(this);
+	for (int attempt = 0; attempt < MAX_BOOT_ATTEMPTS; attempt++) {
+		try {
+			responses_.clear();
+			link_settings_ = LinkSettings();
+			pending_link_settings_.reset();
+			decoder_ = std::make_unique<Decoder>();
+			Rand::Initialize();
+			decoder_->Initialize();
+			alive_ = true;
+			return;
+		} catch (const RebootRequest&) {
+			reboots_++;
+		}
+	}
+	std::fprintf(stderr, "sim: decoder %08x failed to boot, disabling it\n",
+			secrets_.decoder_id);
+	decoder_.reset();
+	alive_ = false;
+}
+
+void Instance::PowerOn() {
+	Boot();
+	responses_.clear();
+}
+
+void Instance::Execute(OpCode op_code, std::string_view body) {
+	responses_.clear();
+	send_not_before_ = Clock::now();
+	if (!alive_) return;
+	ScopedInstance scope(this);
+	command_.assign(body);
+	try {
+		decoder_->HandleCommand(op_code, std::span<char>(command_));
+	} catch (const RebootRequest&) {
+		// A real decoder would not answer after rebooting mid-command.
+		reboots_++;
+		Boot();
+		responses_.clear();
+	}
+}
+
+std::vector<Response> Instance::TakeResponses() {
+	return std::move(responses_);
+}
+
+void Instance::QueueResponse(OpCode op_code, std::string_view body) {
+	responses_.push_back({op_code, std::string(body), send_not_before_});
+}
+
+void Instance::DelayResponsesUntil(Clock::time_point time) {
+	if (timing_enabled_ && time > send_not_before_) {
+		send_not_before_ = time;
+	}
+}
+
+std::string_view Instance::ReadFlash(int offset, int length) const {
+	Debug::Assert(offset >= 0 && length >= 0
+			&& offset + length <= (int) flash_.size());
+	return std::string_view((const char*) flash_.data() + offset, length);
+}
+
+void Instance::WriteFlashPage(int page_offset, std::string_view data) {
+	Debug::Assert(page_offset >= 0 && page_offset % FLASH_PAGE_SIZE == 0
+			&& page_offset + FLASH_PAGE_SIZE <= (int) flash_.size());
+	Debug::Assert(data.size() <= FLASH_PAGE_SIZE);
+	// Erase, then program
+	std::fill(flash_.begin() + page_offset,
+			flash_.begin() + page_offset + FLASH_PAGE_SIZE, 0xFF);
+	std::copy(data.begin(), data.end(), flash_.begin() + page_offset);
+	if (flash_path_.empty()) return;
+	int fd = open(flash_path_.c_str(), O_WRONLY | O_CREAT, 0644);
+	Debug::Assert(fd >= 0, "Failed to open flash image");
+	ssize_t n = pwrite(fd, flash_.data() + page_offset, FLASH_PAGE_SIZE,
+			page_offset);
+	close(fd);
+	Debug::Assert(n == FLASH_PAGE_SIZE, "Failed to write flash image");
+}
+
+}  // namespace ectf::sim
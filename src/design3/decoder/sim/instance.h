@@ -0,0 +1,137 @@
+#ifndef __SIM_INSTANCE_H__
+#define __SIM_INSTANCE_H__
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "debug.h"
+#include "decoder.h"
+#include "message_bus.h"
+#include "secrets.h"
+#include "timer.h"
+#include "types.h"
+
+namespace ectf::sim {
+
+using Clock = std::chrono::steady_clock;
+
+// Size of a flash page on the MAX78000.
+constexpr int FLASH_PAGE_SIZE = 0x2000;
+
+// The per-decoder values that codegen.py would otherwise compile into the
+// firmware (see GetFlashKey() and friends in secrets.h).
+struct DecoderSecrets {
+	DeviceID decoder_id;
+	std::string flash_key;
+	std::string flash_iv;
+	std::string secret_data;
+};
+
+// A message produced by MessageBus::WriteResponse, waiting to be sent.
+struct Response {
+	OpCode op_code;
+	std::string body;
+	// The earliest time the response may be sent, which is how the
+	// constant-time padding done with Timer::WaitUntilElapsedMicros is
+	// simulated without blocking a worker thread.
+	Clock::time_point not_before;
+};
+
+// Thrown by System::Reboot. Instance catches it and boots the decoder again.
+struct RebootRequest {};
+
+// One simulated decoder: the Decoder object plus everything that is global on
+// the real device (flash, PRNG state, command timer, LED, firmware secrets,
+// sealed keys).
+// The simulator's implementations of the platform classes (MessageBus,
+// FlashStorage, Rand, System, Timer, Debug) operate on CurrentInstance(), so
+// the unmodified decoder code can run many instances side by side as long as
+// each instance is only used by one thread at a time.
+class Instance {
+private:
+	DecoderSecrets secrets_;
+	std::unique_ptr<Decoder> decoder_;
+	bool alive_ = false;
+	int reboots_ = 0;
+
+	// Flash pages used by FlashStorage, optionally backed by a file.
+	std::vector<uint8_t> flash_;
+	std::string flash_path_;
+
+	uint32_t random_number_ = 0;
+	Timer command_timer_;
+	LinkSettings link_settings_;
+	std::optional<LinkSettings> pending_link_settings_;
+	SealedKeys sealed_keys_ = {};
+	SealingSalt sealing_salt_ = {};
+	LedColor led_color_ = LedColor::Black;
+
+	// If false, Timer::WaitUntilElapsedMicros does not delay responses.
+	bool timing_enabled_;
+	Clock::time_point send_not_before_;
+	std::vector<Response> responses_;
+	// Stands in for the command buffer of MessageBus::ReadCommand, which the
+	// decoder may modify.
+	std::string command_;
+
+	// Runs Decoder::Initialize, retrying a few times if the decoder reboots.
+	void Boot();
+public:
+	// flash_path may be empty, in which case flash is not persisted.
+	Instance(DecoderSecrets secrets, std::string flash_path, bool timing_enabled);
+	~Instance();
+
+	// Boots the decoder (equivalent to powering on the device).
+	void PowerOn();
+	// Runs one command through Decoder::HandleCommand. The responses it
+	// produced can be retrieved with TakeResponses afterwards.
+	void Execute(OpCode op_code, std::string_view body);
+	std::vector<Response> TakeResponses();
+
+	DeviceID GetDecoderID() const { return secrets_.decoder_id; }
+	bool IsAlive() const { return alive_; }
+	int GetRebootCount() const { return reboots_; }
+
+	// Platform state, used by the sim/ implementations of the platform classes.
+	const DecoderSecrets& GetSecrets() const { return secrets_; }
+	uint32_t& RandomState() { return random_number_; }
+	Timer& CommandTimer() { return command_timer_; }
+	LinkSettings& Link() { return link_settings_; }
+	// Settings passed to MessageBus::SetLinkSettings, which the simulator
+	// applies once the response announcing them has been sent.
+	std::optional<LinkSettings>& PendingLink() { return pending_link_settings_; }
+	SealedKeys& SealedKeyRegion() { return sealed_keys_; }
+	SealingSalt& SealingSaltRegion() { return sealing_salt_; }
+	void SetLedColor(LedColor color) { led_color_ = color; }
+	LedColor GetLedColor() const { return led_color_; }
+	void QueueResponse(OpCode op_code, std::string_view body);
+	// Holds back any response queued from now on until the given time.
+	void DelayResponsesUntil(Clock::time_point time);
+	std::string_view ReadFlash(int offset, int length) const;
+	void WriteFlashPage(int page_offset, std::string_view data);
+};
+
+// Returns the instance whose code is running on the calling thread.
+// Asserts if there is none.
+Instance& CurrentInstance();
+// Returns the instance whose code is running on the calling thread, or null.
+Instance* CurrentInstanceOrNull();
+
+// Makes an instance current on the calling thread for the lifetime of this
+// object.
+class ScopedInstance {
+private:
+	Instance* previous_;
+public:
+	explicit ScopedInstance(Instance* instance);
+	~ScopedInstance();
+};
+
+}
+
+#endif // __SIM_INSTANCE_H__
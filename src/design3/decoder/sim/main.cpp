@@ -0,0 +1,115 @@
+// Fleet simulator: runs many design3 decoders in one Linux process, each with
+// its own pty or TCP endpoint, for load-testing the satellite/TV side at
+// realistic scale. Run without arguments for usage.
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fleet.h"
+#include "instance.h"
+#include "manifest.h"
+
+using ectf::sim::DecoderSecrets;
+using ectf::sim::Fleet;
+using ectf::sim::FleetOptions;
+using ectf::sim::LoadManifest;
+
+namespace {
+
+Fleet* fleet_ = nullptr;
+
+void HandleSignal(int) {
+	if (fleet_) fleet_->Stop();
+}
+
+void Usage(const char* argv0) {
+	std::fprintf(stderr,
+			"usage: %s --manifest FILE (--pty-dir DIR | --tcp-port PORT) [options]\n"
+			"  --manifest FILE        decoder secrets from py/fleet_manifest.py\n"
+			"  --count N              only start the first N decoders\n"
+			"  --pty-dir DIR          one pty per decoder, linked as DIR/<decoder id>\n"
+			"  --tcp-port PORT        decoder i listens on PORT + i\n"
+			"  --bind ADDR            address for --tcp-port (default 127.0.0.1)\n"
+			"  --workers N            worker threads (default: number of CPUs)\n"
+			"  --state-dir DIR        persist flash images as DIR/<decoder id>.flash\n"
+			"  --no-timing            do not simulate constant-time response padding\n"
+			"  --stats-interval SEC   seconds between stats lines (default 5, 0 = off)\n"
+			"  --stats-json FILE      write final stats as JSON on exit\n",
+			argv0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+	FleetOptions options;
+	options.workers = std::max(1u, std::thread::hardware_concurrency());
+	std::string manifest;
+	size_t count = 0;
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		auto value = [&]() -> std::string {
+			if (i + 1 >= argc) {
+				Usage(argv[0]);
+				std::exit(2);
+			}
+			return argv[++i];
+		};
+		if (arg == "--manifest") {
+			manifest = value();
+		} else if (arg == "--count") {
+			count = std::stoul(value());
+		} else if (arg == "--pty-dir") {
+			options.pty_dir = value();
+		} else if (arg == "--tcp-port") {
+			options.tcp_port = std::stoi(value());
+		} else if (arg == "--bind") {
+			options.bind_address = value();
+		} else if (arg == "--workers") {
+			options.workers = std::max(1, std::stoi(value()));
+		} else if (arg == "--state-dir") {
+			options.state_dir = value();
+		} else if (arg == "--no-timing") {
+			options.timing_enabled = false;
+		} else if (arg == "--stats-interval") {
+			options.stats_interval = std::stod(value());
+		} else if (arg == "--stats-json") {
+			options.stats_json = value();
+		} else {
+			Usage(argv[0]);
+			return 2;
+		}
+	}
+	if (manifest.empty() || (options.pty_dir.empty() && !options.tcp_port)) {
+		Usage(argv[0]);
+		return 2;
+	}
+
+	std::vector<DecoderSecrets> decoders;
+	if (!LoadManifest(manifest, decoders)) return 1;
+	if (count && count < decoders.size()) decoders.resize(count);
+	if (decoders.empty()) {
+		std::fprintf(stderr, "no decoders in %s\n", manifest.c_str());
+		return 1;
+	}
+
+	Fleet fleet(options);
+	for (DecoderSecrets& secrets : decoders) {
+		fleet.AddDecoder(std::move(secrets));
+	}
+	fleet_ = &fleet;
+	struct sigaction action = {};
+	action.sa_handler = HandleSignal;
+	sigaction(SIGINT, &action, nullptr);
+	sigaction(SIGTERM, &action, nullptr);
+	std::signal(SIGPIPE, SIG_IGN);
+	std::fprintf(stderr, "sim: %zu decoders, %d workers\n", decoders.size(),
+			options.workers);
+	const int ret = fleet.Run();
+	fleet_ = nullptr;
+	return ret;
+}
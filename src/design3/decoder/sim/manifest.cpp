@@ -0,0 +1,55 @@
+#include "manifest.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool DecodeHex(const std::string& hex, std::string& out) {
+	if (hex.size() % 2 != 0) return false;
+	out.clear();
+	for (size_t i = 0; i < hex.size(); i += 2) {
+		char* end;
+		const std::string byte = hex.substr(i, 2);
+		long value = std::strtol(byte.c_str(), &end, 16);
+		if (*end != '\0') return false;
+		out.push_back((char) value);
+	}
+	return true;
+}
+
+}  // namespace
+
+namespace ectf::sim {
+
+bool LoadManifest(const std::string& path, std::vector<DecoderSecrets>& out) {
+	std::ifstream file(path);
+	if (!file) {
+		std::fprintf(stderr, "cannot open %s\n", path.c_str());
+		return false;
+	}
+	std::string line;
+	int line_number = 0;
+	while (std::getline(file, line)) {
+		line_number++;
+		if (line.empty() || line[0] == '#') continue;
+		std::istringstream fields(line);
+		std::string id, key, iv, data;
+		DecoderSecrets secrets;
+		if (!(fields >> id >> key >> iv >> data)
+				|| !DecodeHex(key, secrets.flash_key) || !DecodeHex(iv, secrets.flash_iv)
+				|| !DecodeHex(data, secrets.secret_data)) {
+			std::fprintf(stderr, "%s:%d: malformed line\n", path.c_str(), line_number);
+			return false;
+		}
+		secrets.decoder_id = std::strtoul(id.c_str(), nullptr, 0);
+		out.push_back(std::move(secrets));
+	}
+	return true;
+}
+
+}  // namespace ectf::sim
@@ -0,0 +1,19 @@
+#ifndef __SIM_MANIFEST_H__
+#define __SIM_MANIFEST_H__
+
+#include <string>
+#include <vector>
+
+#include "instance.h"
+
+namespace ectf::sim {
+
+// Reads the decoder secrets written by py/fleet_manifest.py, one decoder per
+// line:
+//   <decoder id> <flash key hex> <flash iv hex> <secret data hex>
+// Prints an error and returns false if the file is missing or malformed.
+bool LoadManifest(const std::string& path, std::vector<DecoderSecrets>& out);
+
+}  // namespace ectf::sim
+
+#endif // __SIM_MANIFEST_H__
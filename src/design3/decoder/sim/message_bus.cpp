@@ -0,0 +1,127 @@
+// Simulator implementation of MessageBus (see src/message_bus.cpp for the
+// firmware version). Responses are queued on the current instance instead of
+// being written to UART; the simulator's link handling sends them and
+// collects the ACKs. Commands are read by the simulator as well, so
+// ReadCommand is never used.
+
+#include "message_bus.h"
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+
+#include "buffer.h"
+#include "debug.h"
+#include "instance.h"
+#include "protocol.h"
+#include "timer.h"
+
+namespace ectf::sim {
+
+OpCode ToOpCode(char c) {
+	switch (c) {
+	case 'D':
+		return OpCode::Decode;
+	case 'S':
+		return OpCode::Subscribe;
+	case 'L':
+		return OpCode::List;
+	case 'N':
+		return OpCode::Negotiate;
+	case 'A':
+		return OpCode::Ack;
+	case 'E':
+		return OpCode::Error;
+	case 'G':
+		return OpCode::Debug;
+	default:
+		return OpCode::Unknown;
+	}
+}
+
+char ToChar(OpCode op_code) {
+	switch (op_code) {
+	case OpCode::Decode:
+		return 'D';
+	case OpCode::Subscribe:
+		return 'S';
+	case OpCode::List:
+		return 'L';
+	case OpCode::Negotiate:
+		return 'N';
+	case OpCode::Ack:
+		return 'A';
+	case OpCode::Error:
+		return 'E';
+	case OpCode::Debug:
+		return 'G';
+	default:
+		return 'E';
+	}
+}
+
+std::string EncodeHeader(OpCode op_code, int length) {
+	std::string header;
+	header += '%';
+	header += ToChar(op_code);
+	header += StringCoder::EncodeUint16(length);
+	return header;
+}
+
+std::optional<Header> ConsumeHeader(std::string& buffer) {
+	size_t start = buffer.find('%');
+	if (start == std::string::npos) {
+		buffer.clear();
+		return std::nullopt;
+	}
+	buffer.erase(0, start);
+	if (buffer.size() < HEADER_SIZE) return std::nullopt;
+	StringViewReader reader(std::string_view(buffer).substr(1, HEADER_SIZE - 1));
+	Header header;
+	header.op_code = ToOpCode(reader.ReadChar());
+	header.length = reader.ReadUint16();
+	buffer.erase(0, HEADER_SIZE);
+	return header;
+}
+
+}  // namespace ectf::sim
+
+namespace ectf {
+
+void MessageBus::Initialize() {}
+
+const LinkSettings& MessageBus::GetLinkSettings() {
+	return sim::CurrentInstance().Link();
+}
+
+// A pty or socket has no baud rate, so there is nothing to switch or confirm.
+// The simulator's link handling switches to the new settings once the
+// response has been sent.
+void MessageBus::SetLinkSettings(const LinkSettings& settings) {
+	Debug::Assert(settings.chunk_size >= MIN_CHUNK_SIZE
+			&& settings.chunk_size <= MAX_CHUNK_SIZE, "Bad chunk size");
+	Debug::Assert(settings.window >= 1, "Bad window");
+	sim::CurrentInstance().PendingLink() = settings;
+}
+
+std::tuple<OpCode, std::span<char>> MessageBus::ReadCommand() {
+	Debug::Assert(false, "ReadCommand is not used by the simulator");
+	return {OpCode::Unknown, std::span<char>()};
+}
+
+void MessageBus::WriteResponse(OpCode opcode, std::string_view body) {
+	if (opcode == OpCode::Debug && !Debug::IsDebugMode()) return;
+	Debug::Assert(opcode == OpCode::Debug
+			|| (int) body.size() <= MAX_OUTPUT_PAYLOAD_SIZE,
+			"WriteResponse data size too large");
+	sim::CurrentInstance().QueueResponse(opcode, body);
+}
+
+const Timer& MessageBus::GetCommandTimer() {
+	return sim::CurrentInstance().CommandTimer();
+}
+
+}  // namespace ectf
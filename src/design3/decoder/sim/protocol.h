@@ -0,0 +1,30 @@
+#ifndef __SIM_PROTOCOL_H__
+#define __SIM_PROTOCOL_H__
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "message_bus.h"
+
+namespace ectf::sim {
+
+// Helpers for the UART protocol described in message_bus.h, shared by the
+// simulated MessageBus and the simulator's link handling.
+
+struct Header {
+	OpCode op_code;
+	uint16_t length;
+};
+
+OpCode ToOpCode(char c);
+char ToChar(OpCode op_code);
+std::string EncodeHeader(OpCode op_code, int length);
+// Consumes a header from the front of the buffer, skipping any bytes before
+// the '%' marker the same way the firmware does. Returns nothing (and keeps
+// the partial header) if the buffer does not hold a complete header yet.
+std::optional<Header> ConsumeHeader(std::string& buffer);
+
+}
+
+#endif // __SIM_PROTOCOL_H__
@@ -0,0 +1,70 @@
+// Simulator implementation of Rand (see src/rand.cpp for the firmware
+// version). The PRNG state is kept per instance and the TRNG is replaced by
+// the host's getrandom().
+
+#include "rand.h"
+
+#include <cstdint>
+#include <cstring>
+#include <sys/random.h>
+
+#include "debug.h"
+#include "instance.h"
+
+namespace {
+
+uint32_t RandomRange(uint32_t min, uint32_t max, uint32_t rand) {
+	return min + (uint32_t)(((uint64_t) max - min) * rand >> 32);
+}
+
+}  // namespace
+
+namespace ectf {
+
+void Rand::Initialize() {
+	SecureRandomInt();
+}
+
+uint32_t Rand::SecureRandomInt() {
+	uint32_t value;
+	ssize_t n = getrandom(&value, sizeof(value), 0);
+	Debug::Assert(n == sizeof(value), "getrandom failed");
+	return sim::CurrentInstance().RandomState() = value;
+}
+
+uint32_t Rand::FastRandomInt() {
+	uint32_t& random_number = sim::CurrentInstance().RandomState();
+	random_number ^= random_number << 13;
+	random_number ^= random_number >> 17;
+	random_number ^= random_number << 5;
+	return random_number;
+}
+
+uint32_t Rand::SecureRandomRange(uint32_t min, uint32_t max) {
+	return RandomRange(min, max, SecureRandomInt());
+}
+
+uint32_t Rand::FastRandomRange(uint32_t min, uint32_t max) {
+	return RandomRange(min, max, FastRandomInt());
+}
+
+void Rand::FastRandomBuffer(char* buf, int size) {
+	constexpr int wordsize = sizeof(uint32_t);
+	while (size >= wordsize) {
+		uint32_t random_number = FastRandomInt();
+		std::memcpy(buf, &random_number, wordsize);
+		buf += wordsize;
+		size -= wordsize;
+	}
+	if (size > 0) {
+		uint32_t random_number = FastRandomInt();
+		std::memcpy(buf, &random_number, size);
+	}
+}
+
+void Rand::SecureRandomBuffer(char* buf, int size) {
+	ssize_t n = getrandom(buf, size, 0);
+	Debug::Assert(n == size, "getrandom failed");
+}
+
+}  // namespace ectf
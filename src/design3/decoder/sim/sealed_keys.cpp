@@ -0,0 +1,17 @@
+// Simulator implementation of the sealed key region and the sealing salt (see
+// src/sealed_keys.cpp for the firmware version): each instance has its own.
+
+#include "instance.h"
+#include "secrets.h"
+
+namespace ectf {
+
+SealedKeys& GetSealedKeys() {
+	return sim::CurrentInstance().SealedKeyRegion();
+}
+
+SealingSalt& GetSealingSalt() {
+	return sim::CurrentInstance().SealingSaltRegion();
+}
+
+}  // namespace ectf
@@ -0,0 +1,23 @@
+// Simulator replacement for the secret_data.cpp that codegen.py generates:
+// each instance carries its own values (see py/fleet_manifest.py).
+
+#include <string_view>
+
+#include "instance.h"
+#include "secrets.h"
+
+namespace ectf {
+
+std::string_view GetFlashKey() {
+	return sim::CurrentInstance().GetSecrets().flash_key;
+}
+
+std::string_view GetFlashIV() {
+	return sim::CurrentInstance().GetSecrets().flash_iv;
+}
+
+std::string_view GetFlashSecretData() {
+	return sim::CurrentInstance().GetSecrets().secret_data;
+}
+
+}  // namespace ectf
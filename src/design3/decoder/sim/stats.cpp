@@ -0,0 +1,57 @@
+#include "stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace ectf::sim {
+
+void LatencyRecorder::Add(double micros) {
+	count_++;
+	sum_ += micros;
+	max_ = std::max(max_, micros);
+	if (samples_.size() < MAX_SAMPLES) {
+		samples_.push_back(micros);
+		return;
+	}
+	// Reservoir sampling keeps a uniform sample of everything seen so far
+	rng_state_ ^= rng_state_ << 13;
+	rng_state_ ^= rng_state_ >> 7;
+	rng_state_ ^= rng_state_ << 17;
+	const uint64_t slot = rng_state_ % count_;
+	if (slot < MAX_SAMPLES) {
+		samples_[slot] = micros;
+	}
+}
+
+void LatencyRecorder::Merge(const LatencyRecorder& other) {
+	count_ += other.count_;
+	sum_ += other.sum_;
+	max_ = std::max(max_, other.max_);
+	samples_.insert(samples_.end(), other.samples_.begin(), other.samples_.end());
+}
+
+double LatencyRecorder::Percentile(double p) const {
+	if (samples_.empty()) return 0;
+	std::vector<double> sorted = samples_;
+	std::sort(sorted.begin(), sorted.end());
+	const size_t index = std::min(sorted.size() - 1,
+			(size_t) std::lround(p / 100 * (sorted.size() - 1)));
+	return sorted[index];
+}
+
+void InstanceStats::Merge(const InstanceStats& other) {
+	commands += other.commands;
+	decodes += other.decodes;
+	decode_errors += other.decode_errors;
+	subscribes += other.subscribes;
+	subscribe_errors += other.subscribe_errors;
+	lists += other.lists;
+	other_commands += other.other_commands;
+	aborted_responses += other.aborted_responses;
+	decode_latency.Merge(other.decode_latency);
+	service_time.Merge(other.service_time);
+}
+
+}  // namespace ectf::sim
@@ -0,0 +1,51 @@
+#ifndef __SIM_STATS_H__
+#define __SIM_STATS_H__
+
+#include <cstdint>
+#include <vector>
+
+namespace ectf::sim {
+
+// Records latency samples (in microseconds). Count, mean and max are exact;
+// percentiles are computed from a bounded reservoir sample.
+class LatencyRecorder {
+private:
+	static constexpr int MAX_SAMPLES = 4096;
+	std::vector<double> samples_;
+	uint64_t count_ = 0;
+	double sum_ = 0;
+	double max_ = 0;
+	uint64_t rng_state_ = 0x9E3779B97F4A7C15ull;
+public:
+	void Add(double micros);
+	// Adds another recorder's samples to this one (used for aggregates).
+	void Merge(const LatencyRecorder& other);
+	uint64_t Count() const { return count_; }
+	double Mean() const { return count_ ? sum_ / count_ : 0; }
+	double Max() const { return max_; }
+	// Returns the p-th percentile (0 <= p <= 100), or 0 without samples.
+	double Percentile(double p) const;
+};
+
+// Counters for one simulated decoder.
+struct InstanceStats {
+	uint64_t commands = 0;
+	uint64_t decodes = 0;
+	uint64_t decode_errors = 0;
+	uint64_t subscribes = 0;
+	uint64_t subscribe_errors = 0;
+	uint64_t lists = 0;
+	uint64_t other_commands = 0;
+	// Responses abandoned because the host did not ACK them
+	uint64_t aborted_responses = 0;
+	// Time from receiving a Decode header until the response was ACKed
+	LatencyRecorder decode_latency;
+	// Time spent inside Decoder::HandleCommand, for any command
+	LatencyRecorder service_time;
+
+	void Merge(const InstanceStats& other);
+};
+
+}
+
+#endif // __SIM_STATS_H__
@@ -0,0 +1,26 @@
+// Simulator implementation of System (see src/system.cpp for the firmware
+// version).
+
+#include "system.h"
+
+#include <cstdint>
+
+#include "instance.h"
+
+namespace ectf {
+
+void System::Initialize() {}
+
+// The random delays sprinkled through the decoder only exist to frustrate
+// glitching and power analysis. Burning host CPU on them would just reduce
+// the number of instances a worker thread can serve, and the externally
+// visible timing is governed by the command timer padding anyway (see
+// Timer::WaitUntilElapsedMicros), so they are skipped.
+void System::Delay(uint32_t micros) {}
+
+// Unwinds back to the simulator, which boots the instance again.
+void System::Reboot() {
+	throw sim::RebootRequest();
+}
+
+}  // namespace ectf
@@ -0,0 +1,46 @@
+// Simulator implementation of Timer (see src/timer.cpp for the firmware
+// version), based on the host's monotonic clock.
+
+#include "timer.h"
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "instance.h"
+
+namespace ectf {
+
+void Timer::Initialize() {}
+
+uint32_t Timer::GetTotalElapsedMicros() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+			sim::Clock::now().time_since_epoch()).count();
+}
+
+Timer::Timer() {
+	Reset();
+}
+
+void Timer::Reset() {
+	start_time_micros_ = GetTotalElapsedMicros();
+}
+
+uint32_t Timer::GetElapsedMicros() const {
+	return GetTotalElapsedMicros() - start_time_micros_;
+}
+
+// Rather than spinning, a decoder instance records the deadline and the
+// simulator holds back the responses written after this call until then.
+void Timer::WaitUntilElapsedMicros(int deadline) const {
+	const int remaining = deadline - (int) GetElapsedMicros();
+	if (remaining <= 0) return;
+	const auto delay = std::chrono::microseconds(remaining);
+	if (sim::Instance* instance = sim::CurrentInstanceOrNull()) {
+		instance->DelayResponsesUntil(sim::Clock::now() + delay);
+	} else {
+		std::this_thread::sleep_for(delay);
+	}
+}
+
+}  // namespace ectf
@@ -0,0 +1,9 @@
+// Host stand-in for the MSDK's board.h, for building src/message_bus.cpp
+// against the UART shim in uart.h.
+
+#ifndef __SIM_UART_BOARD_H__
+#define __SIM_UART_BOARD_H__
+
+#define CONSOLE_UART 0
+
+#endif // __SIM_UART_BOARD_H__
@@ -0,0 +1,114 @@
+// Runs one design3 decoder with the firmware's src/message_bus.cpp, connected
+// to a pty through the UART shim in uart.h, instead of the simulator's
+// push-based message bus. This is how the framing and ACK window code that
+// ships on the device is exercised on the host. Run without arguments for
+// usage.
+//
+// The other platform classes are the simulator's (see ../instance.h), so the
+// constant-time response padding is not simulated.
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "decoder.h"
+#include "instance.h"
+#include "manifest.h"
+#include "message_bus.h"
+#include "rand.h"
+#include "uart.h"
+
+using ectf::Decoder;
+using ectf::MessageBus;
+using ectf::Rand;
+using ectf::sim::DecoderSecrets;
+using ectf::sim::Instance;
+using ectf::sim::LoadManifest;
+using ectf::sim::RebootRequest;
+using ectf::sim::ScopedInstance;
+
+namespace {
+
+void HandleSignal(int) {
+	ectf::sim::CloseUartPty();
+	_exit(0);
+}
+
+void Usage(const char* argv0) {
+	std::fprintf(stderr,
+			"usage: %s --manifest FILE --pty PATH [options]\n"
+			"  --manifest FILE        decoder secrets from py/fleet_manifest.py\n"
+			"  --index N              run the Nth decoder of the manifest (default 0)\n"
+			"  --pty PATH             link the decoder's pty as PATH\n"
+			"  --flash FILE           persist the flash image as FILE\n",
+			argv0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+	std::string manifest;
+	std::string pty;
+	std::string flash;
+	size_t index = 0;
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		auto value = [&]() -> std::string {
+			if (i + 1 >= argc) {
+				Usage(argv[0]);
+				std::exit(2);
+			}
+			return argv[++i];
+		};
+		if (arg == "--manifest") {
+			manifest = value();
+		} else if (arg == "--index") {
+			index = std::stoul(value());
+		} else if (arg == "--pty") {
+			pty = value();
+		} else if (arg == "--flash") {
+			flash = value();
+		} else {
+			Usage(argv[0]);
+			return 2;
+		}
+	}
+	if (manifest.empty() || pty.empty()) {
+		Usage(argv[0]);
+		return 2;
+	}
+
+	std::vector<DecoderSecrets> decoders;
+	if (!LoadManifest(manifest, decoders)) return 1;
+	if (index >= decoders.size()) {
+		std::fprintf(stderr, "no decoder %zu in %s\n", index, manifest.c_str());
+		return 1;
+	}
+
+	Instance instance(std::move(decoders[index]), flash, false);
+	ScopedInstance scope(&instance);
+	ectf::sim::OpenUartPty(pty);
+	struct sigaction action = {};
+	action.sa_handler = HandleSignal;
+	sigaction(SIGINT, &action, nullptr);
+	sigaction(SIGTERM, &action, nullptr);
+
+	// Same sequence as src/main.cpp, without the boot delays
+	MessageBus::Initialize();
+	Rand::Initialize();
+	try {
+		Decoder decoder;
+		decoder.Initialize();
+		decoder.RunLoop();
+	} catch (const RebootRequest&) {
+		// The message bus state cannot be reset the way a reboot would, so stop
+		// instead.
+		std::fprintf(stderr, "sim: decoder %08x rebooted\n",
+				instance.GetDecoderID());
+	}
+	ectf::sim::CloseUartPty();
+	return 1;
+}
@@ -0,0 +1,154 @@
+// Implementation of the UART shim in uart.h.
+
+#include "uart.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+
+extern "C" void UART0_IRQHandler();
+
+namespace {
+
+// Bytes read from the pty per call, which is about what the MAX78000's RX
+// FIFO holds.
+constexpr int RX_FIFO_SIZE = 8;
+
+mxc_uart_regs_t uart0_ = {};
+int master_fd_ = -1;
+// Kept open so that reads from the master do not fail while no host is
+// connected.
+int slave_fd_ = -1;
+char link_path_[256] = {};
+bool initialized_ = false;
+
+// Bytes received but not yet read from the FIFO register. Only touched by the
+// reader thread, which also runs UART0_IRQHandler.
+std::deque<uint8_t> rx_fifo_;
+
+void ReadPty() {
+	uint8_t buffer[RX_FIFO_SIZE];
+	while (true) {
+		const ssize_t n = read(master_fd_, buffer, sizeof(buffer));
+		if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EIO)) {
+			continue;
+		}
+		if (n <= 0) {
+			std::fprintf(stderr, "sim: reading the UART pty failed: %s\n",
+					std::strerror(errno));
+			std::abort();
+		}
+		rx_fifo_.insert(rx_fifo_.end(), buffer, buffer + n);
+		UART0_IRQHandler();
+	}
+}
+
+}  // namespace
+
+namespace ectf::sim {
+
+UartFifo::operator uint8_t() {
+	if (rx_fifo_.empty()) return 0;
+	const uint8_t c = rx_fifo_.front();
+	rx_fifo_.pop_front();
+	return c;
+}
+
+UartFifo& UartFifo::operator=(uint8_t c) {
+	while (write(master_fd_, &c, 1) != 1) {
+		if (errno != EINTR && errno != EAGAIN) {
+			std::fprintf(stderr, "sim: writing the UART pty failed: %s\n",
+					std::strerror(errno));
+			std::abort();
+		}
+	}
+	return *this;
+}
+
+mxc_uart_regs_t* GetUart(int index) {
+	if (index != 0) {
+		std::fprintf(stderr, "sim: only UART0 is simulated\n");
+		std::abort();
+	}
+	return &uart0_;
+}
+
+void OpenUartPty(const std::string& link_path) {
+	master_fd_ = posix_openpt(O_RDWR | O_NOCTTY);
+	if (master_fd_ < 0 || grantpt(master_fd_) != 0 || unlockpt(master_fd_) != 0) {
+		throw std::runtime_error(std::string("cannot allocate pty: ")
+				+ std::strerror(errno));
+	}
+	const char* slave_name = ptsname(master_fd_);
+	slave_fd_ = open(slave_name, O_RDWR | O_NOCTTY);
+	termios tio;
+	if (slave_fd_ < 0 || tcgetattr(slave_fd_, &tio) != 0) {
+		throw std::runtime_error("cannot configure pty");
+	}
+	cfmakeraw(&tio);
+	tcsetattr(slave_fd_, TCSANOW, &tio);
+	if (link_path.size() >= sizeof(link_path_)) {
+		throw std::runtime_error("pty path too long");
+	}
+	unlink(link_path.c_str());
+	if (symlink(slave_name, link_path.c_str()) != 0) {
+		throw std::runtime_error("cannot create " + link_path);
+	}
+	std::strcpy(link_path_, link_path.c_str());
+}
+
+void CloseUartPty() {
+	if (link_path_[0]) unlink(link_path_);
+}
+
+}  // namespace ectf::sim
+
+int MXC_UART_Init(mxc_uart_regs_t* uart, unsigned int baud, mxc_uart_clock_t clock) {
+	if (uart != &uart0_ || master_fd_ < 0) return E_BAD_PARAM;
+	initialized_ = true;
+	return MXC_UART_SetFrequency(uart, baud, clock) > 0 ? E_NO_ERROR : E_BAD_PARAM;
+}
+
+int MXC_UART_SetFrequency(mxc_uart_regs_t* uart, unsigned int baud,
+		mxc_uart_clock_t clock) {
+	if (uart != &uart0_ || !initialized_ || baud == 0) return E_BAD_PARAM;
+	return baud;
+}
+
+int MXC_UART_SetRXThreshold(mxc_uart_regs_t* uart, unsigned int num_bytes) {
+	if (uart != &uart0_ || num_bytes == 0 || num_bytes > RX_FIFO_SIZE) {
+		return E_BAD_PARAM;
+	}
+	return E_NO_ERROR;
+}
+
+int MXC_UART_EnableInt(mxc_uart_regs_t* uart, unsigned int mask) {
+	return uart == &uart0_ ? E_NO_ERROR : E_BAD_PARAM;
+}
+
+unsigned int MXC_UART_GetRXFIFOAvailable(mxc_uart_regs_t* uart) {
+	return rx_fifo_.size();
+}
+
+unsigned int MXC_UART_GetFlags(mxc_uart_regs_t* uart) {
+	return 0;
+}
+
+int MXC_UART_ClearFlags(mxc_uart_regs_t* uart, unsigned int flags) {
+	return E_NO_ERROR;
+}
+
+void NVIC_EnableIRQ(IRQn_Type irq) {
+	static bool enabled = false;
+	if (irq != UART0_IRQn || enabled) return;
+	enabled = true;
+	std::thread(ReadPty).detach();
+}
@@ -0,0 +1,75 @@
+// Host stand-in for the MSDK's uart.h: just the part of the driver and the
+// register block that src/message_bus.cpp uses, with UART0 connected to a pty.
+// Received bytes are handed to UART0_IRQHandler from a reader thread, which
+// plays the part of the RX threshold interrupt.
+
+#ifndef __SIM_UART_UART_H__
+#define __SIM_UART_UART_H__
+
+#include <cstdint>
+#include <string>
+
+#define E_NO_ERROR 0
+#define E_BAD_PARAM -1
+
+#define MXC_F_UART_STATUS_TX_BUSY (1u << 0)
+#define MXC_F_UART_STATUS_TX_FULL (1u << 5)
+#define MXC_F_UART_INT_EN_RX_THD (1u << 4)
+
+typedef enum {
+	MXC_UART_APB_CLK = 0,
+	MXC_UART_EXT_CLK = 1,
+	MXC_UART_IBRO_CLK = 2,
+	MXC_UART_ERFO_CLK = 3,
+} mxc_uart_clock_t;
+
+typedef enum {
+	UART0_IRQn = 30,
+} IRQn_Type;
+
+namespace ectf::sim {
+
+// The FIFO register. Reading it pops a received byte, writing it sends one.
+class UartFifo {
+public:
+	operator uint8_t();
+	UartFifo& operator=(uint8_t c);
+};
+
+}  // namespace ectf::sim
+
+typedef struct {
+	// Never TX_BUSY or TX_FULL: writes to the FIFO go straight to the pty.
+	uint32_t status;
+	ectf::sim::UartFifo fifo;
+} mxc_uart_regs_t;
+
+namespace ectf::sim {
+
+mxc_uart_regs_t* GetUart(int index);
+
+// Creates the pty that UART0 is connected to and links its slave side as
+// link_path. Must be called before MXC_UART_Init.
+void OpenUartPty(const std::string& link_path);
+// Removes the link created by OpenUartPty. Async-signal-safe.
+void CloseUartPty();
+
+}  // namespace ectf::sim
+
+#define MXC_UART_GET_UART(i) (ectf::sim::GetUart(i))
+#define MXC_UART_GET_IRQ(i) ((IRQn_Type) (UART0_IRQn + (i)))
+
+int MXC_UART_Init(mxc_uart_regs_t* uart, unsigned int baud, mxc_uart_clock_t clock);
+// A pty has no baud rate, so this only checks the arguments. Returns the baud
+// rate like the real driver.
+int MXC_UART_SetFrequency(mxc_uart_regs_t* uart, unsigned int baud,
+		mxc_uart_clock_t clock);
+int MXC_UART_SetRXThreshold(mxc_uart_regs_t* uart, unsigned int num_bytes);
+int MXC_UART_EnableInt(mxc_uart_regs_t* uart, unsigned int mask);
+unsigned int MXC_UART_GetRXFIFOAvailable(mxc_uart_regs_t* uart);
+unsigned int MXC_UART_GetFlags(mxc_uart_regs_t* uart);
+int MXC_UART_ClearFlags(mxc_uart_regs_t* uart, unsigned int flags);
+// Starts delivering received bytes to UART0_IRQHandler.
+void NVIC_EnableIRQ(IRQn_Type irq);
+
+#endif // __SIM_UART_UART_H__
@@ -1,13 +1,18 @@
 #include "crypto.h"
 
+#include <algorithm>
 #include <cstring>
 #include <memory>
 #include <optional>
+#include <span>
 #include <string_view>
 #include <tuple>
 
+#include "wolfssl/wolfcrypt/chacha.h"
 #include "wolfssl/wolfcrypt/chacha20_poly1305.h"
 #include "wolfssl/wolfcrypt/ed25519.h"
+#include "wolfssl/wolfcrypt/hmac.h"
+#include "wolfssl/wolfcrypt/poly1305.h"
 
 #include "buffer.h"
 #include "channel.h"
@@ -15,6 +20,67 @@
 #include "keys.h"
 #include "rand.h"
 
+namespace {
+
+using ectf::CHACHA_TAG_SIZE;
+using ectf::ChaChaIV;
+using ectf::ChaChaKey;
+using ectf::Debug;
+using ectf::Rand;
+
+// Size of the scratch buffer used by the in-place decoys (one ChaCha block).
+constexpr int DECOY_SCRATCH_SIZE = CHACHA_CHUNK_BYTES;
+
+bool ConstantTimeEquals(const char* a, const char* b, int size) {
+	volatile char diff = 0;
+	for (int i = 0; i < size; i++) {
+		diff = diff | (a[i] ^ b[i]);
+	}
+	return diff == 0;
+}
+
+// Computes the ChaCha20-Poly1305 (RFC 8439, no AAD) tag of the given
+// ciphertext. Leaves chacha keyed with the given key, so that only the block
+// counter has to be set to decrypt.
+void ComputeTag(ChaCha& chacha, std::span<const char> ciphertext,
+		const ChaChaKey& key, const ChaChaIV& iv, char* tag) {
+	byte poly_key[CHACHA20_POLY1305_AEAD_KEYSIZE] = {};
+	Poly1305 poly;
+	int retcode = wc_Chacha_SetKey(&chacha, (const byte*) key.data(), key.size());
+	retcode |= wc_Chacha_SetIV(&chacha, (const byte*) iv.data(), 0);
+	// The Poly1305 key is the first 32 bytes of keystream block 0
+	retcode |= wc_Chacha_Process(&chacha, poly_key, poly_key, sizeof(poly_key));
+	retcode |= wc_Poly1305SetKey(&poly, poly_key, sizeof(poly_key));
+	retcode |= wc_Poly1305_MAC(&poly, nullptr, 0, (const byte*) ciphertext.data(),
+			ciphertext.size(), (byte*) tag, CHACHA_TAG_SIZE);
+	Debug::Assert(retcode == 0, "Poly1305 failed");
+	std::memset(poly_key, 0, sizeof(poly_key));
+	std::memset(&poly, 0, sizeof(poly));
+}
+
+// Does the same work as a successful in-place decryption of the ciphertext,
+// using a random key and writing the output to a small scratch buffer.
+void DecoyDecryptInPlace(std::span<const char> ciphertext,
+		const ChaChaIV& iv) {
+	ChaChaKey decoy_key;
+	Rand::FastRandomBuffer(decoy_key.data(), decoy_key.size());
+	ChaCha chacha;
+	char tag[CHACHA_TAG_SIZE];
+	char scratch[DECOY_SCRATCH_SIZE];
+	ComputeTag(chacha, ciphertext, decoy_key, iv, tag);
+	wc_Chacha_SetIV(&chacha, (const byte*) iv.data(), 1);
+	for (size_t offset = 0; offset < ciphertext.size();
+			offset += DECOY_SCRATCH_SIZE) {
+		const int n = std::min<size_t>(DECOY_SCRATCH_SIZE,
+				ciphertext.size() - offset);
+		wc_Chacha_Process(&chacha, (byte*) scratch,
+				(const byte*) ciphertext.data() + offset, n);
+	}
+	std::memset(&chacha, 0, sizeof(chacha));
+}
+
+}  // namespace
+
 namespace ectf {
 
 std::optional<SecureString> ChaChaCrypt::Decrypt(std::string_view ciphertext,
@@ -45,6 +111,56 @@ std::optional<SecureString> ChaChaCrypt::Decrypt(std::string_view ciphertext,
 	return output;
 }
 
+SecureString ChaChaCrypt::Encrypt(std::string_view plaintext,
+		const ChaChaKey& key, const ChaChaIV& iv, ChaChaTag& auth_tag) {
+	SecureString output(plaintext.size());
+	int retcode = wc_ChaCha20Poly1305_Encrypt((const byte*) key.data(),
+			(const byte*) iv.data(), nullptr, 0, (const byte*) plaintext.data(),
+			plaintext.size(), (byte*) output.data(), (byte*) auth_tag.data());
+	Debug::Assert(retcode == 0, "Encryption failed");
+	return output;
+}
+
+bool ChaChaCrypt::DecryptInPlace(std::span<char> buffer, const ChaChaKey& key,
+		const ChaChaIV& iv, const ChaChaTag& auth_tag) {
+	// Perform decoy operations immediately before and after the real decryption
+	// in order to mitigate power analysis
+	DecoyDecryptInPlace(buffer, iv);
+	ChaCha chacha;
+	char tag[CHACHA_TAG_SIZE];
+	ComputeTag(chacha, buffer, key, iv, tag);
+	const bool valid = ConstantTimeEquals(tag, auth_tag.data(), CHACHA_TAG_SIZE);
+	if (valid) {
+		// The payload starts at keystream block 1
+		int retcode = wc_Chacha_SetIV(&chacha, (const byte*) iv.data(), 1);
+		retcode |= wc_Chacha_Process(&chacha, (byte*) buffer.data(),
+				(const byte*) buffer.data(), buffer.size());
+		Debug::Assert(retcode == 0, "ChaCha failed");
+	}
+	std::memset(&chacha, 0, sizeof(chacha));
+	DecoyDecryptInPlace(buffer, iv);
+	return valid;
+}
+
+ChaChaKey KeyDerivation::DeriveChaChaKey(std::string_view secret,
+		std::string_view salt) {
+	// Large enough to keep off the stack, like the Ed25519 key object
+	auto hmac = std::make_unique<Hmac>();
+	byte digest[WC_SHA512_DIGEST_SIZE];
+	int retcode = wc_HmacInit(hmac.get(), nullptr, INVALID_DEVID);
+	retcode |= wc_HmacSetKey(hmac.get(), WC_SHA512, (const byte*) secret.data(),
+			secret.size());
+	retcode |= wc_HmacUpdate(hmac.get(), (const byte*) salt.data(), salt.size());
+	retcode |= wc_HmacFinal(hmac.get(), digest);
+	Debug::Assert(retcode == 0, "HMAC failed");
+	ChaChaKey key(std::string_view((const char*) digest, CHACHA_KEY_SIZE));
+
+	wc_HmacFree(hmac.get());
+	std::memset(hmac.get(), 0, sizeof(Hmac));
+	std::memset(digest, 0, sizeof(digest));
+	return key;
+}
+
 bool EdCrypt::VerifySignature(std::string_view message, const EdPublicKey& key,
 		const EdSignature& signature) {
 	// Initialize the WolfCrypt key object
@@ -8,6 +8,7 @@
 
 #include "buffer.h"
 #include "message_bus.h"
+#include "secrets.h"
 #include "system.h"
 
 namespace {
@@ -21,6 +22,7 @@ namespace ectf {
 
 void Debug::AssertImpl(bool expression, std::string_view message) {
 	if (expression) return;
+	SecretData::WipeSealedKeys();
 	if (IsDebugMode()) {
 		bool led_on = true;
 		while (true) {
@@ -1,7 +1,11 @@
 #include "decoder.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <memory>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -27,16 +31,19 @@ void MicroDelay() {
 }
 
 // Estimate number of microseconds needed to send a response with the given
-// payload size, including headers and ACKs.
+// payload size, including headers and ACKs, at the current link settings.
 int EstimateIOTime(int size) {
-	constexpr int throughput = 11520;
-	constexpr int micros_per_byte = (1000000 + throughput / 2) / throughput;
+	const ectf::LinkSettings& link = ectf::MessageBus::GetLinkSettings();
+	// 10 bits per byte (start bit, 8 data bits, stop bit)
+	const int micros_per_byte = (10 * 1000000 + link.baud_rate / 2)
+			/ link.baud_rate;
 	constexpr int command_header = 4;
 	constexpr int response_header = 4;
-	constexpr int response_header_ack = 4;
-	int response_payload_ack = (size > 0) ? 4 : 0;
+	// The decoder does not wait for the host's ACKs with windowed ACKs.
+	const int response_acks = (link.features & ectf::FEATURE_WINDOWED_ACK) ? 0
+			: 4 * (1 + (size + link.chunk_size - 1) / link.chunk_size);
 	const int num_bytes = size + command_header + response_header
-			+ response_header_ack + response_payload_ack;
+			+ response_acks;
 	return num_bytes * micros_per_byte;
 }
 
@@ -45,6 +52,8 @@ int EstimateIOTime(int size) {
 namespace ectf {
 
 void Decoder::Initialize() {
+	// The sealed keys survive a warm reset (see System::Reboot)
+	SecretData::WipeSealedKeys();
 	SecretData secrets;
 	MicroDelay();
 	secrets.Load();
@@ -140,10 +149,10 @@ bool Decoder::ProcessSubscriptionData(std::string_view data,
 	return true;
 }
 
-std::optional<SecureString> Decoder::TryDecodeFrame(std::string_view data) {
+std::optional<std::string_view> Decoder::TryDecodeFrame(std::span<char> data) {
 	// Validate the purported channel ID (stored in the payload prefix).
 	MicroDelay();
-	StringViewReader reader(data);
+	StringViewReader reader(std::string_view(data.data(), data.size()));
 	const ChannelID channel_id = reader.ReadUint32();
 	if (reader.HasError()) return std::nullopt;
 	Channel* channel = channel_data_->GetChannel(channel_id);
@@ -161,19 +170,23 @@ std::optional<SecureString> Decoder::TryDecodeFrame(std::string_view data) {
 	std::string_view nonce = reader.ReadNBytes(CHACHA_IV_SIZE);
 	int cipher_len = reader.size() - CHACHA_TAG_SIZE;
 	if (cipher_len % 16 != 0) return std::nullopt;
-	std::string_view ciphertext = reader.ReadNBytes(cipher_len);
+	std::string_view ciphertext_view = reader.ReadNBytes(cipher_len);
 	std::string_view auth_tag = reader.ReadNBytes(CHACHA_TAG_SIZE);
 	if (reader.HasError()) return std::nullopt;
+	// The frame is decrypted over the command buffer and returned as a view
+	// into it.
+	std::span<char> ciphertext = data.subspan(
+			ciphertext_view.data() - data.data(), ciphertext_view.size());
 	MicroDelay();
-	std::optional<SecureString> plaintext = ChaChaCrypt::Decrypt(ciphertext,
-			channel->GetSymmetricKey(), ChaChaIV(nonce), ChaChaTag(auth_tag));
-	if (!plaintext.has_value()) {
+	if (!ChaChaCrypt::DecryptInPlace(ciphertext, channel->GetSymmetricKey(),
+			ChaChaIV(nonce), ChaChaTag(auth_tag))) {
 		Debug::Print("Decryption failed");
 		return std::nullopt;
 	}
 
 	// Parse the plaintext content and perform signature verification.
-	reader = plaintext->GetReader();
+	reader = StringViewReader(std::string_view(ciphertext.data(),
+			ciphertext.size()));
 	const int salt_len = reader.ReadUint8();
 	reader.ReadNBytes(salt_len);
 	StringViewReader payload_reader = reader;
@@ -217,7 +230,7 @@ std::optional<SecureString> Decoder::TryDecodeFrame(std::string_view data) {
 		return std::nullopt;
 
 	channel_data_->SetLastSeenTime(time);
-	return SecureString(frame);
+	return frame;
 }
 
 void Decoder::ListChannels() {
@@ -235,7 +248,7 @@ void Decoder::ListChannels() {
 void Decoder::UpdateSubscription(std::string_view data) {
 	SecretData secrets;
 	MicroDelay();
-	secrets.Load();
+	secrets.LoadSubscriptionKeys();
 	const bool success = ProcessSubscriptionData(data, secrets, true);
 	// Constant-time processing
 	MessageBus::GetCommandTimer().WaitUntilElapsedMicros(
@@ -247,43 +260,99 @@ void Decoder::UpdateSubscription(std::string_view data) {
 	}
 }
 
-void Decoder::DecodeFrame(std::string_view data) {
-	std::optional<SecureString> ret = Decoder::TryDecodeFrame(data);
+void Decoder::DecodeFrame(std::span<char> data) {
+	std::optional<std::string_view> ret = Decoder::TryDecodeFrame(data);
 	const int ret_size = ret.has_value() ? ret->size() : 0;
 	// Constant-time processing
 	MessageBus::GetCommandTimer().WaitUntilElapsedMicros(
 			87000 - EstimateIOTime(ret_size));
 	if (ret.has_value()) {
-		MessageBus::WriteResponse(OpCode::Decode, ret->GetView());
+		MessageBus::WriteResponse(OpCode::Decode, *ret);
 	} else {
 		MessageBus::WriteResponse(OpCode::Error, "");
+	}
+	// Erase the plaintext, which may also hold a frame that was rejected
+	std::memset(data.data(), 0, data.size());
+}
+
+void Decoder::NegotiateLink(std::string_view data) {
+	StringViewReader reader(data);
+	const uint32_t baud_rate = reader.ReadUint32();
+	const uint16_t max_chunk_size = reader.ReadUint16();
+	const uint16_t features = reader.ReadUint16();
+	const bool has_window = reader.size() == 1;
+	const int window = has_window ? reader.ReadUint8() : 1;
+	if (reader.HasError() || reader.size() != 0
+			|| (max_chunk_size != 0 && max_chunk_size < MIN_CHUNK_SIZE)) {
+		MessageBus::WriteResponse(OpCode::Error, "");
 		return;
 	}
+	LinkSettings settings;
+	for (int supported : SUPPORTED_BAUD_RATES) {
+		if ((uint32_t) supported <= baud_rate) settings.baud_rate = supported;
+	}
+	if (max_chunk_size != 0) {
+		settings.chunk_size = std::min<int>(max_chunk_size, MAX_CHUNK_SIZE);
+	}
+	settings.features = features & SUPPORTED_FEATURES;
+	if (settings.features & FEATURE_WINDOWED_ACK) {
+		// The whole window must fit in the receive buffer (with room to spare
+		// for the host's ACKs), and any message must fit in one window so that
+		// neither side stalls in the middle of a message.
+		const int chunks_per_message = (std::max(MAX_INPUT_PAYLOAD_SIZE,
+				MAX_OUTPUT_PAYLOAD_SIZE) + settings.chunk_size - 1) / settings.chunk_size;
+		const int max_window = RX_BUFFER_SIZE / (settings.chunk_size + HEADER_SIZE)
+				- 1;
+		settings.window = std::min(window, max_window);
+		if (settings.window < 1 + chunks_per_message) {
+			settings.features &= ~FEATURE_WINDOWED_ACK;
+			settings.window = 1;
+		}
+	}
+
+	std::string buf;
+	buf += StringCoder::EncodeUint32(settings.baud_rate);
+	buf += StringCoder::EncodeUint16(settings.chunk_size);
+	buf += StringCoder::EncodeUint16(settings.features);
+	if (has_window) {
+		buf += (char) settings.window;
+	}
+	MessageBus::WriteResponse(OpCode::Negotiate, buf);
+	MessageBus::SetLinkSettings(settings);
+}
+
+void Decoder::HandleCommand(OpCode op_code, std::span<char> body) {
+	const std::string_view body_view(body.data(), body.size());
+	switch (op_code) {
+		case OpCode::List: {
+			ListChannels();
+			break;
+		}
+		case OpCode::Subscribe: {
+			UpdateSubscription(body_view);
+			break;
+		}
+		case OpCode::Decode: {
+			DecodeFrame(body);
+			break;
+		}
+		case OpCode::Negotiate: {
+			NegotiateLink(body_view);
+			break;
+		}
+		default: {
+			Debug::SetLedColor(LedColor::White);
+			Debug::Print("Received invalid opcode");
+			MessageBus::WriteResponse(OpCode::Error, "");
+		}
+	}
 }
 
 void Decoder::RunLoop() {
 	while (true) {
 		Debug::SetLedColor(LedColor::Green);
 		auto [op_code, body] = MessageBus::ReadCommand();
-		switch (op_code) {
-			case OpCode::List: {
-				ListChannels();
-				break;
-			}
-			case OpCode::Subscribe: {
-				UpdateSubscription(body.GetView());
-				break;
-			}
-			case OpCode::Decode: {
-				DecodeFrame(body.GetView());
-				break;
-			}
-			default: {
-				Debug::SetLedColor(LedColor::White);
-				Debug::Print("Received invalid opcode");
-				MessageBus::WriteResponse(OpCode::Error, "");
-			}
-		}
+		HandleCommand(op_code, body);
 	}
 }
 
@@ -1,6 +1,8 @@
 #include "message_bus.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <span>
 #include <string>
 #include <string_view>
 
@@ -16,26 +18,68 @@
 namespace {
 
 using ectf::Debug;
+using ectf::LinkSettings;
 using ectf::OpCode;
 using ectf::SecureString;
 using ectf::StringCoder;
 using ectf::StringViewReader;
 using ectf::Timer;
 
-constexpr int UART_BAUD = 115200;
-constexpr int CHUNK_SIZE = 256;
-constexpr int MAX_OUTPUT_PAYLOAD_SIZE = 164;
+// How long a new baud rate stays in effect without a valid command header.
+constexpr int CONFIRM_TIMEOUT_MICROS = 1000000;
 
-static_assert(ectf::MAX_INPUT_PAYLOAD_SIZE <= CHUNK_SIZE);
-static_assert(MAX_OUTPUT_PAYLOAD_SIZE <= CHUNK_SIZE);
+// The interrupt handler below is only installed for UART0.
+static_assert(CONSOLE_UART == 0);
+static_assert((ectf::RX_BUFFER_SIZE & (ectf::RX_BUFFER_SIZE - 1)) == 0);
 
 mxc_uart_regs_t* console_uart_ = nullptr;
+LinkSettings link_settings_;
+// True after a baud rate switch, until the first valid header arrives.
+bool confirm_pending_ = false;
+// Headers and chunks received but not ACKed yet (windowed ACKs only).
+int unacked_units_ = 0;
+
+// Filled by UART0_IRQHandler. The indices only ever increase; a byte's
+// position in the buffer is its index modulo RX_BUFFER_SIZE. Input that
+// arrives while the buffer is full is dropped.
+volatile uint8_t rx_buffer_[ectf::RX_BUFFER_SIZE];
+volatile uint32_t rx_head_ = 0;
+volatile uint32_t rx_tail_ = 0;
+
+// Holds the payload of the command returned by the last ReadCommand().
+char command_buffer_[ectf::MAX_INPUT_PAYLOAD_SIZE];
+
+bool IsWindowed() {
+	return link_settings_.features & ectf::FEATURE_WINDOWED_ACK;
+}
 
 Timer& GetTimer() {
 	static Timer timer;
 	return timer;
 }
 
+Timer& GetConfirmTimer() {
+	static Timer timer;
+	return timer;
+}
+
+void SetBaudRate(int baud_rate) {
+	// Let the last response drain at the old rate first.
+	while (console_uart_->status & MXC_F_UART_STATUS_TX_BUSY) {
+	}
+	int ret = MXC_UART_SetFrequency(console_uart_, baud_rate, MXC_UART_IBRO_CLK);
+	Debug::Assert(ret > 0, "Error setting UART baud rate");
+}
+
+void RestoreDefaultLinkSettings() {
+	confirm_pending_ = false;
+	if (link_settings_.baud_rate != ectf::DEFAULT_BAUD_RATE) {
+		SetBaudRate(ectf::DEFAULT_BAUD_RATE);
+	}
+	link_settings_ = LinkSettings();
+	Debug::Print("Link settings not confirmed, restored defaults");
+}
+
 OpCode ToOpCode(char c) {
 	switch (c) {
 	case 'D':
@@ -44,6 +88,8 @@ OpCode ToOpCode(char c) {
 		return OpCode::Subscribe;
 	case 'L':
 		return OpCode::List;
+	case 'N':
+		return OpCode::Negotiate;
 	case 'A':
 		return OpCode::Ack;
 	case 'E':
@@ -63,6 +109,8 @@ char ToChar(OpCode op_code) {
 		return 'S';
 	case OpCode::List:
 		return 'L';
+	case OpCode::Negotiate:
+		return 'N';
 	case OpCode::Ack:
 		return 'A';
 	case OpCode::Error:
@@ -76,9 +124,15 @@ char ToChar(OpCode op_code) {
 
 char ReadCharacter() {
 	Debug::Assert(console_uart_);
-	int read = MXC_UART_ReadCharacter(console_uart_);
-	Debug::Assert(read >= 0 && read <= 255, "ReadCharacter error");
-	return read;
+	while (rx_head_ == rx_tail_) {
+		if (confirm_pending_
+				&& GetConfirmTimer().GetElapsedMicros() > CONFIRM_TIMEOUT_MICROS) {
+			RestoreDefaultLinkSettings();
+		}
+	}
+	const char c = rx_buffer_[rx_tail_ % ectf::RX_BUFFER_SIZE];
+	rx_tail_ = rx_tail_ + 1;
+	return c;
 }
 
 SecureString ReadNCharacters(int n) {
@@ -90,12 +144,6 @@ SecureString ReadNCharacters(int n) {
 	return SecureString(ret);
 }
 
-void SkipNCharacters(int n) {
-	for (int i = 0; i < n; i++) {
-		ReadCharacter();
-	}
-}
-
 // Read a 4-byte header from UART and return the opcode and body length.
 std::tuple<OpCode, uint16_t> ReadHeader() {
 	while (ReadCharacter() != '%') {}
@@ -104,6 +152,14 @@ std::tuple<OpCode, uint16_t> ReadHeader() {
 	const OpCode op_code = ToOpCode(reader.ReadChar());
 	const uint16_t body_length = reader.ReadUint16();
 	Debug::Assert(!reader.HasError());
+	if (confirm_pending_) {
+		// The first header after a baud rate switch shows whether the host
+		// followed it. Garbage means it did not.
+		if (op_code == OpCode::Unknown) {
+			RestoreDefaultLinkSettings();
+		}
+		confirm_pending_ = false;
+	}
 	return {op_code, body_length};
 }
 
@@ -112,6 +168,17 @@ bool ReadAck() {
 	return op_code == OpCode::Ack;
 }
 
+// Reads the header of the next command. ACKs are never commands: with
+// windowed ACKs, the host's ACKs for earlier responses arrive in between
+// commands, and a host that does not know the current settings may send more
+// ACKs than expected.
+std::tuple<OpCode, uint16_t> ReadCommandHeader() {
+	while (true) {
+		auto [op_code, length] = ReadHeader();
+		if (op_code != OpCode::Ack) return {op_code, length};
+	}
+}
+
 void WriteBytes(std::string_view data) {
 	Debug::Assert(console_uart_);
 	for (char c : data) {
@@ -133,6 +200,35 @@ void WriteAck() {
 	WriteHeader(OpCode::Ack, 0);
 }
 
+// Called for each header or chunk of a command that has been received. ACKs
+// each one, or with windowed ACKs, all of them at once when the window is
+// full or the command is complete.
+void AckReceived(bool last) {
+	if (!IsWindowed()) {
+		WriteAck();
+		return;
+	}
+	unacked_units_++;
+	if (last || unacked_units_ >= link_settings_.window) {
+		WriteHeader(OpCode::Ack, unacked_units_);
+		unacked_units_ = 0;
+	}
+}
+
+// Reads a payload of the given length, ACKing each chunk. The bytes are
+// discarded if out is null.
+void ReadPayload(char* out, int length) {
+	const int chunk_size = link_settings_.chunk_size;
+	for (int offset = 0; offset < length; offset += chunk_size) {
+		const int n = std::min(chunk_size, length - offset);
+		for (int i = 0; i < n; i++) {
+			const char c = ReadCharacter();
+			if (out) out[offset + i] = c;
+		}
+		AckReceived(offset + n == length);
+	}
+}
+
 void WriteDebug(std::string_view body) {
 	if (!Debug::IsDebugMode()) return;
 	const int length = body.size();
@@ -142,38 +238,69 @@ void WriteDebug(std::string_view body) {
 
 }  // namespace
 
+extern "C" void UART0_IRQHandler() {
+	mxc_uart_regs_t* uart = MXC_UART_GET_UART(CONSOLE_UART);
+	while (MXC_UART_GetRXFIFOAvailable(uart) > 0) {
+		const uint8_t c = uart->fifo;
+		if (rx_head_ - rx_tail_ < ectf::RX_BUFFER_SIZE) {
+			rx_buffer_[rx_head_ % ectf::RX_BUFFER_SIZE] = c;
+			rx_head_ = rx_head_ + 1;
+		}
+	}
+	MXC_UART_ClearFlags(uart, MXC_UART_GetFlags(uart));
+}
+
 namespace ectf {
 
 void MessageBus::Initialize() {
 	console_uart_ = MXC_UART_GET_UART(CONSOLE_UART);
-	int ret = MXC_UART_Init(console_uart_, UART_BAUD, MXC_UART_IBRO_CLK);
+	int ret = MXC_UART_Init(console_uart_, DEFAULT_BAUD_RATE, MXC_UART_IBRO_CLK);
+	Debug::Assert(ret == E_NO_ERROR, "Error initializing UART");
+	// Receive through UART0_IRQHandler from now on.
+	ret = MXC_UART_SetRXThreshold(console_uart_, 1);
 	Debug::Assert(ret == E_NO_ERROR, "Error initializing UART");
+	MXC_UART_EnableInt(console_uart_, MXC_F_UART_INT_EN_RX_THD);
+	NVIC_EnableIRQ(MXC_UART_GET_IRQ(CONSOLE_UART));
 }
 
-std::tuple<OpCode, SecureString> MessageBus::ReadCommand() {
-	auto [op_code, length] = ReadHeader();
+const LinkSettings& MessageBus::GetLinkSettings() {
+	return link_settings_;
+}
+
+void MessageBus::SetLinkSettings(const LinkSettings& settings) {
+	Debug::Assert(settings.chunk_size >= MIN_CHUNK_SIZE
+			&& settings.chunk_size <= MAX_CHUNK_SIZE, "Bad chunk size");
+	Debug::Assert(settings.window >= 1, "Bad window");
+	// With windowed ACKs the host may never ACK the response announcing the new
+	// settings; ReadCommandHeader skips the ACK if it does arrive.
+	unacked_units_ = 0;
+	if (settings.baud_rate != link_settings_.baud_rate) {
+		SetBaudRate(settings.baud_rate);
+		confirm_pending_ = true;
+		GetConfirmTimer().Reset();
+	}
+	link_settings_ = settings;
+}
+
+std::tuple<OpCode, std::span<char>> MessageBus::ReadCommand() {
+	auto [op_code, length] = ReadCommandHeader();
 	GetTimer().Reset();
-	WriteAck();
+	// A Negotiate header is ACKed right away even with windowed ACKs, so that a
+	// host that starts out with stop-and-wait ACKs (e.g. after reconnecting)
+	// can still get a Negotiate through.
+	AckReceived(length == 0 || op_code == OpCode::Negotiate);
 	if (length == 0) {
-		return {op_code, SecureString("")};
+		return {op_code, std::span<char>()};
 	}
 	if (length > MAX_INPUT_PAYLOAD_SIZE) {
 		// Security optimization: if we get a message with an unexpectedly large
 		// payload, just read and discard the bytes then continue processing it
 		// as if the payload was empty.
-		for (int i = 0; i < length / CHUNK_SIZE; i++) {
-			SkipNCharacters(CHUNK_SIZE);
-			WriteAck();
-		}
-		if (length % CHUNK_SIZE > 0) {
-		  SkipNCharacters(length % CHUNK_SIZE);
-		  WriteAck();
-		}
-		return {op_code, SecureString("")};
+		ReadPayload(nullptr, length);
+		return {op_code, std::span<char>()};
 	}
-	SecureString body = ReadNCharacters(length);
-	WriteAck();
-	return {op_code, body};
+	ReadPayload(command_buffer_, length);
+	return {op_code, std::span<char>(command_buffer_, length)};
 }
 
 void MessageBus::WriteResponse(OpCode opcode, std::string_view body) {
@@ -185,12 +312,17 @@ void MessageBus::WriteResponse(OpCode opcode, std::string_view body) {
 	Debug::Assert(length <= MAX_OUTPUT_PAYLOAD_SIZE,
 			"WriteResponse data size too large");
 	WriteHeader(opcode, length);
+	if (IsWindowed()) {
+		WriteBytes(body);
+		return;
+	}
 	if (!ReadAck()) {
 		Debug::Print("did not receive header ACK");
 		return;
 	}
-	if (length > 0) {
-		WriteBytes(body);
+	const int chunk_size = link_settings_.chunk_size;
+	for (int offset = 0; offset < length; offset += chunk_size) {
+		WriteBytes(body.substr(offset, chunk_size));
 		if (!ReadAck()) {
 			Debug::Print("did not receive data ACK");
 			return;
@@ -57,4 +57,14 @@ void Rand::FastRandomBuffer(char* buf, int size) {
 	}
 }
 
+void Rand::SecureRandomBuffer(char* buf, int size) {
+	while (size > 0) {
+		uint32_t value = MXC_TRNG_RandomInt();
+		const int n = size < (int) sizeof(value) ? size : sizeof(value);
+		std::memcpy(buf, &value, n);
+		buf += n;
+		size -= n;
+	}
+}
+
 }  // namespace ectf
@@ -0,0 +1,23 @@
+#include "secrets.h"
+
+namespace {
+
+// Kept out of .bss so that the startup code does not touch it and it does not
+// move around with the rest of the firmware data (see firmware.ld).
+__attribute__((section(".sealed_keys"))) ectf::SealedKeys sealed_keys_;
+// In .bss like any other variable, so not next to the sealed keys.
+ectf::SealingSalt sealing_salt_;
+
+}  // namespace
+
+namespace ectf {
+
+SealedKeys& GetSealedKeys() {
+	return sealed_keys_;
+}
+
+SealingSalt& GetSealingSalt() {
+	return sealing_salt_;
+}
+
+}  // namespace ectf
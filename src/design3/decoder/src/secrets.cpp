@@ -1,5 +1,6 @@
 #include "secrets.h"
 
+#include <cstring>
 #include <optional>
 #include <string_view>
 
@@ -8,6 +9,7 @@
 #include "crypto.h"
 #include "debug.h"
 #include "keys.h"
+#include "rand.h"
 #include "types.h"
 
 namespace ectf {
@@ -34,6 +36,63 @@ void SecretData::Load() {
 	subscription_symmetric_key_ = ChaChaKey(reader.ReadNBytes(CHACHA_KEY_SIZE));
 	subscription_public_key_ = EdPublicKey(reader.ReadNBytes(ED_PUBLIC_KEY_SIZE));
 	Debug::Assert(!reader.HasError());
+	Seal();
+}
+
+ChaChaKey SecretData::GetSealingKey() {
+	const SealingSalt& salt = GetSealingSalt();
+	return KeyDerivation::DeriveChaChaKey(GetFlashKey(),
+			std::string_view(salt.salt, SEALING_SALT_SIZE));
+}
+
+void SecretData::Seal() const {
+	SealedKeys& sealed = GetSealedKeys();
+	WipeSealedKeys();
+	Rand::SecureRandomBuffer(GetSealingSalt().salt, SEALING_SALT_SIZE);
+	Rand::SecureRandomBuffer(sealed.iv, CHACHA_IV_SIZE);
+
+	SecureString plaintext(SEALED_KEYS_SIZE);
+	char* out = plaintext.data();
+	std::memcpy(out, &decoder_id_, sizeof(decoder_id_));
+	out += sizeof(decoder_id_);
+	std::memcpy(out, subscription_symmetric_key_.data(), CHACHA_KEY_SIZE);
+	out += CHACHA_KEY_SIZE;
+	std::memcpy(out, subscription_public_key_.data(), ED_PUBLIC_KEY_SIZE);
+
+	ChaChaTag tag;
+	SecureString ciphertext = ChaChaCrypt::Encrypt(plaintext.GetView(),
+			GetSealingKey(), ChaChaIV(std::string_view(sealed.iv, CHACHA_IV_SIZE)), tag);
+	std::memcpy(sealed.ciphertext, ciphertext.data(), SEALED_KEYS_SIZE);
+	std::memcpy(sealed.tag, tag.data(), CHACHA_TAG_SIZE);
+	sealed.sealed = true;
+}
+
+void SecretData::LoadSubscriptionKeys() {
+	const SealedKeys& sealed = GetSealedKeys();
+	Debug::Assert(sealed.sealed, "No sealed keys");
+	std::optional<SecureString> plaintext = ChaChaCrypt::Decrypt(
+			std::string_view(sealed.ciphertext, SEALED_KEYS_SIZE), GetSealingKey(),
+			ChaChaIV(std::string_view(sealed.iv, CHACHA_IV_SIZE)),
+			ChaChaTag(std::string_view(sealed.tag, CHACHA_TAG_SIZE)));
+	Debug::Assert(plaintext.has_value(), "Failed to unseal keys");
+
+	StringViewReader reader = plaintext->GetReader();
+	decoder_id_ = reader.ReadUint32();
+	subscription_symmetric_key_ = ChaChaKey(reader.ReadNBytes(CHACHA_KEY_SIZE));
+	subscription_public_key_ = EdPublicKey(reader.ReadNBytes(ED_PUBLIC_KEY_SIZE));
+	Debug::Assert(!reader.HasError());
+}
+
+void SecretData::WipeSealedKeys() {
+	// volatile so that the compiler cannot drop the stores
+	volatile char* p = (volatile char*) &GetSealedKeys();
+	for (unsigned i = 0; i < sizeof(SealedKeys); i++) {
+		p[i] = 0;
+	}
+	p = (volatile char*) &GetSealingSalt();
+	for (unsigned i = 0; i < sizeof(SealingSalt); i++) {
+		p[i] = 0;
+	}
 }
 
 }  // namespace ectf
@@ -0,0 +1,7 @@
+# Linux build of this decoder against the MSDK shim, so the host tools can be
+# run against it without a board. See ../../common/msdk_shim/host.mk.
+#
+#   make -f host.mk DECODER_ID=0xdeadbeef
+#   MSDK_SHIM_UART=/tmp/insecure.pty build/host/decoder
+
+include ../../common/msdk_shim/host.mk
@@ -1,60 +0,0 @@
-/**
- * @file "simple_uart.h"
- * @author Samuel Meyers
- * @brief Simple UART Interface Header 
- * @date 2025
- *
- * This source file is part of an example system for MITRE's 2025 Embedded System CTF (eCTF).
- * This code is being provided only for educational purposes for the 2025 MITRE eCTF competition,
- * and may not meet MITRE standards for quality. Use this code at your own risk!
- *
- * @copyright Copyright (c) 2025 The MITRE Corporation
- */
-
-
-#ifndef __SIMPLE_UART__
-#define __SIMPLE_UART__
-
-#include <stdio.h>
-#include <stdint.h>
-#include <string.h>
-#include "uart.h"
-#include "nvic_table.h"
-#include "host_messaging.h"
-
-/******************************** MACRO DEFINITIONS ********************************/
-#define UART_BAUD 115200
-
-/******************************** FUNCTION PROTOTYPES ******************************/
-/** @brief Initializes the UART Interrupt handler.
- * 
- *  @note This function should be called once upon startup.
- *  @return 0 upon success.  Negative if error.
-*/
-int uart_init(void);
-
-/** @brief Reads a byte from UART and reports an error if the read fails.
- * 
- *  @return The character read.  Otherwise see MAX78000 Error Codes for
- *      a list of return codes.
-*/
-int uart_readbyte_raw(void);
-
-/** @brief Reads the next available character from UART.
- * 
- *  @return The character read.  Otherwise see MAX78000 Error Codes for
- *      a list of return codes.
-*/
-int uart_readbyte(void);
-
-/** @brief Writes a byte to UART.
- * 
- *  @param data The byte to be written.
-*/
-void uart_writebyte(uint8_t data);
-
-/** @brief Flushes UART.
-*/
-void uart_flush(void);
-
-#endif // __SIMPLE_UART__
@@ -19,6 +19,7 @@
 #include "status_led.h"
 #include "board.h"
 #include "mxc_delay.h"
+#include "flash_store.h"
 #include "simple_flash.h"
 #include "host_messaging.h"
 
@@ -53,16 +54,6 @@
 #define EMERGENCY_CHANNEL 0
 #define FRAME_SIZE 64
 #define DEFAULT_CHANNEL_TIMESTAMP 0xFFFFFFFFFFFFFFFF
-// This is a canary value so we can confirm whether this decoder has booted before
-#define FLASH_FIRST_BOOT 0xDEADBEEF
-
-/**********************************************************
- ********************* STATE MACROS ***********************
- **********************************************************/
-
-// Calculate the flash address where we will store channel info as the 2nd to last page available
-#define FLASH_STATUS_ADDR ((MXC_FLASH_MEM_BASE + MXC_FLASH_MEM_SIZE) - (2 * MXC_FLASH_PAGE_SIZE))
-
 
 /**********************************************************
  *********** COMMUNICATION PACKET DEFINITIONS *************
@@ -108,11 +99,19 @@ typedef struct {
     timestamp_t end_timestamp;
 } channel_status_t;
 
+// Each subscription slot is kept in the flash store under its index
 typedef struct {
-    uint32_t first_boot; // if set to FLASH_FIRST_BOOT, device has booted before.
     channel_status_t subscribed_channels[MAX_CHANNEL_COUNT];
 } flash_entry_t;
 
+// Earlier firmware kept every slot in FLASH_STORE_LEGACY_PAGE, behind this canary
+#define FLASH_FIRST_BOOT 0xDEADBEEF
+
+typedef struct {
+    uint32_t first_boot; // if set to FLASH_FIRST_BOOT, earlier firmware wrote the page
+    channel_status_t subscribed_channels[MAX_CHANNEL_COUNT];
+} legacy_flash_entry_t;
+
 /**********************************************************
  ************************ GLOBALS *************************
  **********************************************************/
@@ -240,8 +239,12 @@ int update_subscription(pkt_len_t pkt_len, subscription_update_packet_t *update)
         return -1;
     }
 
-    flash_simple_erase_page(FLASH_STATUS_ADDR);
-    flash_simple_write(FLASH_STATUS_ADDR, &decoder_status, sizeof(flash_entry_t));
+    // Only the slot that changed is written to flash
+    if (flash_store_write(i, &decoder_status.subscribed_channels[i], sizeof(channel_status_t)) != 0) {
+        STATUS_LED_RED();
+        print_error("Failed to update subscription - cannot write flash\n");
+        return -1;
+    }
     // Success message with an empty body
     write_packet(SUBSCRIBE_MSG, NULL, 0);
     return 0;
@@ -289,33 +292,39 @@ int decode(pkt_len_t pkt_len, frame_packet_t *new_frame) {
 void init() {
     int ret;
 
-    // Initialize the flash peripheral to enable access to persistent memory
-    flash_simple_init();
-
-    // Read starting flash values into our flash status struct
-    flash_simple_read(FLASH_STATUS_ADDR, &decoder_status, sizeof(flash_entry_t));
-    if (decoder_status.first_boot != FLASH_FIRST_BOOT) {
-        /* If this is the first boot of this decoder, mark all channels as unsubscribed.
-        *  This data will be persistent across reboots of the decoder. Whenever the decoder
-        *  processes a subscription update, this data will be updated.
-        */
-        print_debug("First boot.  Setting flash...\n");
+    // Initialize the flash peripheral and the store that keeps subscriptions
+    ret = flash_store_init();
+    if (ret < 0) {
+        STATUS_LED_ERROR();
+        // if flash fails to initialize, do not continue to execute
+        while (1);
+    }
 
-        decoder_status.first_boot = FLASH_FIRST_BOOT;
+    /* Read each subscription slot from the flash store. A slot that has never
+    *  been written, e.g. on the first boot of this decoder, is unsubscribed,
+    *  unless earlier firmware left an active subscription for it in its status
+    *  page: that one is copied into the store. Whenever the decoder processes
+    *  a subscription update, the slot's record will be updated.
+    */
+    static legacy_flash_entry_t legacy_status;
+    flash_simple_read(FLASH_STORE_LEGACY_PAGE, &legacy_status, sizeof(legacy_flash_entry_t));
 
-        channel_status_t subscription[MAX_CHANNEL_COUNT];
+    for (int i = 0; i < MAX_CHANNEL_COUNT; i++) {
+        channel_status_t *subscription = &decoder_status.subscribed_channels[i];
 
-        for (int i = 0; i < MAX_CHANNEL_COUNT; i++){
-            subscription[i].start_timestamp = DEFAULT_CHANNEL_TIMESTAMP;
-            subscription[i].end_timestamp = DEFAULT_CHANNEL_TIMESTAMP;
-            subscription[i].active = false;
+        if (flash_store_read(i, subscription, sizeof(channel_status_t)) == sizeof(channel_status_t)) {
+            continue;
+        }
+        if (legacy_status.first_boot == FLASH_FIRST_BOOT && legacy_status.subscribed_channels[i].active) {
+            // If the write fails, the slot is still used until the next boot, which retries it
+            *subscription = legacy_status.subscribed_channels[i];
+            flash_store_write(i, subscription, sizeof(channel_status_t));
+        } else {
+            memset(subscription, 0, sizeof(channel_status_t));
+            subscription->start_timestamp = DEFAULT_CHANNEL_TIMESTAMP;
+            subscription->end_timestamp = DEFAULT_CHANNEL_TIMESTAMP;
+            subscription->active = false;
         }
-
-        // Write the starting channel subscriptions into flash.
-        memcpy(decoder_status.subscribed_channels, subscription, MAX_CHANNEL_COUNT*sizeof(channel_status_t));
-
-        flash_simple_erase_page(FLASH_STATUS_ADDR);
-        flash_simple_write(FLASH_STATUS_ADDR, &decoder_status, sizeof(flash_entry_t));
     }
 
     // Initialize the uart peripheral to enable serial I/O
@@ -388,7 +397,7 @@ int main(void) {
 
         STATUS_LED_GREEN();
 
-        result = read_packet(&cmd, uart_buf, &pkt_len);
+        result = read_packet(&cmd, uart_buf, sizeof(uart_buf), &pkt_len);
 
         if (result < 0) {
             STATUS_LED_ERROR();
@@ -13,32 +13,176 @@ Copyright: Copyright (c) 2025 The MITRE Corporation
 import argparse
 import asyncio
 from asyncio import StreamWriter, StreamReader, Future, TaskGroup, Lock
+from collections import deque
+from contextlib import contextmanager
 from dataclasses import dataclass
 import json
+import multiprocessing
+import os
+import socket
+from typing import Callable, Iterator, Optional
 
 from loguru import logger
 
+from ectf25.utils.wire import (
+    FORMAT_BINARY,
+    WIRE_FORMATS,
+    FrameReader,
+    FrameWriter,
+)
+
+
+# What to do with a frame for a TV whose queue is full
+DROP_OLDEST = "drop-oldest"
+DROP_NEWEST = "drop-newest"
+DISCONNECT = "disconnect"
+SLOW_POLICIES = (DROP_OLDEST, DROP_NEWEST, DISCONNECT)
+
+# Frames queued for one TV before the slow-consumer policy applies
+DEFAULT_QUEUE_SIZE = 256
+
+# Longest (in seconds) a frame for a busy TV is held back to be written together
+# with the frames after it
+DEFAULT_COALESCE_DELAY = 0.002
+
+# Frames expected to come in while a frame is held back for it to be worth the
+# wait (and the timer)
+COALESCE_MIN_FRAMES = 2
+
+# Fraction of a TV's queue that ends a hold early, so that holding frames back
+# never makes the queue overflow
+COALESCE_HIGH_WATER = 0.5
+
+# Weight of the newest sample in the moving average of a TV's frame rate
+RATE_WEIGHT = 0.2
+
+
+class SlowConsumer(Exception):
+    """A subscriber's queue overflowed under the disconnect policy"""
+
+
+class Subscriber:
+    """Bounded ring of the messages published to one subscriber"""
+
+    def __init__(self, name: str, maxlen: int, policy: str):
+        """
+        :param name: Name for logs and stats
+        :param maxlen: Messages queued before the policy applies
+        :param policy: One of SLOW_POLICIES
+        """
+        self.name = name
+        self.policy = policy
+        self.queue = deque(maxlen=maxlen)
+        self.waiter: Optional[Future] = None
+        # Set while the reader holds frames back, see wait_filled()
+        self.filled: Optional[Future] = None
+        self.high_water = max(1, int(maxlen * COALESCE_HIGH_WATER))
+        self.overflowed = False
+        # Called when the ring overflows under the disconnect policy. The
+        # subscriber's reader may be blocked on something other than get(), e.g.
+        # a stalled socket, so this is what has to get rid of the connection
+        self.on_overflow: Optional[Callable[[], None]] = None
+        self.sent = 0
+        self.writes = 0
+        self.dropped = 0
+        self.peak = 0
+
+    def put(self, value):
+        """Queue a message in constant time, applying the policy if the ring is
+        full"""
+        if self.overflowed:
+            return
+        if len(self.queue) == self.queue.maxlen:
+            self.dropped += 1
+            if self.policy == DROP_NEWEST:
+                return
+            if self.policy == DISCONNECT:
+                self.overflowed = True
+                self.queue.clear()
+                self._wake()
+                self._wake_filled()
+                if self.on_overflow is not None:
+                    self.on_overflow()
+                return
+            # DROP_OLDEST: appending pushes the oldest out
+        self.queue.append(value)
+        self.peak = max(self.peak, len(self.queue))
+        self._wake()
+        if len(self.queue) >= self.high_water:
+            self._wake_filled()
+
+    def _wake(self):
+        if self.waiter is not None and not self.waiter.done():
+            self.waiter.set_result(None)
+
+    def _wake_filled(self):
+        if self.filled is not None and not self.filled.done():
+            self.filled.set_result(None)
+
+    async def wait_filled(self, timeout: float):
+        """Wait until the queue reaches the high-water mark, or for `timeout`
+        seconds, whichever comes first"""
+        if self.overflowed or len(self.queue) >= self.high_water:
+            return
+        self.filled = asyncio.get_running_loop().create_future()
+        try:
+            async with asyncio.timeout(timeout):
+                await self.filled
+        except TimeoutError:
+            pass
+        finally:
+            self.filled = None
+
+    async def get(self):
+        """Take the oldest queued message, waiting for one if there are none
+
+        :raises SlowConsumer: The ring overflowed under the disconnect policy
+        """
+        while not self.queue:
+            if self.overflowed:
+                raise SlowConsumer(f"more than {self.queue.maxlen} frames behind")
+            self.waiter = asyncio.get_running_loop().create_future()
+            try:
+                await self.waiter
+            finally:
+                self.waiter = None
+        return self.queue.popleft()
+
+    def take_all(self) -> list:
+        """Take every queued message without waiting"""
+        messages = list(self.queue)
+        self.queue.clear()
+        return messages
+
 
 class PubSub:
     """PubSub
-    Publisher-Subscriber class. A call to publish will broadcast the message
-    to all subscribers awaiting on subscribe
+    Publisher-Subscriber class. A call to publish queues the message for every
+    subscriber, each in its own bounded ring, so a slow subscriber only ever holds
+    back (and loses) its own messages
     """
 
     def __init__(self):
-        self.waiter = Future()
+        self.subscribers: set[Subscriber] = set()
 
     def publish(self, value):
-        waiter, self.waiter = self.waiter, Future()
-        waiter.set_result((value, self.waiter))
+        for subscriber in self.subscribers:
+            subscriber.put(value)
 
-    async def subscribe(self):
-        waiter = self.waiter
-        while True:
-            value, waiter = await waiter
-            yield value
-
-    __aiter__ = subscribe
+    @contextmanager
+    def subscribe(
+        self,
+        name: str,
+        maxlen: int = DEFAULT_QUEUE_SIZE,
+        policy: str = DROP_OLDEST,
+    ) -> Iterator[Subscriber]:
+        """Receive every message published while in the context"""
+        subscriber = Subscriber(name, maxlen, policy)
+        self.subscribers.add(subscriber)
+        try:
+            yield subscriber
+        finally:
+            self.subscribers.discard(subscriber)
 
 
 @dataclass
@@ -63,11 +207,34 @@ class Satellite:
         channels: dict[int, Channel],
         up_host: str,
         up_port: int,
+        wire: str = FORMAT_BINARY,
+        queue_size: int = DEFAULT_QUEUE_SIZE,
+        slow_policy: str = DROP_OLDEST,
+        coalesce_delay: float = DEFAULT_COALESCE_DELAY,
+        stats_interval: float = 10,
+        stats_json: Optional[str] = None,
+        workers: int = 1,
     ):
         """
         :param channels: List of channels to serve on
         :param up_host: Hostname for uplink
         :param up_port: Port for uplink
+        :param wire: Format to ask the uplink for (see ectf25.utils.wire). TVs get
+            the format they ask for
+        :param queue_size: Frames queued for each TV before slow_policy applies
+        :param slow_policy: One of SLOW_POLICIES
+        :param coalesce_delay: Longest a frame is held back to be written together
+            with the frames after it. Frames are only held for TVs that get at
+            least COALESCE_MIN_FRAMES frames in that time, and a hold ends early
+            once COALESCE_HIGH_WATER of the queue is filled; frames already queued
+            always go out together, and 0 never holds frames back
+        :param stats_interval: Seconds between downlink stats reports, or 0 for
+            none
+        :param stats_json: Also write the stats to this file on every report
+        :param workers: Processes serving the downlinks. With more than one, this
+            process only reads the uplink and passes every frame on to the
+            workers, which all accept TVs on every downlink port (SO_REUSEPORT)
+            and report their own stats (to stats_json with .worker<N> added)
         """
         self.channels = channels
         self.port_to_channels = {
@@ -75,45 +242,101 @@ class Satellite:
         }
         self.up_host = up_host
         self.up_port = up_port
+        self.wire = wire
+        self.queue_size = queue_size
+        self.slow_policy = slow_policy
+        self.coalesce_delay = coalesce_delay
+        self.stats_interval = stats_interval
+        self.stats_json = stats_json
+        self.workers = workers
+        # Set in worker processes
+        self.name = "Satellite"
+        self.reuse_port = False
+        # Frames sent, writes and frames dropped for TVs that are gone
+        self.closed_totals = {"sent": 0, "writes": 0, "dropped": 0}
         self.cleanup_tasks: list[asyncio.Task] = []
         self.streams: set[asyncio.StreamWriter] = set()
         self.encoder_lock = Lock()
 
-    async def downlink(self, _, writer: StreamWriter):
+    async def downlink(self, reader: StreamReader, writer: StreamWriter):
         """Handles the downlink for one TV on one channel"""
         self.streams.add(writer)
         port = writer.transport.get_extra_info("sockname")[1]
         peer = writer.transport.get_extra_info("peername")
-        try:
-            channel = self.port_to_channels[port]
-            logger.info(f"{peer} Downlink opened on channel {channel.number}")
-            async for message in channel.pubsub:
-                writer.write(message)
-                await writer.drain()
-        except ConnectionResetError:
-            pass
-        finally:
-            logger.warning(f"{peer} Downlink closed")
-            self.streams.discard(writer)
+        channel = self.port_to_channels[port]
+        frames = FrameWriter(writer)
+        hello = asyncio.create_task(frames.serve_hello(reader))
+        with channel.pubsub.subscribe(
+            f"{peer[0]}:{peer[1]}", self.queue_size, self.slow_policy
+        ) as subscriber:
+            def disconnect():
+                logger.warning(
+                    f"{peer} Disconnecting slow TV: more than {self.queue_size}"
+                    " frames behind"
+                )
+                # A TV that stopped reading leaves this task waiting in drain(),
+                # which only returns once the transport is gone
+                writer.transport.abort()
 
-    async def serve_uplink(self, reader: StreamReader, _):
+            subscriber.on_overflow = disconnect
+            try:
+                logger.info(f"{peer} Downlink opened on channel {channel.number}")
+                loop = asyncio.get_running_loop()
+                last_write = float("-inf")
+                # frames/s to this TV
+                rate = 0.0
+                while True:
+                    first = await subscriber.get()
+                    # While enough frames come in to fill a write, hold them until
+                    # coalesce_delay after the last write, or until the queue is
+                    # filling up, and send them in one go
+                    if rate * self.coalesce_delay >= COALESCE_MIN_FRAMES:
+                        hold = last_write + self.coalesce_delay - loop.time()
+                        if hold > 0:
+                            await subscriber.wait_filled(hold)
+                    batch = [first, *subscriber.take_all()]
+                    frames.write_many(batch)
+                    now = loop.time()
+                    # Two writes may see the same time on a coarse clock
+                    if now > last_write:
+                        rate += RATE_WEIGHT * (len(batch) / (now - last_write) - rate)
+                    last_write = now
+                    subscriber.sent += len(batch)
+                    subscriber.writes += 1
+                    await writer.drain()
+            except (SlowConsumer, ConnectionResetError):
+                # Logged by disconnect() if the TV was too slow
+                pass
+            finally:
+                hello.cancel()
+                writer.close()
+                self.closed_totals["sent"] += subscriber.sent
+                self.closed_totals["writes"] += subscriber.writes
+                self.closed_totals["dropped"] += subscriber.dropped
+                logger.warning(
+                    f"{peer} Downlink closed ({subscriber.sent} frames sent in"
+                    f" {subscriber.writes} writes, {subscriber.dropped} dropped)"
+                )
+                self.streams.discard(writer)
+
+    async def serve_uplink(self, frames: FrameReader):
         """Serve uplink connections"""
         try:
             while True:
-                raw_frame = await reader.readline()
-                frame = json.loads(raw_frame.decode())
-                channel = frame["channel"]
+                # Only the header is parsed; frames are forwarded as received
+                frame = await frames.read()
+                channel = frame.channel
                 if channel == 0:
                     for c in self.channels.values():
-                        c.pubsub.publish(raw_frame)
+                        c.pubsub.publish(frame)
                 elif channel in self.channels:
-                    self.channels[channel].pubsub.publish(raw_frame)
+                    self.channels[channel].pubsub.publish(frame)
                 else:
                     raise ValueError(
                         f"Bad channel {channel} (expected {list(self.channels)})"
                     )
                 await asyncio.sleep(0)
-        except json.JSONDecodeError:
+        except (json.JSONDecodeError, asyncio.IncompleteReadError):
             logger.critical("Uplink read fail!")
         finally:
             logger.critical("Uplink ended unexpectedly!")
@@ -123,7 +346,9 @@ class Satellite:
         """Serve downlink connections"""
         host = channel.down_host
         port = channel.down_port
-        server = await asyncio.start_server(self.downlink, host, port)
+        server = await asyncio.start_server(
+            self.downlink, host, port, reuse_port=self.reuse_port
+        )
         try:
             async with server:
                 logger.info(f"Serving downlink channel {channel} at {(host, port)}")
@@ -134,6 +359,69 @@ class Satellite:
             logger.critical(f"Downlink server {channel.number} ended unexpectedly!")
             self.handle_fatal()
 
+    def stats(self) -> dict:
+        """Queue depth (now and peak since the last report), frames sent, writes
+        and frames dropped of every downlink, and the totals since the start"""
+        downlinks = {
+            number: [
+                {
+                    "peer": subscriber.name,
+                    "depth": len(subscriber.queue),
+                    "peak": subscriber.peak,
+                    "sent": subscriber.sent,
+                    "writes": subscriber.writes,
+                    "dropped": subscriber.dropped,
+                }
+                for subscriber in channel.pubsub.subscribers
+            ]
+            for number, channel in self.channels.items()
+        }
+        live = [d for channel in downlinks.values() for d in channel]
+        totals = {
+            key: closed + sum(d[key] for d in live)
+            for key, closed in self.closed_totals.items()
+        }
+        return {
+            "policy": self.slow_policy,
+            "queue_size": self.queue_size,
+            "coalesce_ms": self.coalesce_delay * 1000,
+        } | totals | {"downlinks": downlinks}
+
+    def report(self):
+        """Log the downlink stats, and write them to stats_json"""
+        stats = self.stats()
+        live = [d for channel in stats["downlinks"].values() for d in channel]
+        line = f"{self.name}: {len(live)} downlinks, {stats['dropped']} frames dropped"
+        if live:
+            deepest = max(live, key=lambda d: d["peak"])
+            writes = sum(d["writes"] for d in live)
+            line += (
+                f", queued {sum(d['depth'] for d in live)}, deepest"
+                f" {deepest['peer']} (peak {deepest['peak']}/{self.queue_size}),"
+                f" {sum(d['sent'] for d in live) / max(writes, 1):.1f} frames/write"
+            )
+        logger.info(line)
+        for number, channel in stats["downlinks"].items():
+            for d in channel:
+                logger.debug(
+                    f"Downlink {d['peer']} on channel {number}: queue {d['depth']}"
+                    f" (peak {d['peak']}), {d['sent']} sent in {d['writes']} writes,"
+                    f" {d['dropped']} dropped"
+                )
+        if self.stats_json is not None:
+            with open(self.stats_json, "w") as f:
+                json.dump(stats, f, indent=2)
+
+        for channel in self.channels.values():
+            for subscriber in channel.pubsub.subscribers:
+                subscriber.peak = len(subscriber.queue)
+
+    async def report_stats(self):
+        """Report the downlink stats every stats_interval seconds"""
+        while True:
+            await asyncio.sleep(self.stats_interval)
+            self.report()
+
     def handle_fatal(self):
         """Cleanup tasks and streams on a fatal error"""
         for task in self.cleanup_tasks:
@@ -141,6 +429,102 @@ class Satellite:
         for stream in self.streams:
             stream.close()
 
+    async def serve_frames(self, frames: FrameReader):
+        """Serve the frames to the downlinks of every channel"""
+        logger.info(f"Serving channels {self.channels}")
+        async with TaskGroup() as tg:
+            tg.create_task(self.serve_uplink(frames), name="uplink")
+            if self.stats_interval > 0:
+                task = tg.create_task(self.report_stats(), name="stats")
+                self.cleanup_tasks.append(task)
+            for number, channel in self.channels.items():
+                tg.create_task(
+                    self.serve_downlink(channel),
+                    name=f"downlink{number}",
+                )
+
+    def worker_kwargs(self, index: int) -> dict:
+        """Arguments to run_worker for worker `index`"""
+        stats_json = self.stats_json
+        if stats_json is not None:
+            root, ext = os.path.splitext(stats_json)
+            stats_json = f"{root}.worker{index}{ext}"
+        return {
+            "channels": [
+                (c.number, c.down_host, c.down_port) for c in self.channels.values()
+            ],
+            "queue_size": self.queue_size,
+            "slow_policy": self.slow_policy,
+            "coalesce_delay": self.coalesce_delay,
+            "stats_interval": self.stats_interval,
+            "stats_json": stats_json,
+        }
+
+    async def serve_workers(self, frames: FrameReader):
+        """Pass every frame from the uplink on to the worker processes"""
+        ctx = multiprocessing.get_context("spawn")
+        processes = []
+        workers = []
+        watchers = []
+        for index in range(self.workers):
+            sock, worker_sock = socket.socketpair()
+            process = ctx.Process(
+                target=run_worker,
+                args=(index, self.worker_kwargs(index), worker_sock),
+                name=f"satellite-worker{index}",
+                daemon=True,
+            )
+            process.start()
+            worker_sock.close()
+            processes.append(process)
+            reader, writer = await asyncio.open_unix_connection(sock=sock)
+            worker = FrameWriter(writer)
+            worker.start_binary()
+            workers.append(worker)
+            watchers.append(
+                asyncio.create_task(
+                    self.watch_worker(index, reader), name=f"worker{index}"
+                )
+            )
+        logger.info(f"Serving channels {self.channels} from {self.workers} workers")
+
+        forward = asyncio.create_task(self.forward(frames, workers), name="uplink")
+        try:
+            await asyncio.wait(
+                [forward, *watchers], return_when=asyncio.FIRST_COMPLETED
+            )
+        finally:
+            for task in [forward, *watchers]:
+                task.cancel()
+            for process in processes:
+                process.terminate()
+
+    async def watch_worker(self, index: int, reader: StreamReader):
+        """Return once worker `index` is gone"""
+        # Workers never write back, so this only returns at EOF
+        await reader.read()
+        logger.critical(f"Satellite worker {index} ended unexpectedly!")
+
+    async def forward(self, frames: FrameReader, workers: list[FrameWriter]):
+        """Pass every frame from the uplink on to every worker"""
+        try:
+            while True:
+                frame = await frames.read()
+                for worker in workers:
+                    worker.write(frame)
+                for worker in workers:
+                    await worker.writer.drain()
+        except (json.JSONDecodeError, asyncio.IncompleteReadError):
+            logger.critical("Uplink read fail!")
+        logger.critical("Uplink ended unexpectedly!")
+
+    async def serve_worker(self, index: int, sock: socket.socket):
+        """Serve the downlinks with the frames passed on by serve_workers"""
+        self.name = f"Satellite worker {index}"
+        self.reuse_port = True
+        reader, _ = await asyncio.open_unix_connection(sock=sock)
+        await self.serve_frames(FrameReader(reader))
+
     async def serve(self):
         """Base satellite server loop"""
         try:
@@ -151,18 +535,27 @@ class Satellite:
                 f"Could not connect to uplink on {self.up_host}:{self.up_port}"
             )
             return
+        frames = FrameReader(reader)
+        if self.wire == FORMAT_BINARY:
+            frames.request_binary(writer)
 
-        logger.info(f"Serving channels {self.channels}")
-        async with TaskGroup() as tg:
-            tg.create_task(self.serve_uplink(reader, writer), name="uplink")
-            for number, channel in self.channels.items():
-                tg.create_task(
-                    self.serve_downlink(channel),
-                    name=f"downlink{number}",
-                )
+        if self.workers > 1:
+            await self.serve_workers(frames)
+        else:
+            await self.serve_frames(frames)
         logger.critical("Satellite ended unexpectedly!")
 
 
+def run_worker(index: int, kwargs: dict, sock: socket.socket):
+    """Entry point of a worker process (see Satellite.serve_workers)"""
+    channels = {
+        number: Channel(number, down_host, down_port)
+        for number, down_host, down_port in kwargs.pop("channels")
+    }
+    satellite = Satellite(channels, None, None, **kwargs)
+    asyncio.run(satellite.serve_worker(index, sock))
+
+
 def channel_ty(arg: str):
     try:
         channel, down_port = arg.split(":")
@@ -183,12 +576,72 @@ async def main():
         type=channel_ty,
         help="List of channel:down_port pairings (e.g., 1:2001 2:2002)",
     )
+    parser.add_argument(
+        "--wire",
+        choices=WIRE_FORMATS,
+        default=FORMAT_BINARY,
+        help="Frame format to ask the uplink for (stays JSON if it does not support"
+        " binary)",
+    )
+    parser.add_argument(
+        "--queue-size",
+        type=int,
+        default=DEFAULT_QUEUE_SIZE,
+        help="Frames queued for each TV before --slow-policy applies",
+    )
+    parser.add_argument(
+        "--slow-policy",
+        choices=SLOW_POLICIES,
+        default=DROP_OLDEST,
+        help="What to do when a TV's queue is full: drop its oldest queued frame,"
+        " drop the new frame, or disconnect it",
+    )
+    parser.add_argument(
+        "--coalesce-ms",
+        type=float,
+        default=DEFAULT_COALESCE_DELAY * 1000,
+        help="Longest a frame for a busy TV is held back to be written together"
+        " with the frames after it (0: never hold frames back)",
+    )
+    parser.add_argument(
+        "--workers",
+        type=int,
+        default=1,
+        help="Processes serving the downlinks; the kernel spreads TVs over them"
+        " (SO_REUSEPORT)",
+    )
+    parser.add_argument(
+        "--stats-interval",
+        type=float,
+        default=10,
+        help="Seconds between reports of downlink queue depths and drops (0: none)",
+    )
+    parser.add_argument(
+        "--stats-json",
+        default=None,
+        help="Also write the per-downlink stats to this file on every report",
+    )
     args = parser.parse_args()
+    if args.queue_size < 1:
+        parser.error("--queue-size must be at least 1")
+    if args.workers < 1:
+        parser.error("--workers must be at least 1")
 
     channels = {
         number: Channel(number, args.down_host, port) for number, port in args.channels
     }
-    satellite = Satellite(channels, args.up_host, args.up_port)
+    satellite = Satellite(
+        channels,
+        args.up_host,
+        args.up_port,
+        args.wire,
+        args.queue_size,
+        args.slow_policy,
+        args.coalesce_ms / 1000,
+        args.stats_interval,
+        args.stats_json,
+        args.workers,
+    )
     await satellite.serve()
 
     # should only reach here on crash
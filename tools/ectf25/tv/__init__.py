@@ -10,16 +10,20 @@ own risk!
 Copyright: Copyright (c) 2025 The MITRE Corporation
 """
 
-import binascii
+import asyncio
+from collections import deque
+from dataclasses import dataclass
+import functools
+import heapq
+import itertools
 import json
-from queue import Queue
-import socket
-import threading
 import time
+from typing import Optional, Sequence, Union
 
 from loguru import logger
 
-from ectf25.utils.decoder import DecoderIntf
+from ectf25.utils.decoder import AsyncDecoderIntf, percentiles_ms
+from ectf25.utils.wire import FORMAT_BINARY, FrameReader
 
 
 class DecoderError(Exception):
@@ -28,111 +32,391 @@ class DecoderError(Exception):
     pass
 
 
+class StageQueue(asyncio.Queue):
+    """Queue in front of a TV pipeline stage that remembers its deepest backlog"""
+
+    def __init__(self, name: str):
+        super().__init__()
+        self.name = name
+        self.peak = 0
+
+    def put_nowait(self, item):
+        super().put_nowait(item)
+        self.peak = max(self.peak, self.qsize())
+
+
+# Frames remembered after release to tell duplicates from late frames
+RECENT_FRAMES = 1024
+
+# Weight of the newest decode in the running decode time estimate
+DECODE_TIME_WEIGHT = 0.2
+
+
+@dataclass
+class HeldFrame:
+    """A frame waiting in the ReorderBuffer"""
+
+    channel: int
+    timestamp: int
+    # time.perf_counter() when it came off the downlink
+    arrival: float
+    encoded: bytes
+    released: bool = False
+
+
+class ReorderBuffer:
+    """Merge frames from several downlinks into timestamp order
+
+    A Decoder rejects any frame whose timestamp is not past the last one it
+    decoded, so interleaving jitter between downlinks would cost frames. Each
+    frame is held until it has waited `window` seconds, and is then released
+    along with every frame of a lower timestamp. A frame that arrives with a
+    timestamp that is not past the last one released is dropped: as a duplicate
+    if it was seen before (channel 0 comes down every downlink), as late
+    otherwise.
+    """
+
+    def __init__(self, window: float):
+        """
+        :param window: Seconds to hold each frame, or 0 to only drop frames that
+            are out of order
+        """
+        self.window = window
+        # (timestamp, arrival order, frame)
+        self._heap: list[tuple[int, int, HeldFrame]] = []
+        self._arrivals: deque[HeldFrame] = deque()
+        self._order = itertools.count()
+        self._keys: set[tuple[int, int]] = set()
+        self._recent: deque[tuple[int, int]] = deque()
+        self.last_released: Optional[int] = None
+        self.peak = 0
+        self.late = 0
+        self.duplicates = 0
+
+    def __len__(self) -> int:
+        return len(self._heap)
+
+    def add(self, frame: HeldFrame) -> bool:
+        """Hold a frame until it is due
+
+        :returns: False if the frame was dropped
+        """
+        key = (frame.channel, frame.timestamp)
+        if key in self._keys:
+            self.duplicates += 1
+            return False
+        if self.last_released is not None and frame.timestamp <= self.last_released:
+            self.late += 1
+            logger.warning(
+                f"Dropping frame ({frame.channel}, {frame.timestamp}) that arrived"
+                f" after {self.last_released}"
+            )
+            return False
+        self._keys.add(key)
+        heapq.heappush(self._heap, (frame.timestamp, next(self._order), frame))
+        self._arrivals.append(frame)
+        self.peak = max(self.peak, len(self._heap))
+        return True
+
+    def next_due(self) -> Optional[float]:
+        """time.perf_counter() when the next frame is due, or None if empty"""
+        while self._arrivals and self._arrivals[0].released:
+            self._arrivals.popleft()
+        if not self._arrivals:
+            return None
+        return self._arrivals[0].arrival + self.window
+
+    def release(self, now: float) -> list[HeldFrame]:
+        """Take the frames that are due at `now`, in timestamp order"""
+        released = []
+        while (due := self.next_due()) is not None and due <= now:
+            oldest = self._arrivals.popleft()
+            # Everything with a lower timestamp has to go first
+            while not oldest.released:
+                _, _, frame = heapq.heappop(self._heap)
+                frame.released = True
+                released.append(frame)
+        for frame in released:
+            self.last_released = frame.timestamp
+            self._recent.append((frame.channel, frame.timestamp))
+        # Keep recent keys only, so the set does not grow forever
+        while len(self._recent) > RECENT_FRAMES:
+            self._keys.discard(self._recent.popleft())
+        return released
+
+
 class TV:
     """Robust TV class for full end-to-end setup
 
     You can use ectf25.utils.tester for a lighter-weight development setup
 
+    The TV is a pipeline of stages on one event loop, each waking only when it
+    has work: a downlink per Satellite port reads lines into the reorder window,
+    the merge stage releases them in timestamp order, the decode stage sends
+    frames to the Decoder as soon as it can take another one, and the display
+    stage prints the decoded frames in order.
+
+    When the Decoder cannot keep up, frames that would be displayed later than
+    the latency budget are skipped instead of decoded, so playback stays live.
+    Channel 0 (emergency broadcast) frames are never skipped.
+
     See https://rules.ectf.mitre.org/2025/getting_started/boot_reference
     """
 
     BLOCK_LEN = 256
 
-    def __init__(self, sat_host: str, sat_port: int, dec_port: str, dec_baud: int):
+    def __init__(
+        self,
+        sat_host: str,
+        sat_ports: Union[int, Sequence[int]],
+        dec_port: str,
+        dec_baud: Optional[int],
+        stats_interval: float = 10,
+        reorder_window: float = 0.05,
+        max_latency: float = 1.0,
+        stats_json: Optional[str] = None,
+        wire: str = FORMAT_BINARY,
+    ):
         """
         :param sat_host: TCP host for the Satellite
-        :param sat_port: TCP port for the Satellite
+        :param sat_ports: TCP port(s) for the Satellite, one per channel to watch
         :param dec_port: Serial port to the Decoder
-        :param dec_baud: Baud rate of the Decoder serial interface
+        :param dec_baud: Highest baud rate to negotiate with the Decoder, or None
+            for the fastest supported
+        :param stats_interval: Seconds between pipeline stats reports, or 0 to
+            only report when the TV stops
+        :param reorder_window: Seconds each frame is held to merge the downlinks
+            in timestamp order
+        :param max_latency: Seconds from arrival to display to stay within by
+            skipping frames, or 0 to never skip
+        :param stats_json: File to write the stats to on every report, or None
+        :param wire: Frame format to ask the Satellite for (see ectf25.utils.wire)
         """
         self.sat_host = sat_host
-        self.sat_port = sat_port
-        self.decoder = DecoderIntf(dec_port)
-        self.to_decode = Queue()
-        self.crash = threading.Event()
+        self.sat_ports = [sat_ports] if isinstance(sat_ports, int) else list(sat_ports)
+        self.decoder = AsyncDecoderIntf(dec_port, link_baudrate=dec_baud)
+        self.stats_interval = stats_interval
+        self.stats_json = stats_json
+        self.wire = wire
+        self.max_latency = max_latency
+        self.reorder = ReorderBuffer(reorder_window)
+        # Set when a frame goes into an empty reorder window
+        self.reorder_ready = asyncio.Event()
+        # (arrival time, channel, encoded frame) in timestamp order
+        self.to_decode = StageQueue("decode")
+        # (arrival time, decode task) in frame order
+        self.to_display = StageQueue("display")
+        self.frames = 0
+        self.skipped = 0
+        # Running estimate of the seconds from sending a frame to its result
+        self.decode_time: Optional[float] = None
+        # Seconds from a frame arriving to it being printed, since the last report
+        self.latencies: list[float] = []
+        self.last_report = time.perf_counter()
 
-    def downlink(self):
-        """Receive frames from the Satellite and queue them to be sent to the Decoder"""
-        logger.info(f"Connecting to satellite at {self.sat_host}:{self.sat_port}")
+    async def downlink(self, sat_port: int):
+        """Receive frames from a Satellite port and hold them in the reorder window"""
+        logger.info(f"Connecting to satellite at {self.sat_host}:{sat_port}")
 
         try:
             # Open connection to the Satellite
-            s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
-            s.connect((self.sat_host, self.sat_port))
+            reader, writer = await asyncio.open_connection(self.sat_host, sat_port)
+        except ConnectionRefusedError:
+            logger.critical(
+                f"Could not connect to Satellite at {self.sat_host}:{sat_port}"
+            )
+            return
 
+        frames = FrameReader(reader)
+        if self.wire == FORMAT_BINARY:
+            frames.request_binary(writer)
+        try:
             # Get frames forever
-            while not self.crash.is_set():
-                # Get and decode frame
-                line = b""
-                while not line.endswith(b"\n"):
-                    if (cur_byte := s.recv(1)) == b"":  # connection closed
-                        raise RuntimeError("Failed to receive from satellite")
-                    line += cur_byte
-                frame = json.loads(line)
-                channel = frame["channel"]
-                timestamp = frame["timestamp"]
-                encoded = binascii.a2b_hex(frame.pop("encoded"))
+            while True:
+                try:
+                    frame = await frames.read()
+                except asyncio.IncompleteReadError:
+                    # connection closed
+                    raise RuntimeError("Failed to receive from satellite") from None
+                arrival = time.perf_counter()
+                channel = frame.channel
+                timestamp = frame.timestamp
+                encoded = frame.encoded
                 logger.debug(f"Received encoded ({channel}, {timestamp}): {encoded}")
 
-                # Put frame in decode queue
-                self.to_decode.put_nowait(encoded)
-        except ConnectionRefusedError:
-            logger.critical(
-                f"Could not connect to Satellite at {self.sat_host}:{self.sat_port}"
-            )
-            self.crash.set()
+                # Hold frame until it can be merged in timestamp order
+                was_empty = not self.reorder
+                if self.reorder.add(HeldFrame(channel, timestamp, arrival, encoded)):
+                    if was_empty:
+                        self.reorder_ready.set()
         except Exception:
             logger.critical("Downlink crashed!")
-            self.crash.set()
             raise
+        finally:
+            writer.close()
+
+    async def merge(self):
+        """Move frames from the reorder window to the decode queue when they are due"""
+        while True:
+            due = self.reorder.next_due()
+            if due is None:
+                await self.reorder_ready.wait()
+                self.reorder_ready.clear()
+                continue
+            delay = due - time.perf_counter()
+            if delay > 0:
+                await asyncio.sleep(delay)
+            for frame in self.reorder.release(time.perf_counter()):
+                self.to_decode.put_nowait((frame.arrival, frame.channel, frame.encoded))
 
-    def decode(self):
-        """Serve frames from the queue to the Decoder, printing the decoded results"""
+    async def decode(self):
+        """Send queued frames to the Decoder, as many at a time as it accepts"""
         logger.info("Starting Decoder loop")
         try:
-            while not self.crash.is_set():
-                if not self.to_decode.empty():
-                    # Get an encoded frame from the queue
-                    encoded = self.to_decode.get_nowait()
-
-                    # Send the frame to be decoded
-                    decoded = self.decoder.decode(encoded)
-
-                    # Print the frame
-                    try:
-                        # if the frame contains printable text, pretty print it
-                        logger.info(
-                            (
-                                b"\n"
-                                + b"\n".join(
-                                    [decoded[i : i + 8] for i in range(0, 64, 8)]
-                                )
-                            ).decode("utf-8")
-                        )
-                    except UnicodeDecodeError:
-                        # if we can't decode bytes, fall back to just printing the frame
-                        logger.info(decoded)
+            await self.decoder.open()
+            depth = self.decoder.max_in_flight if self.decoder.link.windowed else 1
+            slots = asyncio.Semaphore(depth)
+            while True:
+                arrival, channel, encoded = await self.to_decode.get()
+                await slots.acquire()
+                if self.too_late(arrival, channel):
+                    self.skipped += 1
+                    slots.release()
+                    continue
+                # Tasks start in creation order, so frames reach the Decoder in
+                # the order they arrived
+                task = asyncio.create_task(self.decoder.decode(encoded))
+                task.add_done_callback(
+                    functools.partial(self._decoded, slots, time.perf_counter())
+                )
+                self.to_display.put_nowait((arrival, task))
         except Exception:
             logger.critical("Decoder crashed!")
-            self.crash.set()
             raise
 
+    def too_late(self, arrival: float, channel: int) -> bool:
+        """Whether a frame sent to the Decoder now would miss the latency budget"""
+        if not self.max_latency or channel == 0:
+            return False
+        age = time.perf_counter() - arrival
+        return age + (self.decode_time or 0) > self.max_latency
+
+    def _decoded(self, slots: asyncio.Semaphore, sent: float, task: asyncio.Task):
+        slots.release()
+        if task.cancelled() or task.exception() is not None:
+            return
+        took = time.perf_counter() - sent
+        if self.decode_time is None:
+            self.decode_time = took
+        else:
+            self.decode_time += DECODE_TIME_WEIGHT * (took - self.decode_time)
+
+    async def display(self):
+        """Print the decoded frames in the order they arrived"""
+        while True:
+            arrival, task = await self.to_display.get()
+            try:
+                decoded = await task
+            except Exception:
+                logger.critical("Decoder crashed!")
+                raise
+
+            # Print the frame
+            try:
+                # if the frame contains printable text, pretty print it
+                logger.info(
+                    (
+                        b"\n"
+                        + b"\n".join([decoded[i : i + 8] for i in range(0, 64, 8)])
+                    ).decode("utf-8")
+                )
+            except UnicodeDecodeError:
+                # if we can't decode bytes, fall back to just printing the frame
+                logger.info(decoded)
+
+            self.frames += 1
+            self.latencies.append(time.perf_counter() - arrival)
+
+    def stats(self) -> dict:
+        """Totals, plus the rate, queue depths and latency since the last report"""
+        elapsed = time.perf_counter() - self.last_report
+        queues = {"reorder": (len(self.reorder), self.reorder.peak)} | {
+            q.name: (q.qsize(), q.peak) for q in (self.to_decode, self.to_display)
+        }
+        return {
+            "frames": self.frames,
+            "skipped": self.skipped,
+            "late": self.reorder.late,
+            "duplicates": self.reorder.duplicates,
+            "fps": len(self.latencies) / elapsed if elapsed else 0.0,
+            "latency_ms": percentiles_ms(self.latencies),
+            "queues": {
+                name: {"depth": depth, "peak": peak}
+                for name, (depth, peak) in queues.items()
+            },
+        }
+
+    def report(self):
+        """Log the stats since the last report, and write them to stats_json"""
+        stats = self.stats()
+        line = (
+            f"TV: {stats['frames']} frames ({stats['fps']:.1f} fps),"
+            f" {stats['skipped']} skipped, {stats['late']} late,"
+            f" {stats['duplicates']} duplicates, queues "
+            + ", ".join(
+                f"{name} {q['depth']} (peak {q['peak']})"
+                for name, q in stats["queues"].items()
+            )
+        )
+        if latency := stats["latency_ms"]:
+            line += (
+                f", latency p50 {latency['p50']:.1f} ms p99 {latency['p99']:.1f} ms"
+                f" max {latency['max']:.1f} ms"
+            )
+        logger.info(line)
+        if self.stats_json is not None:
+            with open(self.stats_json, "w") as f:
+                json.dump(stats, f, indent=2)
+
+        self.last_report = time.perf_counter()
+        self.latencies.clear()
+        self.reorder.peak = len(self.reorder)
+        for q in (self.to_decode, self.to_display):
+            q.peak = q.qsize()
+
+    async def report_stats(self):
+        """Report the pipeline stats every stats_interval seconds"""
+        while True:
+            await asyncio.sleep(self.stats_interval)
+            self.report()
+
+    async def serve(self):
+        """Run the pipeline until a stage stops"""
+        stages = [
+            asyncio.create_task(self.downlink(port), name=f"downlink{port}")
+            for port in self.sat_ports
+        ]
+        stages += [
+            asyncio.create_task(self.merge(), name="merge"),
+            asyncio.create_task(self.decode(), name="decode"),
+            asyncio.create_task(self.display(), name="display"),
+        ]
+        if self.stats_interval > 0:
+            stages.append(asyncio.create_task(self.report_stats(), name="stats"))
+        try:
+            done, _ = await asyncio.wait(stages, return_when=asyncio.FIRST_COMPLETED)
+        finally:
+            for stage in stages:
+                stage.cancel()
+            await asyncio.gather(*stages, return_exceptions=True)
+            self.decoder.close()
+            self.report()
+        for stage in done:
+            stage.result()
+
     def run(self):
         """Run the TV, connecting to the Satellite and the Decoder"""
-
         try:
-            decode = threading.Thread(target=self.decode)
-            decode.start()
-            downlink = threading.Thread(target=self.downlink, daemon=True)
-            downlink.start()
-            while downlink.is_alive() and decode.is_alive():
-                # Main thread sleeps waiting for ctrl+c from user or threads to crash.
-                # We have to busy wait here because if we decode.join(), the main thread
-                # does not receive the KeyboardInterrupt exception. Main thread sleeps
-                # to prevent using the CPU during the spin lock. The main thread will
-                # still receive the keyboard interrupt in the sleep.
-                time.sleep(0.1)
+            asyncio.run(self.serve())
         except KeyboardInterrupt:  # expect exit from user
             pass
-        finally:
-            self.crash.set()
@@ -14,6 +14,7 @@ Copyright: Copyright (c) 2025 The MITRE Corporation
 import argparse
 
 from ectf25.tv import TV
+from ectf25.utils.wire import FORMAT_BINARY, WIRE_FORMATS
 
 
 def main():
@@ -23,18 +24,71 @@ def main():
         " the Decoder, and printing to the terminal",
     )
     parser.add_argument("sat_host", help="TCP host of the satellite")
-    parser.add_argument("sat_port", type=int, help="TCP port of the satellite")
+    parser.add_argument(
+        "sat_port",
+        type=int,
+        nargs="+",
+        help="TCP port of the satellite. Give one per channel to watch; their"
+        " frames are merged in timestamp order",
+    )
     parser.add_argument(
         "dec_port",
         help="Serial port to the Decoder (see https://rules.ectf.mitre.org/2025/getting_started/boot_reference for platform-specific instructions)",
     )
     parser.add_argument(
-        "--baud", type=int, default=115200, help="Baud rate of the serial port"
+        "--baud",
+        type=int,
+        default=None,
+        help="Highest baud rate to negotiate with the Decoder (default: fastest"
+        " supported; Decoders without negotiation stay at 115200)",
+    )
+    parser.add_argument(
+        "--stats-interval",
+        type=float,
+        default=10,
+        help="Seconds between reports of queue depths and frame latency (0: only"
+        " when the TV stops)",
+    )
+    parser.add_argument(
+        "--reorder-ms",
+        type=float,
+        default=50,
+        help="Milliseconds each frame is held to merge several satellite ports in"
+        " timestamp order; later frames are dropped",
+    )
+    parser.add_argument(
+        "--max-latency-ms",
+        type=float,
+        default=1000,
+        help="Skip frames that would be displayed later than this after arriving"
+        " (never channel 0 frames; 0: never skip)",
+    )
+    parser.add_argument(
+        "--stats-json",
+        default=None,
+        help="Also write the stats to this file on every report",
+    )
+    parser.add_argument(
+        "--wire",
+        choices=WIRE_FORMATS,
+        default=FORMAT_BINARY,
+        help="Frame format to ask the satellite for (stays JSON if it does not"
+        " support binary)",
     )
     args = parser.parse_args()
 
     # run the TV
-    tv = TV(args.sat_host, args.sat_port, args.dec_port, args.baud)
+    tv = TV(
+        args.sat_host,
+        args.sat_port,
+        args.dec_port,
+        args.baud,
+        args.stats_interval,
+        args.reorder_ms / 1000,
+        args.max_latency_ms / 1000,
+        args.stats_json,
+        args.wire,
+    )
     tv.run()
 
 
@@ -20,6 +20,7 @@ import time
 from loguru import logger
 
 from ectf25.utils import Encoder
+from ectf25.utils.wire import FrameWriter, WireFrame
 
 
 Frame = namedtuple("Frame", ["channel", "data", "timestamp"])
@@ -115,21 +116,26 @@ class Uplink:
             async with self.read_lock:
                 await self.encoded_queue.get()
 
-    async def handle_uplink(self, _, writer: asyncio.StreamWriter):
+    async def handle_uplink(
+        self, reader: asyncio.StreamReader, writer: asyncio.StreamWriter
+    ):
         """Serve the uplink to the satellite"""
         # mark uplink as up
         self.uplink_down.clear()
+        frames = FrameWriter(writer)
+        hello = asyncio.create_task(frames.serve_hello(reader))
         try:
             # serve frames from encoder to uplink until connection crashes
             while True:
                 async with self.read_lock:
                     frame = await self.encoded_queue.get()
-                writer.write(f"{frame}\n".encode())
+                frames.write(frame)
                 await writer.drain()
         except (ConnectionResetError, json.JSONDecodeError):
             # gracefully handle satellite crashing
             pass
         finally:
+            hello.cancel()
             self.uplink_down.set()
             logger.critical("Uplink unexpectedly closed!")
 
@@ -159,14 +165,9 @@ class Uplink:
                 timestamp = int(time.time_ns() / 1000)
                 frame = channel.frames[idx % ln].data.encode()
                 encoded = self.encoder.encode(channel.number, frame, timestamp)
-                packaged_frame = json.dumps(
-                    {
-                        "channel": channel.number,
-                        "timestamp": timestamp,
-                        "encoded": encoded.hex(),
-                    }
+                self.encoded_queue.put_nowait(
+                    WireFrame(channel.number, timestamp, encoded)
                 )
-                self.encoded_queue.put_nowait(packaged_frame)
                 idx += 1
         except Exception as e:
             logger.critical(f"Frame stream failed for {channel}")
@@ -10,17 +10,44 @@ own risk!
 Copyright: Copyright (c) 2025 The MITRE Corporation
 """
 
-from dataclasses import dataclass
+import asyncio
+from collections import deque
+from dataclasses import dataclass, field
 from enum import IntEnum
 import struct
-from typing import Optional, Iterator
+import time
+from typing import Iterable, Iterator, Optional, Sequence
 
 from loguru import logger
-from serial import Serial
 from serial.serialutil import SerialTimeoutException
 
+from ectf25.utils.serial_transport import SerialTransport
+
 MAGIC = b"%"
 BLOCK_LEN = 256
+# Size of a packed MessageHdr
+HDR_LEN = 4
+
+# Every Decoder starts out at this baud rate and returns to it whenever a
+# negotiated session is abandoned
+DEFAULT_BAUDRATE = 115200
+MAX_BAUDRATE = 921600
+# How long to wait for a NEGOTIATE response before assuming it is unsupported
+NEGOTIATE_TIMEOUT = 1.0
+# How long a Decoder keeps a new baud rate without hearing a valid header
+CONFIRM_TIMEOUT = 1.0
+# Pause after changing the baud rate so the Decoder can switch as well
+SWITCH_DELAY = 0.01
+
+# Optional protocol features (bit mask)
+FEATURE_BATCHED_FRAMES = 1 << 0
+FEATURE_WINDOWED_ACK = 1 << 1
+# Number of unacknowledged headers and blocks to ask for with FEATURE_WINDOWED_ACK
+DEFAULT_WINDOW = 8
+# Number of commands to keep in flight with FEATURE_WINDOWED_ACK
+DEFAULT_DEPTH = 4
+# Event loop iterations a windowed ACK waits for a command to carry it
+ACK_DELAY_ITERATIONS = 2
 
 
 class Opcode(IntEnum):
@@ -29,6 +56,7 @@ class Opcode(IntEnum):
     DECODE = 0x44  # D
     SUBSCRIBE = 0x53  # S
     LIST = 0x4C  # L
+    NEGOTIATE = 0x4E  # N
     ACK = 0x41  # A
     DEBUG = 0x47  # G
     ERROR = 0x45  # E
@@ -82,90 +110,553 @@ class Message:
         """Pack the Message into bytes"""
         return self.hdr.pack() + self.body
 
-    def packets(self) -> Iterator[bytes]:
+    def packets(self, block_len: int = BLOCK_LEN) -> Iterator[bytes]:
         """An iterator that chunks the message into blocks to send to the Decoder. An
-        ACK is expected from the Decoder after each block"""
+        ACK is expected from the Decoder after each block
+
+        :param block_len: Block size in use on the link
+        """
         yield self.hdr.pack()
-        for i in range(0, len(self.body), BLOCK_LEN):
-            yield self.body[i : i + BLOCK_LEN]
+        for i in range(0, len(self.body), block_len):
+            yield self.body[i : i + block_len]
 
     def is_ack(self) -> bool:
         """Returns whether the message is an ACK"""
         return self.opcode == Opcode.ACK
 
 
+@dataclass
+class LinkSettings:
+    """Settings of a serial session with the Decoder, agreed on with NEGOTIATE"""
+
+    baudrate: int = DEFAULT_BAUDRATE
+    block_len: int = BLOCK_LEN
+    features: int = 0
+    # Headers and blocks that may be sent before waiting for an ACK (only with
+    # FEATURE_WINDOWED_ACK)
+    window: int = 1
+
+    FORMAT = "<IHH"
+
+    @property
+    def windowed(self) -> bool:
+        """Whether ACKs are windowed and cumulative instead of stop-and-wait"""
+        return bool(self.features & FEATURE_WINDOWED_ACK)
+
+    @classmethod
+    def unpack(cls, body: bytes) -> "LinkSettings":
+        """Parse the body of a NEGOTIATE message
+
+        The window byte is only present if it was part of the request
+        """
+        if len(body) not in (8, 9):
+            raise struct.error(f"bad length {len(body)}")
+        window = body[8] if len(body) == 9 else 1
+        return cls(*struct.unpack_from(cls.FORMAT, body), window)
+
+    def pack(self) -> bytes:
+        """Pack the settings into the body of a NEGOTIATE message"""
+        body = struct.pack(self.FORMAT, self.baudrate, self.block_len, self.features)
+        if self.windowed:
+            body += bytes([self.window])
+        return body
+
+
+@dataclass
+class LinkStats:
+    """Counters of what went over the serial link"""
+
+    bytes_sent: int = 0
+    bytes_received: int = 0
+    acks_sent: int = 0
+    acks_received: int = 0
+    # Number of times the host went from sending to receiving
+    turnarounds: int = 0
+
+
 class DecoderError(Exception):
     pass
 
 
-class DecoderIntf:
-    """Standard asynchronous interface to the Decoder
+class AsyncDecoderIntf(asyncio.Protocol):
+    """asyncio interface to the Decoder
+
+    Bytes are parsed as they arrive and ACKed from the protocol callbacks, so a
+    Decoder that is busy costs no thread and no polling, and one event loop can
+    drive many Decoders. Commands may be issued concurrently: they are sent one
+    after the other and answered in order. With windowed ACKs, up to
+    `max_in_flight` commands are in flight at once, so the Decoder can read
+    command k+1 while the host waits for response k; otherwise commands go out
+    one at a time.
 
     See https://rules.ectf.mitre.org/2025/getting_started/boot_reference
     """
 
-    ACK = Message(Opcode.ACK, b"")
-
-    def __init__(self, port, **serial_kwargs):
+    def __init__(
+        self,
+        port,
+        link_baudrate: Optional[int] = None,
+        negotiate: bool = True,
+        link_features: int = FEATURE_WINDOWED_ACK,
+        link_window: int = DEFAULT_WINDOW,
+        max_in_flight: int = DEFAULT_DEPTH,
+        timeout: Optional[float] = None,
+        **serial_kwargs,
+    ):
         """
         :param port: Serial port to the Decoder
+        :param link_baudrate: Baud rate to ask the Decoder for when the port is
+            opened. Defaults to the highest rate any Decoder supports
+        :param negotiate: Whether to negotiate link settings at all. If False,
+            or if the Decoder does not support NEGOTIATE, 115200 baud,
+            256-byte blocks and stop-and-wait ACKs are used
+        :param link_features: FEATURE_* bits to ask for
+        :param link_window: ACK window to ask for with FEATURE_WINDOWED_ACK
+        :param max_in_flight: Commands to keep in flight with windowed ACKs
+        :param timeout: Seconds to wait for each command to be sent and answered,
+            or None to wait forever
         :param serial_kwargs: Args to pass to the serial interface construction
         """
-        self.ser = Serial(baudrate=115200, **serial_kwargs)
-        self.ser.port = port
-        self.stream = b""
+        self.port = port
+        self.serial_kwargs = serial_kwargs
+        self.timeout = timeout
+        self.transport: Optional[SerialTransport] = None
+        # Bytes received but not consumed yet, and how far into them no MAGIC
+        # was found
+        self.stream = bytearray()
+        self._scanned = 0
+        # Message being received: its header, the bytes still to come, and the
+        # body and number of blocks so far
+        self._hdr: Optional[MessageHdr] = None
+        self._remaining = 0
+        self._body = bytearray()
+        self._blocks = 0
+        self.link = LinkSettings()
+        self.link_baudrate = link_baudrate or MAX_BAUDRATE
+        self.link_features = link_features
+        self.link_window = link_window
+        self.auto_negotiate = negotiate
+        self.max_in_flight = max_in_flight
+        self.stats = LinkStats()
+        # Commands sent (or being sent) that wait for a response, oldest first
+        self._waiting: deque[asyncio.Future] = deque()
+        # Commands in flight, and commands waiting for one of them to finish
+        self._in_flight = 0
+        self._slot_waiters: deque[asyncio.Future] = deque()
+        self._send_lock = asyncio.Lock()
+        self._open_lock = asyncio.Lock()
+        self._ready = False
+        # ACK state: headers and blocks sent but not ACKed yet, and windowed
+        # ACKs owed to the Decoder but not sent yet
+        self.unacked = 0
+        self._acked = asyncio.Event()
+        self._sending = False
+        self._owed_acks = 0
+        self._ack_flush_scheduled = False
+        self._wrote = False
 
-    def _open(self):
-        """Open the serial connection if not already opened"""
-        if not self.ser.is_open:
-            self.ser.open()
+    async def __aenter__(self) -> "AsyncDecoderIntf":
+        await self.open()
+        return self
 
-    def decode(self, frame: bytes) -> bytes:
+    async def __aexit__(self, *exc):
+        self.close()
+
+    async def open(self):
+        """Open the serial connection if not already opened, and negotiate the
+        link settings if asked to"""
+        async with self._open_lock:
+            if self._ready:
+                return
+            if self.transport is None:
+                self.transport = SerialTransport.open(
+                    asyncio.get_running_loop(),
+                    self,
+                    self.port,
+                    DEFAULT_BAUDRATE,
+                    **self.serial_kwargs,
+                )
+            if self.auto_negotiate:
+                await self.negotiate(
+                    self.link_baudrate, self.link_features, self.link_window
+                )
+            self._ready = True
+
+    async def _ensure_open(self):
+        if not self._ready:
+            await self.open()
+
+    def close(self):
+        """Close the serial connection. Commands in flight fail with DecoderError"""
+        if self.transport is not None:
+            self.transport.close()
+
+    def connection_lost(self, exc: Optional[Exception]):
+        self.transport = None
+        self._ready = False
+        self.link = LinkSettings()
+        self._fail(DecoderError(f"Serial connection closed ({exc})"))
+
+    def data_received(self, data: bytes):
+        if self._wrote:
+            self.stats.turnarounds += 1
+        self._wrote = False
+        self.stats.bytes_received += len(data)
+        self.stream += data
+        while self._receive():
+            pass
+
+    def _write(self, data: bytes):
+        if self.transport is None:
+            raise DecoderError("Serial connection is not open")
+        self.transport.write(data)
+        self.stats.bytes_sent += len(data)
+        self._wrote = True
+
+    def _clear_stream(self):
+        self.stream.clear()
+        self._scanned = 0
+
+    def _reset_window(self):
+        self.unacked = 0
+        self._owed_acks = 0
+        self._acked.set()
+
+    def _fail(self, exc: Exception):
+        """Abandon every command in flight and anything partially received"""
+        while self._waiting:
+            fut = self._waiting.popleft()
+            if not fut.done():
+                fut.set_exception(exc)
+        self._hdr = None
+        self._clear_stream()
+        self._reset_window()
+
+    def try_parse(self) -> Optional[MessageHdr]:
+        """Try to parse the input stream into a MessageHdr
+
+        Bytes before the header are dropped. Only the bytes received since the
+        last call are searched for MAGIC, so noise on the line costs linear time
+
+        :returns: The MessageHdr if the parse was successful, None otherwise
+        """
+        while True:
+            start = self.stream.find(MAGIC, self._scanned)
+            if start < 0:
+                # Nothing here can start a header
+                self._clear_stream()
+                return None
+            if len(self.stream) - start < HDR_LEN:
+                del self.stream[:start]
+                self._scanned = 0
+                return None
+            opc, ln = struct.unpack_from("<BH", self.stream, start + len(MAGIC))
+            try:
+                hdr = MessageHdr(Opcode(opc), ln)
+            except ValueError:
+                # A stray MAGIC; look for the next one
+                self._scanned = start + 1
+                continue
+            del self.stream[: start + HDR_LEN]
+            self._scanned = 0
+            logger.debug("Found header {}", hdr)
+            return hdr
+
+    def _receive(self) -> bool:
+        """Consume one header or block from the input stream
+
+        :returns: Whether anything was consumed
+        """
+        if not self.stream:
+            return False
+        if self._hdr is None:
+            hdr = self.try_parse()
+            if hdr is None:
+                return False
+            if hdr.opcode == Opcode.ACK:
+                # ACKs have no body. With windowed ACKs, the length is the number
+                # of headers and blocks acknowledged
+                self._ack_received(hdr.len)
+                return True
+            self._hdr = hdr
+            self._remaining = hdr.len
+            self._body = bytearray()
+            self._blocks = 0
+        else:
+            n = min(self.link.block_len, self._remaining)
+            if len(self.stream) < n:
+                return False
+            block = bytes(self.stream[:n])
+            del self.stream[:n]
+            logger.debug("Read block {!r}", block)
+            self._body += block
+            self._remaining -= n
+            self._blocks += 1
+        # Don't ACK a debug message
+        acked = self._hdr.opcode not in NACK_MSGS
+        if acked and not self.link.windowed:
+            self.send_ack()
+        if self._remaining == 0:
+            if acked and self.link.windowed:
+                self._ack_message(1 + self._blocks)
+            msg = Message(self._hdr.opcode, bytes(self._body))
+            self._hdr = None
+            self._message_received(msg)
+        return True
+
+    def _message_received(self, msg: Message):
+        """Hand a complete message to the command waiting for it"""
+        logger.debug("Got message {}", msg)
+        if msg.opcode == Opcode.DEBUG:
+            logger.info(f"Got DEBUG: {repr(msg.body)}")
+            return
+        if not self._waiting:
+            logger.warning(f"Dropping unexpected message {msg}")
+            return
+        if not self.link.windowed:
+            # A stop-and-wait Decoder that answers has stopped reading the
+            # command, whether or not all of it was sent
+            self._reset_window()
+        fut = self._waiting.popleft()
+        if not fut.done():
+            fut.set_result(msg)
+
+    def _ack_received(self, count: int):
+        self.stats.acks_received += 1
+        self.unacked = max(0, self.unacked - max(count, 1))
+        self._acked.set()
+
+    def send_ack(self, count: int = 0):
+        """Send an ACK to the Decoder
+
+        :param count: With windowed ACKs, the number of headers and blocks
+            acknowledged
+        """
+        self._write(MessageHdr(Opcode.ACK, count).pack())
+        self.stats.acks_sent += 1
+
+    def _ack_message(self, count: int):
+        """ACK a received message with windowed ACKs
+
+        The ACK is held back for ACK_DELAY_ITERATIONS event loop iterations, so
+        that a command issued in response can carry it in the same write, and
+        while a message is being sent, so that it does not land in the middle
+        """
+        self._owed_acks += count
+        if not self._ack_flush_scheduled:
+            self._ack_flush_scheduled = True
+            asyncio.get_running_loop().call_soon(
+                self._flush_acks_later, ACK_DELAY_ITERATIONS
+            )
+
+    def _flush_acks_later(self, iterations: int):
+        if iterations > 0 and self._owed_acks:
+            asyncio.get_running_loop().call_soon(
+                self._flush_acks_later, iterations - 1
+            )
+            return
+        self._ack_flush_scheduled = False
+        self.flush_acks()
+
+    def flush_acks(self):
+        """Send the windowed ACKs owed to the Decoder now, unless a message is
+        being sent"""
+        if self._owed_acks and not self._sending and self.transport is not None:
+            self.send_ack(self._owed_acks)
+            self._owed_acks = 0
+
+    def _take_acks(self) -> bytes:
+        """Take the windowed ACK owed to the Decoder, to send ahead of a message"""
+        if not self._owed_acks:
+            return b""
+        ack = MessageHdr(Opcode.ACK, self._owed_acks).pack()
+        self._owed_acks = 0
+        self.stats.acks_sent += 1
+        return ack
+
+    async def _send(self, msg: Message, fut: asyncio.Future):
+        """Send a command, waiting for ACKs whenever the window is full
+
+        All the packets the window allows go out in one write. Stops early if the
+        command is answered (or abandoned) before it is completely sent
+        """
+        packets = list(msg.packets(self.link.block_len))
+        first = True
+        self._sending = True
+        try:
+            while packets:
+                while self.unacked >= self.link.window and not fut.done():
+                    self._acked.clear()
+                    await self._acked.wait()
+                if fut.done():
+                    return
+                n = self.link.window - self.unacked
+                batch, packets = packets[:n], packets[n:]
+                logger.debug("Sending packets {!r}", batch)
+                ack = self._take_acks() if first else b""
+                self._write(ack + b"".join(batch))
+                self.unacked += len(batch)
+                first = False
+        finally:
+            self._sending = False
+            self.flush_acks()
+
+    def _depth(self) -> int:
+        return self.max_in_flight if self.link.windowed else 1
+
+    def _release_slot(self):
+        """Wake the oldest command still waiting for a slot, skipping the ones
+        that were cancelled while they waited"""
+        while self._slot_waiters:
+            slot = self._slot_waiters.popleft()
+            if not slot.done():
+                slot.set_result(None)
+                return
+
+    async def _command(self, msg: Message) -> Message:
+        """Send a command and wait for its response
+
+        :raises DecoderError: If the Decoder returned ERROR
+        """
+        loop = asyncio.get_running_loop()
+        fut = None
+        try:
+            # The wait for a slot counts against the timeout too, so that a
+            # wedged window does not block the commands queued behind it forever
+            async with asyncio.timeout(self.timeout):
+                while self._in_flight >= self._depth():
+                    slot = loop.create_future()
+                    self._slot_waiters.append(slot)
+                    try:
+                        await slot
+                    except BaseException:
+                        # Woken just before being cancelled: pass the slot on
+                        if slot.done() and not slot.cancelled():
+                            self._release_slot()
+                        raise
+                self._in_flight += 1
+                try:
+                    fut = loop.create_future()
+                    async with self._send_lock:
+                        self._waiting.append(fut)
+                        try:
+                            await self._send(msg, fut)
+                        except BaseException:
+                            # No response will come for a command that did not
+                            # go out; it must not take the next command's response
+                            if fut in self._waiting:
+                                self._waiting.remove(fut)
+                            raise
+                    resp = await fut
+                finally:
+                    self._in_flight -= 1
+                    self._release_slot()
+        except TimeoutError:
+            if fut is not None:
+                # Responses can no longer be matched to the commands still in
+                # flight
+                fut.cancel()
+                self._fail(SerialTimeoutException("Read timeout"))
+            raise SerialTimeoutException("Read timeout") from None
+        if resp.opcode == Opcode.ERROR:
+            raise DecoderError(f"Decoder returned ERROR: {repr(resp.body)}")
+        return resp
+
+    async def _request_link(self, settings: LinkSettings) -> LinkSettings:
+        """Send a NEGOTIATE message and return the settings the Decoder chose"""
+        resp = await self._command(Message(Opcode.NEGOTIATE, settings.pack()))
+        if resp.opcode != Opcode.NEGOTIATE:
+            raise DecoderError(f"Bad negotiate response {resp}")
+        try:
+            return LinkSettings.unpack(resp.body)
+        except struct.error:
+            raise DecoderError(f"Bad negotiate response {resp}")
+
+    async def negotiate(
+        self, baudrate: int, features: int = 0, window: int = DEFAULT_WINDOW
+    ) -> LinkSettings:
+        """Agree with the Decoder on a baud rate and optional protocol features
+
+        The Decoder picks the highest baud rate it supports up to the requested
+        one. Both sides switch after the response; a second NEGOTIATE at the new
+        rate confirms the switch. If anything goes wrong, including a Decoder that
+        does not know NEGOTIATE, both sides return to the default settings.
+        Must not be called with other commands in flight.
+
+        :param baudrate: Highest baud rate to use
+        :param features: FEATURE_* bits to request
+        :param window: ACK window to request with FEATURE_WINDOWED_ACK
+        :returns: The settings now in use
+        """
+        if self.transport is None:
+            await self.open()
+        timeout = self.timeout
+        self.timeout = NEGOTIATE_TIMEOUT
+        try:
+            request = LinkSettings(baudrate, BLOCK_LEN, features, window)
+            settings = await self._request_link(request)
+            # The Decoder switches once this exchange is complete
+            self.link = settings
+            self._reset_window()
+            if settings.baudrate != self.transport.baudrate:
+                # The final ACK must go out at the old rate
+                await self.transport.drain()
+                self.transport.set_baudrate(settings.baudrate)
+                await asyncio.sleep(SWITCH_DELAY)
+                confirmed = await self._request_link(settings)
+                if confirmed != settings:
+                    raise DecoderError(f"Decoder changed settings to {confirmed}")
+            logger.debug(f"Negotiated {settings}")
+        except (DecoderError, SerialTimeoutException) as e:
+            logger.info(f"Link negotiation failed ({e}), using defaults")
+            self.link = LinkSettings()
+            if self.transport is not None:
+                if self.transport.baudrate != DEFAULT_BAUDRATE:
+                    # Let the Decoder give up on the new rate as well
+                    self.transport.set_baudrate(DEFAULT_BAUDRATE)
+                    await asyncio.sleep(CONFIRM_TIMEOUT + 0.1)
+                self.transport.reset_input_buffer()
+            self._hdr = None
+            self._clear_stream()
+            self._reset_window()
+        finally:
+            self.timeout = timeout
+        return self.link
+
+    async def decode(self, frame: bytes) -> bytes:
         """Decode a frame
 
         :param frame: An encoded frame to be decoded
         :returns: The decoded frame
         :raises DecoderError: Error on decode failure
         """
-        # send decode message
-        msg = Message(Opcode.DECODE, frame)
-        self.send_msg(msg)
-
-        # receive response
-        resp = self.get_msg()
+        await self._ensure_open()
+        resp = await self._command(Message(Opcode.DECODE, frame))
         if resp.opcode != Opcode.DECODE:
             raise DecoderError(f"Bad decode response {resp}")
         return resp.body
 
-    def subscribe(self, subscription: bytes):
+    async def subscribe(self, subscription: bytes):
         """Subscribe the Decoder to a new subscription
 
         :param subscription: Content of subscription file created by
             ectf25_design.gen_subscription
         :raises DecoderError: Error on subscribe failure
         """
-        # send subscribe message
-        msg = Message(Opcode.SUBSCRIBE, subscription)
-        self.send_msg(msg)
-
-        # receive response
-        resp = self.get_msg()
+        await self._ensure_open()
+        resp = await self._command(Message(Opcode.SUBSCRIBE, subscription))
         if resp != Message(Opcode.SUBSCRIBE, b""):
             raise DecoderError(f"Bad subscribe response {resp}")
 
-    def list(self) -> list[tuple[int, int, int]]:
+    async def list(self) -> list[tuple[int, int, int]]:
         """List the subscribed channels of a Decoder
 
         :returns: A list of tuples containing the subscribed channels and start and end
             timestamps
         :raises DecoderError: Error on list failure
         """
-        # send list message
-        msg = Message(Opcode.LIST, b"")
-        self.send_msg(msg)
-
-        # receive response
-        resp = self.get_msg()
+        await self._ensure_open()
+        resp = await self._command(Message(Opcode.LIST, b""))
         if resp.opcode != Opcode.LIST:
             raise DecoderError(f"Bad list response {resp}")
 
@@ -192,89 +683,419 @@ class DecoderIntf:
 
         return channels
 
-    def send_ack(self):
-        """Send an ACK to the Decoder"""
-        self._open()
-        self.ser.write(self.ACK.pack())
 
-    def get_ack(self):
-        """Get an expected ACK from the Decoder
+class DecoderIntf:
+    """Standard synchronous interface to the Decoder
+
+    A thin wrapper that runs an AsyncDecoderIntf on a private event loop, so
+    each call returns once the Decoder has answered
+
+    See https://rules.ectf.mitre.org/2025/getting_started/boot_reference
+    """
+
+    def __init__(
+        self,
+        port,
+        link_baudrate: Optional[int] = None,
+        negotiate: bool = True,
+        link_features: int = FEATURE_WINDOWED_ACK,
+        link_window: int = DEFAULT_WINDOW,
+        **serial_kwargs,
+    ):
+        """
+        :param port: Serial port to the Decoder
+        :param link_baudrate: Baud rate to ask the Decoder for when the port is
+            opened. Defaults to the highest rate any Decoder supports
+        :param negotiate: Whether to negotiate link settings at all. If False,
+            or if the Decoder does not support NEGOTIATE, 115200 baud,
+            256-byte blocks and stop-and-wait ACKs are used
+        :param link_features: FEATURE_* bits to ask for
+        :param link_window: ACK window to ask for with FEATURE_WINDOWED_ACK
+        :param serial_kwargs: Args to pass to the serial interface construction.
+            `timeout` bounds the wait for each command to be answered
+        """
+        self._loop = asyncio.new_event_loop()
+        self.aio = AsyncDecoderIntf(
+            port, link_baudrate, negotiate, link_features, link_window, **serial_kwargs
+        )
+
+    def _run(self, aw):
+        try:
+            return self._loop.run_until_complete(aw)
+        finally:
+            # Nothing sends them while the loop is stopped
+            self.aio.flush_acks()
+
+    @property
+    def link(self) -> LinkSettings:
+        return self.aio.link
+
+    @property
+    def link_baudrate(self) -> int:
+        return self.aio.link_baudrate
+
+    @property
+    def stats(self) -> LinkStats:
+        return self.aio.stats
+
+    @stats.setter
+    def stats(self, stats: LinkStats):
+        self.aio.stats = stats
 
-        :raises DecoderError: Non-ACK response was received (other than DEBUGs)
+    def close(self):
+        """Close the serial connection"""
+        self.aio.close()
+        # Let the connection_lost callback run
+        self._run(asyncio.sleep(0))
+
+    def negotiate(
+        self, baudrate: int, features: int = 0, window: int = DEFAULT_WINDOW
+    ) -> LinkSettings:
+        """See AsyncDecoderIntf.negotiate"""
+        return self._run(self.aio.negotiate(baudrate, features, window))
+
+    def decode(self, frame: bytes) -> bytes:
+        """Decode a frame
+
+        :param frame: An encoded frame to be decoded
+        :returns: The decoded frame
+        :raises DecoderError: Error on decode failure
         """
-        msg = self.get_msg()
-        if msg != self.ACK:
-            logger.error(f"Got bad ACK {msg}")
-            raise DecoderError(f"Got bad ACK {msg}")
+        return self._run(self.aio.decode(frame))
 
-    def try_parse(self) -> Optional[MessageHdr]:
-        """Try to parse the input stream into a MessageHdr
+    def decode_pipelined(
+        self, frames: Iterable[bytes], depth: int = DEFAULT_DEPTH
+    ) -> Iterator[bytes]:
+        """Decode a sequence of frames, keeping several commands in flight
 
-        :returns: The MessageHdr if the parse was successful, None otherwise
+        With windowed ACKs, up to `depth` frames are sent ahead of the responses
+        (as far as the window allows), so the Decoder can read the next frame as
+        soon as it is done with the current one. Without them, this is the same as
+        calling decode() for each frame.
+
+        :param frames: Encoded frames to decode
+        :param depth: Maximum number of frames in flight
+        :returns: An iterator over the decoded frames, in order
+        :raises DecoderError: On the first frame that fails to decode, after the
+            responses to the frames already queued have been received
         """
+        # Only this generator issues commands while it runs. One more frame than
+        # can be in flight is queued, so that it goes out (with the ACK for the
+        # response that made room for it) as soon as a response arrives
+        max_in_flight = self.aio.max_in_flight
+        self.aio.max_in_flight = depth
+        tasks: deque[asyncio.Task] = deque()
         try:
-            hdr, self.stream = MessageHdr.parse(self.stream)
-        except (ValueError, struct.error):
-            return None
-        logger.debug(f"Found header {hdr}")
-        return hdr
+            for frame in frames:
+                tasks.append(self._loop.create_task(self.aio.decode(frame)))
+                if len(tasks) > depth:
+                    yield self._run(tasks.popleft())
+            while tasks:
+                yield self._run(tasks.popleft())
+        finally:
+            if tasks:
+                self._run(asyncio.gather(*tasks, return_exceptions=True))
+            self.aio.max_in_flight = max_in_flight
 
-    def get_raw_msg(self) -> Message:
-        """Get a message, blocking until full message received
+    def subscribe(self, subscription: bytes):
+        """Subscribe the Decoder to a new subscription
 
-        :returns: Message received by Decoder
-        :raises: DecoderError if unexpected behavior encountered
+        :param subscription: Content of subscription file created by
+            ectf25_design.gen_subscription
+        :raises DecoderError: Error on subscribe failure
         """
-        self._open()
-        while (hdr := self.try_parse()) is None:
-            b = self.ser.read(1)
-            if b == b'':
-                raise SerialTimeoutException('Read timeout')
-            self.stream += b
-        # Don't ACK an ACK or a debug message
-        if hdr.opcode not in NACK_MSGS:
-            self.send_ack()
-        remaining = hdr.len
-        body = b""
-        while remaining > 0:
-            block = b""
-            while block_remaining := min(BLOCK_LEN, remaining) - len(block):
-                b = self.ser.read(block_remaining)
-                if b == b'':
-                    raise SerialTimeoutException('Read timeout')
-                block += b
-            # Don't ACK an ACK or a debug message
-            if hdr.opcode not in NACK_MSGS:
-                self.send_ack()
-            logger.debug(f"Read block {repr(block)}")
-            body += block
-            remaining -= len(block)
-        msg = Message(hdr.opcode, body)
-        logger.debug(f"Got message {msg}")
-        return msg
-
-    def get_msg(self) -> Message:
-        """Get a message, handling DEBUG and ERROR messages
-
-        :returns: Message received by Decoder, filtering DEBUGs
-        :raises DecoderError: If unexpected behavior or ERROR message encountered
+        self._run(self.aio.subscribe(subscription))
+
+    def list(self) -> list[tuple[int, int, int]]:
+        """List the subscribed channels of a Decoder
+
+        :returns: A list of tuples containing the subscribed channels and start and end
+            timestamps
+        :raises DecoderError: Error on list failure
+        """
+        return self._run(self.aio.list())
+
+
+# How a DecoderPool picks the Decoder for a frame: in turn, or always the same
+# one for a given channel
+DISPATCH_ROUND_ROBIN = "round-robin"
+DISPATCH_CHANNEL = "channel"
+DISPATCH_POLICIES = (DISPATCH_ROUND_ROBIN, DISPATCH_CHANNEL)
+
+
+@dataclass
+class PoolResult:
+    """Outcome of a frame decoded by a DecoderPool"""
+
+    channel: int
+    # Index (into the pool's ports) of the Decoder that got the frame
+    device: int
+    decoded: Optional[bytes]
+    error: Optional[Exception]
+    # Seconds from submission to the response, and from when the Decoder's
+    # worker took the frame off its queue to the response
+    latency: float
+    decode_time: float
+    # time.perf_counter() of the response
+    completed: float
+
+
+def percentiles_ms(values: list[float]) -> dict:
+    """p50, p95, p99 and max of durations in seconds, in milliseconds"""
+    if not values:
+        return {}
+    values = sorted(values)
+
+    def at(p: float) -> float:
+        return 1000 * values[min(len(values) - 1, int(p * len(values)))]
+
+    return {"p50": at(0.5), "p95": at(0.95), "p99": at(0.99), "max": 1000 * values[-1]}
+
+
+@dataclass
+class PoolStats:
+    """Throughput and latency of the frames decoded by a DecoderPool, or by one of
+    its Decoders"""
+
+    frames: int = 0
+    errors: int = 0
+    bytes_decoded: int = 0
+    latencies: list[float] = field(default_factory=list)
+    decode_times: list[float] = field(default_factory=list)
+    # First submission and last response (time.perf_counter())
+    start: Optional[float] = None
+    end: Optional[float] = None
+
+    def add(self, result: PoolResult):
+        self.frames += 1
+        if result.error is not None:
+            self.errors += 1
+        else:
+            self.bytes_decoded += len(result.decoded)
+        self.latencies.append(result.latency)
+        self.decode_times.append(result.decode_time)
+        submitted = result.completed - result.latency
+        self.start = submitted if self.start is None else min(self.start, submitted)
+        self.end = result.completed if self.end is None else max(self.end, result.completed)
+
+    @property
+    def elapsed(self) -> float:
+        return 0.0 if self.start is None else self.end - self.start
+
+    def summary(self) -> dict:
+        """Counts, rates, and latency percentiles in milliseconds"""
+        elapsed = self.elapsed
+        return {
+            "frames": self.frames,
+            "errors": self.errors,
+            "seconds": elapsed,
+            "frames_per_second": self.frames / elapsed if elapsed else 0.0,
+            "bytes_per_second": self.bytes_decoded / elapsed if elapsed else 0.0,
+            "latency_ms": percentiles_ms(self.latencies),
+            "decode_ms": percentiles_ms(self.decode_times),
+        }
+
+
+class DecoderPool:
+    """Drive several Decoders at once from one thread
+
+    Each Decoder has a work queue, served on a private event loop by as many
+    workers as it can have commands in flight, so every Decoder keeps decoding
+    while the caller waits for any one frame. Frames are dispatched round-robin,
+    or by channel so that all frames of a channel go to the same Decoder. Either
+    way, each Decoder gets its frames in the order they were submitted.
+    """
+
+    def __init__(
+        self,
+        ports: Sequence[str],
+        dispatch: str = DISPATCH_ROUND_ROBIN,
+        depth: int = DEFAULT_DEPTH,
+        queue_size: int = 0,
+        **intf_kwargs,
+    ):
+        """
+        :param ports: Serial ports to the Decoders
+        :param dispatch: DISPATCH_ROUND_ROBIN or DISPATCH_CHANNEL
+        :param depth: Commands to keep in flight per Decoder with windowed ACKs.
+            1 makes decode_time the time the Decoder took for the frame
+        :param queue_size: Frames each work queue holds before submitting blocks,
+            or 0 for no limit
+        :param intf_kwargs: Args for each AsyncDecoderIntf
         """
+        if not ports:
+            raise ValueError("A DecoderPool needs at least one port")
+        if dispatch not in DISPATCH_POLICIES:
+            raise ValueError(f"Unknown dispatch policy {dispatch}")
+        self.ports = list(ports)
+        self.dispatch = dispatch
+        self.depth = depth
+        self._loop = asyncio.new_event_loop()
+        self.decoders = [
+            AsyncDecoderIntf(port, max_in_flight=depth, **intf_kwargs)
+            for port in self.ports
+        ]
+        self._queues = [asyncio.Queue(queue_size) for _ in self.ports]
+        self._starting: Optional[asyncio.Task] = None
+        self._workers: list[asyncio.Task] = []
+        self._next = 0
+        self._channel_devices: dict[int, int] = {}
+        self.stats = PoolStats()
+        self.device_stats = [PoolStats() for _ in self.ports]
+
+    def _run(self, aw):
+        try:
+            return self._loop.run_until_complete(aw)
+        finally:
+            # Nothing sends them while the loop is stopped
+            for decoder in self.decoders:
+                decoder.flush_acks()
+
+    def _pick(self, channel: int) -> int:
+        if self.dispatch == DISPATCH_CHANNEL:
+            if channel not in self._channel_devices:
+                # Spread channels over the Decoders in order of appearance
+                self._channel_devices[channel] = len(self._channel_devices) % len(
+                    self.decoders
+                )
+            return self._channel_devices[channel]
+        device = self._next
+        self._next = (device + 1) % len(self.decoders)
+        return device
+
+    async def _start(self):
+        """Open (and negotiate with) every Decoder, then start its workers"""
+        await asyncio.gather(*(decoder.open() for decoder in self.decoders))
+        for device, decoder in enumerate(self.decoders):
+            workers = self.depth if decoder.link.windowed else 1
+            for _ in range(workers):
+                self._workers.append(self._loop.create_task(self._work(device)))
+
+    async def _work(self, device: int):
+        decoder = self.decoders[device]
+        queue = self._queues[device]
         while True:
-            msg = self.get_raw_msg()
-            if msg.opcode == Opcode.ERROR:
-                raise DecoderError(f"Decoder returned ERROR: {repr(msg.body)}")
-            if msg.opcode != Opcode.DEBUG:
-                return msg
-            logger.info(f"Got DEBUG: {repr(msg.body)}")
+            channel, frame, submitted, fut = await queue.get()
+            start = time.perf_counter()
+            decoded, error = None, None
+            try:
+                decoded = await decoder.decode(frame)
+            except asyncio.CancelledError:
+                fut.cancel()
+                raise
+            except Exception as e:
+                # Anything else (a closed port, a bad response) fails this frame
+                # only; the worker keeps serving the queue
+                error = e
+            end = time.perf_counter()
+            result = PoolResult(
+                channel, device, decoded, error, end - submitted, end - start, end
+            )
+            self.stats.add(result)
+            self.device_stats[device].add(result)
+            if not fut.done():
+                fut.set_result(result)
+
+    async def submit(self, channel: int, frame: bytes) -> PoolResult:
+        """Queue a frame for the next Decoder and wait for the result
+
+        Must run on the pool's event loop; the blocking methods below do that
+        """
+        device = self._pick(channel)
+        submitted = time.perf_counter()
+        if self._starting is None:
+            self._starting = self._loop.create_task(self._start())
+        await self._starting
+        fut = self._loop.create_future()
+        await self._queues[device].put((channel, frame, submitted, fut))
+        return await fut
+
+    def decode(self, frame: bytes, channel: int = 0) -> bytes:
+        """Decode a frame on the next Decoder
+
+        :raises DecoderError: Error on decode failure
+        """
+        result = self._run(self.submit(channel, frame))
+        if result.error is not None:
+            raise result.error
+        return result.decoded
+
+    def decode_stream(
+        self, frames: Iterable[tuple[int, bytes]], ahead: Optional[int] = None
+    ) -> Iterator[PoolResult]:
+        """Decode (channel, frame) pairs on all Decoders at once
+
+        :param frames: Channels and encoded frames, in timestamp order
+        :param ahead: Frames to submit ahead of the one whose result is awaited.
+            Defaults to enough to keep every Decoder busy
+        :returns: An iterator over the PoolResults, in submission order. Failed
+            frames have their error set instead of raising it
+        """
+        if ahead is None:
+            ahead = len(self.decoders) * (self.depth + 1)
+        tasks: deque[asyncio.Task] = deque()
+        try:
+            for channel, frame in frames:
+                tasks.append(self._loop.create_task(self.submit(channel, frame)))
+                if len(tasks) > ahead:
+                    yield self._run(tasks.popleft())
+            while tasks:
+                yield self._run(tasks.popleft())
+        finally:
+            if tasks:
+                self._run(asyncio.gather(*tasks, return_exceptions=True))
 
-    def send_msg(self, msg: Message):
-        """Send a message to the Decoder
+    def subscribe(self, device: int, subscription: bytes):
+        """Subscribe one of the Decoders
 
-        :param msg: Message to send
-        :raises DecoderError: If unexpected behavior or ERROR message encountered
+        :param device: Index of the Decoder in the pool's ports
+        :param subscription: Subscription generated for that Decoder's ID
+        :raises DecoderError: Error on subscribe failure
         """
-        self._open()
-        for packet in msg.packets():
-            logger.debug(f"Sending packet {packet}")
-            self.ser.write(packet)
-            self.get_ack()
+        self._run(self.decoders[device].subscribe(subscription))
+
+    def list(self, device: int) -> list[tuple[int, int, int]]:
+        """List the subscribed channels of one of the Decoders"""
+        return self._run(self.decoders[device].list())
+
+    def summary(self) -> dict:
+        """PoolStats.summary() of the whole pool and of each Decoder"""
+        return {
+            "total": self.stats.summary(),
+            "devices": {
+                port: stats.summary()
+                for port, stats in zip(self.ports, self.device_stats)
+            },
+        }
+
+    def log_summary(self):
+        """Log the throughput and latency of the pool and of each Decoder"""
+        for name, stats in [("all", self.stats), *zip(self.ports, self.device_stats)]:
+            s = stats.summary()
+            line = (
+                f"{name}: {s['frames']} frames ({s['errors']} errors),"
+                f" {s['frames_per_second']:.1f} frames/s,"
+                f" {s['bytes_per_second'] / 1000:.2f} KBps"
+            )
+            for label, key in (("latency", "latency_ms"), ("decode", "decode_ms")):
+                if ms := s[key]:
+                    line += (
+                        f", {label} p50 {ms['p50']:.1f} ms p99 {ms['p99']:.1f} ms"
+                        f" max {ms['max']:.1f} ms"
+                    )
+            logger.info(line)
+
+    def close(self):
+        """Stop the workers and close every Decoder. Frames not decoded yet are
+        cancelled"""
+        for worker in self._workers:
+            worker.cancel()
+        if self._workers:
+            self._run(asyncio.gather(*self._workers, return_exceptions=True))
+        self._workers.clear()
+        for queue in self._queues:
+            while not queue.empty():
+                queue.get_nowait()[-1].cancel()
+        for decoder in self.decoders:
+            decoder.close()
+        self._run(asyncio.sleep(0))
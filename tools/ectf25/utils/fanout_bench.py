@@ -0,0 +1,254 @@
+"""
+Measure how Satellite downlink fan-out scales with worker processes
+
+Runs the real Satellite (python -m ectf25.satellite --workers N) behind the
+wire_bench stand-in Uplink and connects a number of stand-in TVs, spread evenly
+over the channels and over several client processes so the TVs are not the
+bottleneck. For every worker count and number of TVs it reports frames per
+second delivered to the TVs, the Satellite's CPU time (all of its processes)
+per frame delivered, and how the kernel spread the TVs over the workers:
+
+    python3 -m ectf25.utils.fanout_bench --workers 1 2 4 --clients 256 1024 4096
+
+Scaling needs at least as many free cores as workers plus client processes.
+"""
+
+import argparse
+import json
+import multiprocessing
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+import psutil
+from loguru import logger
+
+from ectf25.utils.wire import FORMAT_BINARY, WIRE_FORMATS
+from ectf25.utils.wire_bench import per_tv, tvs, uplink
+
+# Seconds between the Satellite's stats reports, read to count its downlinks
+SAT_STATS_INTERVAL = 0.2
+
+
+def stats_files(path: str, workers: int) -> list[str]:
+    """Stats files the Satellite writes with --stats-json path"""
+    if workers == 1:
+        return [path]
+    root, ext = os.path.splitext(path)
+    return [f"{root}.worker{i}{ext}" for i in range(workers)]
+
+
+def read_stats(path: str, workers: int) -> list[dict]:
+    """Latest stats report of each worker ({} if there is none yet)"""
+    reports = []
+    for name in stats_files(path, workers):
+        try:
+            with open(name) as f:
+                reports.append(json.load(f))
+        except (OSError, json.JSONDecodeError):
+            # Not written yet, or caught halfway through a write
+            reports.append({})
+    return reports
+
+
+def downlinks_per_worker(path: str, workers: int) -> list[int]:
+    """TVs connected to each worker in its latest stats report"""
+    return [
+        sum(len(d) for d in stats.get("downlinks", {}).values())
+        for stats in read_stats(path, workers)
+    ]
+
+
+def satellite_cpu(proc: psutil.Process) -> float:
+    """CPU seconds of the Satellite and its workers"""
+    total = 0.0
+    for p in [proc, *proc.children(recursive=True)]:
+        try:
+            times = p.cpu_times()
+        except psutil.NoSuchProcess:
+            continue
+        total += times.user + times.system
+    return total
+
+
+def run(args, workers: int, clients: int) -> dict:
+    """Fan the frames out to `clients` TVs from a fresh Satellite"""
+    sat_stats = os.path.join(tempfile.mkdtemp(), "satellite.json")
+    expected = per_tv(args)
+    # TV i watches channel i % channels
+    downlinks = [
+        (args.base_port + i % args.channels, expected[i % args.channels])
+        for i in range(clients)
+    ]
+    n = sum(frames for _, frames in downlinks)
+
+    up_conn, up_child = multiprocessing.Pipe()
+    start = multiprocessing.Event()
+    up = multiprocessing.Process(
+        target=uplink, args=(args, args.wire, up_child, start), daemon=True
+    )
+    up.start()
+    up_port = up_conn.recv()
+
+    satellite = psutil.Popen(
+        [
+            sys.executable,
+            "-m",
+            "ectf25.satellite",
+            "localhost",
+            str(up_port),
+            "localhost",
+            *(f"{1 + i}:{args.base_port + i}" for i in range(args.channels)),
+            "--wire",
+            args.wire,
+            "--workers",
+            str(workers),
+            # Measure fan-out, not the slow-TV policy: never drop a frame
+            "--queue-size",
+            str(max(expected)),
+            "--stats-interval",
+            str(SAT_STATS_INTERVAL),
+            "--stats-json",
+            sat_stats,
+        ],
+        stdout=subprocess.DEVNULL,
+        stderr=subprocess.DEVNULL,
+    )
+
+    groups = []
+    for p in range(args.client_procs):
+        conn, child = multiprocessing.Pipe()
+        ready = multiprocessing.Event()
+        group = downlinks[p :: args.client_procs]
+        proc = multiprocessing.Process(
+            target=tvs,
+            args=(args, args.wire, group, child, ready, start),
+            daemon=True,
+        )
+        proc.start()
+        groups.append((proc, conn, ready))
+    try:
+        for _, _, ready in groups:
+            if not ready.wait(120):
+                raise RuntimeError("TVs could not connect to the Satellite")
+        # Start only once every worker has subscribed all of its TVs
+        deadline = time.monotonic() + 30
+        while sum(spread := downlinks_per_worker(sat_stats, workers)) < clients:
+            if time.monotonic() > deadline:
+                raise RuntimeError(f"Satellite only subscribed {sum(spread)} TVs")
+            time.sleep(SAT_STATS_INTERVAL)
+
+        cpu = satellite_cpu(satellite)
+        start.set()
+        up_conn.recv()
+        results = [conn.recv() for _, conn, _ in groups]
+        cpu = satellite_cpu(satellite) - cpu
+        # The TVs hung up after their last frame; wait for reports with every
+        # downlink gone
+        time.sleep(2 * SAT_STATS_INTERVAL)
+        writes = sum(stats["writes"] for stats in read_stats(sat_stats, workers))
+    finally:
+        for child in satellite.children(recursive=True):
+            child.terminate()
+        satellite.terminate()
+        satellite.wait()
+        up.terminate()
+        up.join()
+        for proc, _, _ in groups:
+            proc.terminate()
+            proc.join()
+
+    elapsed = max(wall for _, wall, _ in results)
+    return {
+        "workers": workers,
+        "clients": clients,
+        "channels": args.channels,
+        "wire": args.wire,
+        "frames": n,
+        "frames_per_second": n / elapsed,
+        "satellite_cpu_us_per_frame": 1e6 * cpu / n,
+        "writes_per_frame": writes / n,
+        "clients_per_worker": spread,
+    }
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(prog="ectf25.utils.fanout_bench")
+    parser.add_argument(
+        "--workers",
+        "-w",
+        type=int,
+        nargs="+",
+        default=[1, 2, 4],
+        help="Satellite worker counts to measure",
+    )
+    parser.add_argument(
+        "--clients",
+        "-c",
+        type=int,
+        nargs="+",
+        default=[256, 1024],
+        help="Numbers of connected TVs to measure",
+    )
+    parser.add_argument("--channels", type=int, default=8, help="Channels")
+    parser.add_argument(
+        "--frames-per-channel", "-n", type=int, default=100, help="Frames per channel"
+    )
+    parser.add_argument(
+        "--frame-size",
+        "-f",
+        type=int,
+        default=208,
+        help="Size (in bytes) of an encoded frame (default: a design3 frame)",
+    )
+    parser.add_argument(
+        "--broadcast-every",
+        type=int,
+        default=0,
+        help="Send every Nth frame on channel 0, to every TV (0: never)",
+    )
+    parser.add_argument(
+        "--client-procs",
+        type=int,
+        default=max(1, (os.cpu_count() or 1) // 2),
+        help="Processes the TVs are spread over",
+    )
+    parser.add_argument(
+        "--base-port",
+        type=int,
+        default=23000,
+        help="Satellite downlink port of the first channel",
+    )
+    parser.add_argument(
+        "--wire", choices=WIRE_FORMATS, default=FORMAT_BINARY, help="Wire format"
+    )
+    parser.add_argument("--json", default=None, help="Also write the results here")
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+
+    results = []
+    for clients in args.clients:
+        for workers in args.workers:
+            result = run(args, workers, clients)
+            results.append(result)
+            print(json.dumps(result), flush=True)
+            logger.info(
+                f"{clients:5} TVs, {workers:2} workers:"
+                f" {result['frames_per_second']:9.1f} frames/s,"
+                f" satellite CPU {result['satellite_cpu_us_per_frame']:6.1f} us/frame,"
+                f" {result['writes_per_frame']:5.3f} writes/frame,"
+                f" TVs per worker {result['clients_per_worker']}"
+            )
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(results, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,136 @@
+"""
+Measure the effect of the UART link settings on decode throughput
+
+Runs the same stream of frames through a Decoder with stop-and-wait ACKs, with
+windowed ACKs, and with windowed ACKs plus several frames in flight, and reports
+frames per second, how often the host stopped sending to wait for the Decoder,
+and the ACK and byte overhead per frame.
+
+Channel 0 frames work on any Decoder, so no subscription is needed. To measure
+the link protocol rather than the Decoder's constant-time padding, the design3
+fleet simulator can be used:
+
+    decoder_fleet --manifest fleet.txt --pty-dir /tmp/dec --count 1 --no-timing
+    python3 -m ectf25.utils.link_bench --secrets global.secrets --port /tmp/dec/<id>
+"""
+
+import argparse
+import json
+import random
+import time
+
+from loguru import logger
+
+from ectf25.utils import Encoder
+from ectf25.utils.decoder import (
+    DEFAULT_BAUDRATE,
+    FEATURE_WINDOWED_ACK,
+    DecoderIntf,
+    LinkStats,
+)
+
+
+def run(
+    args,
+    decoder: DecoderIntf,
+    frames: list[tuple[bytes, bytes]],
+    windowed: bool,
+    depth: int,
+) -> dict:
+    """Decode all frames with the given link settings and return the measurements"""
+    features = FEATURE_WINDOWED_ACK if windowed else 0
+    link = decoder.negotiate(decoder.link_baudrate, features, args.window)
+    if link.windowed != windowed:
+        logger.warning(f"Decoder did not grant the requested features: {link}")
+    decoder.stats = LinkStats()
+
+    start = time.perf_counter()
+    decoded = decoder.decode_pipelined((enc for _, enc in frames), depth)
+    for (raw, _), out in zip(frames, decoded):
+        if out != raw:
+            logger.error(f"Decoded {repr(out)} != {repr(raw)}")
+    elapsed = time.perf_counter() - start
+
+    n = len(frames)
+    return {
+        "baudrate": link.baudrate,
+        "block_len": link.block_len,
+        "window": link.window if link.windowed else 0,
+        "depth": depth if link.windowed else 1,
+        "frames_per_second": n / elapsed,
+        "mean_latency_ms": 1000 * elapsed / n,
+        "turnarounds_per_frame": decoder.stats.turnarounds / n,
+        "acks_per_frame": (decoder.stats.acks_sent + decoder.stats.acks_received) / n,
+        "bytes_per_frame": (decoder.stats.bytes_sent + decoder.stats.bytes_received) / n,
+    }
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(prog="ectf25.utils.link_bench")
+    parser.add_argument(
+        "--secrets",
+        "-s",
+        type=argparse.FileType("rb"),
+        required=True,
+        help="Path to the secrets file",
+    )
+    parser.add_argument("--port", "-p", required=True, help="Serial port to the Decoder")
+    parser.add_argument(
+        "--baud", type=int, default=None, help="Baud rate to negotiate (default: max)"
+    )
+    parser.add_argument(
+        "--frames", "-n", type=int, default=500, help="Number of frames per mode"
+    )
+    parser.add_argument(
+        "--frame-size", "-f", type=int, default=64, help="Size (in bytes) of frame"
+    )
+    parser.add_argument("--window", type=int, default=8, help="ACK window to request")
+    parser.add_argument(
+        "--depth", type=int, default=4, help="Frames in flight for the pipelined mode"
+    )
+    parser.add_argument("--json", default=None, help="Also write the results here")
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+    encoder = Encoder(args.secrets.read())
+
+    # timestamps must increase across all modes
+    base = time.time_ns() // 1000
+    frames = []
+    for i in range(3 * args.frames):
+        raw = random.randbytes(args.frame_size)
+        frames.append((raw, encoder.encode(0, raw, base + i)))
+
+    # the connection is kept across modes: a Decoder keeps its link settings until
+    # they are renegotiated or it is reset
+    decoder = DecoderIntf(args.port, link_baudrate=args.baud, negotiate=False, timeout=5)
+    results = {}
+    modes = [("stop-and-wait", False, 1), ("windowed", True, 1)]
+    modes.append(("pipelined", True, args.depth))
+    try:
+        for i, (name, windowed, depth) in enumerate(modes):
+            chunk = frames[i * args.frames : (i + 1) * args.frames]
+            result = run(args, decoder, chunk, windowed, depth)
+            results[name] = result
+            logger.info(
+                f"{name:>13}: {result['frames_per_second']:8.1f} frames/s,"
+                f" {result['mean_latency_ms']:6.2f} ms/frame,"
+                f" {result['turnarounds_per_frame']:.2f} turnarounds/frame,"
+                f" {result['acks_per_frame']:.2f} ACKs/frame,"
+                f" {result['bytes_per_frame']:.1f} B/frame"
+                f" ({result['baudrate']} baud, window {result['window']},"
+                f" depth {result['depth']})"
+            )
+    finally:
+        # leave the Decoder usable by hosts that do not negotiate
+        decoder.negotiate(DEFAULT_BAUDRATE)
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(results, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
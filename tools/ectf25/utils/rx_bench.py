@@ -0,0 +1,259 @@
+"""
+Measure the host side cost of receiving Decoder responses
+
+Runs DecoderIntf.decode() against a stand-in Decoder on a pseudo-terminal and
+reports achievable frames per second and the host CPU time spent per frame. The
+stand-in echoes each frame back with the regular stop-and-wait protocol and
+runs in its own process, so only the host's work is counted. It can add
+unframed noise (like stray printf output) and DEBUG messages before each
+response, which is where a byte-at-a-time receive path falls behind.
+
+Each configuration is run with DecoderIntf ("buffered") and with the blocking
+receive path it had before the stream was buffered ("legacy": one read(1) per
+byte while looking for a header, and a MessageHdr.parse of the whole pending
+stream after each byte):
+
+    python3 -m ectf25.utils.rx_bench --frames 2000 --noise 0 256 --debug 64
+"""
+
+import argparse
+import json
+import multiprocessing
+import os
+import random
+import struct
+import sys
+import time
+
+from loguru import logger
+from serial import Serial
+from serial.serialutil import SerialTimeoutException
+
+from ectf25.utils.decoder import (
+    BLOCK_LEN,
+    DEFAULT_BAUDRATE,
+    MAGIC,
+    NACK_MSGS,
+    DecoderError,
+    DecoderIntf,
+    LinkStats,
+    Message,
+    MessageHdr,
+    Opcode,
+)
+
+
+class LegacyDecoderIntf:
+    """The blocking DecoderIntf as it was before the stream was buffered, cut
+    down to stop-and-wait decode()"""
+
+    def __init__(self, port, negotiate: bool = False, timeout=None):
+        """
+        :param negotiate: Ignored; only the default link settings are supported
+        """
+        self.ser = Serial(port, baudrate=DEFAULT_BAUDRATE, timeout=timeout)
+        self.stream = b""
+        self.stats = LinkStats()
+
+    def close(self):
+        self.ser.close()
+
+    def _read(self, n: int) -> bytes:
+        b = self.ser.read(n)
+        if b == b"":
+            raise SerialTimeoutException("Read timeout")
+        self.stats.bytes_received += len(b)
+        return b
+
+    def send_ack(self):
+        self.ser.write(MessageHdr(Opcode.ACK, 0).pack())
+
+    def decode(self, frame: bytes) -> bytes:
+        for packet in Message(Opcode.DECODE, frame).packets():
+            self.ser.write(packet)
+            if not self.get_msg().is_ack():
+                raise DecoderError("Got bad ACK")
+        resp = self.get_msg()
+        if resp.opcode != Opcode.DECODE:
+            raise DecoderError(f"Bad decode response {resp}")
+        return resp.body
+
+    def get_msg(self) -> Message:
+        while (msg := self.get_raw_msg()).opcode == Opcode.DEBUG:
+            logger.info(f"Got DEBUG: {repr(msg.body)}")
+        if msg.opcode == Opcode.ERROR:
+            raise DecoderError(f"Decoder returned ERROR: {repr(msg.body)}")
+        return msg
+
+    def try_parse(self):
+        try:
+            hdr, self.stream = MessageHdr.parse(self.stream)
+        except (ValueError, struct.error):
+            return None
+        logger.debug(f"Found header {hdr}")
+        return hdr
+
+    def get_raw_msg(self) -> Message:
+        while (hdr := self.try_parse()) is None:
+            self.stream += self._read(1)
+        acked = hdr.opcode not in NACK_MSGS
+        if acked:
+            self.send_ack()
+        remaining = hdr.len
+        body = b""
+        while remaining > 0:
+            block = b""
+            while block_remaining := min(BLOCK_LEN, remaining) - len(block):
+                block += self._read(block_remaining)
+            if acked:
+                self.send_ack()
+            logger.debug(f"Read block {repr(block)}")
+            body += block
+            remaining -= len(block)
+        msg = Message(hdr.opcode, body)
+        logger.debug(f"Got message {msg}")
+        return msg
+
+
+RX_MODES = {"legacy": LegacyDecoderIntf, "buffered": DecoderIntf}
+
+
+def stand_in(fd: int, noise: int, debug: int):
+    """Echo every message back like a Decoder with stop-and-wait ACKs
+
+    :param fd: Master side of the pty
+    :param noise: Bytes of unframed output to send before each response
+    :param debug: Body length of a DEBUG message to send before each response
+    """
+    buf = bytearray()
+    ack = MessageHdr(Opcode.ACK, 0).pack()
+    # No MAGIC in the noise, so it can never be mistaken for a header
+    noise_bytes = (b"stray output\n" * (noise // 13 + 1))[:noise]
+    debug_msg = Message(Opcode.DEBUG, b"d" * debug).pack() if debug else b""
+
+    def take(n: int) -> bytes:
+        while len(buf) < n:
+            buf.extend(os.read(fd, 65536))
+        data = bytes(buf[:n])
+        del buf[:n]
+        return data
+
+    def read_hdr() -> tuple[int, int]:
+        while take(1) != MAGIC:
+            pass
+        return struct.unpack("<BH", take(3))
+
+    while True:
+        opc, ln = read_hdr()
+        os.write(fd, ack)
+        body = b""
+        while len(body) < ln:
+            body += take(min(BLOCK_LEN, ln - len(body)))
+            os.write(fd, ack)
+        os.write(fd, noise_bytes + debug_msg)
+        for packet in Message(Opcode(opc), body).packets():
+            os.write(fd, packet)
+            read_hdr()  # ACK
+
+
+def run(args, rx: str, noise: int, debug: int) -> dict:
+    """Decode args.frames frames through a fresh stand-in and return the measurements"""
+    master, slave = os.openpty()
+    proc = multiprocessing.Process(
+        target=stand_in, args=(master, noise, debug), daemon=True
+    )
+    proc.start()
+    decoder = RX_MODES[rx](os.ttyname(slave), negotiate=False, timeout=5)
+    frames = [random.randbytes(args.frame_size) for _ in range(args.frames)]
+    try:
+        for frame in frames[: args.frames // 10]:
+            decoder.decode(frame)
+
+        cpu_start = time.process_time()
+        start = time.perf_counter()
+        for frame in frames:
+            if decoder.decode(frame) != frame:
+                raise RuntimeError("stand-in returned a different frame")
+        elapsed = time.perf_counter() - start
+        cpu = time.process_time() - cpu_start
+    finally:
+        decoder.close()
+        proc.terminate()
+        proc.join()
+        os.close(master)
+        os.close(slave)
+
+    n = len(frames)
+    return {
+        "rx": rx,
+        "noise": noise,
+        "debug": debug,
+        "frame_size": args.frame_size,
+        "frames": n,
+        "frames_per_second": n / elapsed,
+        "host_cpu_us_per_frame": 1e6 * cpu / n,
+        "bytes_received_per_frame": decoder.stats.bytes_received / n,
+    }
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(prog="ectf25.utils.rx_bench")
+    parser.add_argument(
+        "--frames", "-n", type=int, default=2000, help="Number of frames per run"
+    )
+    parser.add_argument(
+        "--frame-size",
+        "-f",
+        type=int,
+        default=132,
+        help="Size (in bytes) of an encoded frame (default: a design2 frame)",
+    )
+    parser.add_argument(
+        "--noise",
+        type=int,
+        nargs="+",
+        default=[0, 256],
+        help="Bytes of unframed output before each response (one run per value)",
+    )
+    parser.add_argument(
+        "--debug",
+        type=int,
+        default=0,
+        help="Body length of a DEBUG message before each response",
+    )
+    parser.add_argument(
+        "--rx",
+        choices=list(RX_MODES),
+        nargs="+",
+        default=list(RX_MODES),
+        help="Receive paths to measure",
+    )
+    parser.add_argument("--json", default=None, help="Also write the results here")
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+    # DEBUG logging would measure the log sink rather than the receive path
+    logger.remove()
+    logger.add(sys.stderr, level="INFO")
+
+    results = []
+    for noise in args.noise:
+        for rx in args.rx:
+            result = run(args, rx, noise, args.debug)
+            results.append(result)
+            print(json.dumps(result), flush=True)
+            logger.info(
+                f"{rx:>8} noise {noise:5} debug {args.debug:4}:"
+                f" {result['frames_per_second']:8.1f} frames/s,"
+                f" {result['host_cpu_us_per_frame']:8.1f} us host CPU/frame"
+            )
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(results, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,227 @@
+"""
+Checks of the Satellite's slow-TV policies
+
+Runs a Satellite in this process between a stand-in Uplink, which sends frames
+as fast as the Satellite takes them, and a stand-in TV, and checks how the TV is
+served. Prints PASS or FAIL for each check and exits with 1 if any failed:
+
+    python3 -m ectf25.utils.satellite_test
+"""
+
+import argparse
+import asyncio
+import random
+import socket
+import sys
+from typing import Optional
+
+from loguru import logger
+
+from ectf25.satellite import DISCONNECT, DROP_OLDEST, Channel, Satellite
+from ectf25.utils.wire import FrameReader, FrameWriter, WireFrame
+
+# Frames written by the Uplink between waits for the socket to drain
+DRAIN_EVERY = 64
+
+# Receive buffer of a TV that stops reading, so that the Satellite's writes
+# stall soon
+STALLED_RCVBUF = 4096
+
+
+class CheckError(Exception):
+    pass
+
+
+def free_port() -> int:
+    with socket.socket() as sock:
+        sock.bind(("localhost", 0))
+        return sock.getsockname()[1]
+
+
+class Setup:
+    """An Uplink, a Satellite with one channel and the means to connect TVs"""
+
+    def __init__(self, args, **satellite_kwargs):
+        self.args = args
+        self.satellite_kwargs = satellite_kwargs
+        self.start = asyncio.Event()
+        self.done = asyncio.Event()
+        self.up_task: Optional[asyncio.Task] = None
+        self.channel = Channel(1, "localhost", free_port())
+
+    async def handle_uplink(self, reader, writer):
+        self.up_writer = writer
+        self.up_task = asyncio.current_task()
+        frames = FrameWriter(writer)
+        hello = asyncio.create_task(frames.serve_hello(reader))
+        payloads = [random.randbytes(self.args.frame_size) for _ in range(16)]
+        try:
+            await self.start.wait()
+            for i in range(self.args.frames):
+                if self.done.is_set():
+                    break
+                frames.write(WireFrame(1, 1000 + i, payloads[i % len(payloads)]))
+                if i % DRAIN_EVERY == 0:
+                    await writer.drain()
+            await writer.drain()
+            # Keep the connection up until the check is over
+            await self.done.wait()
+        except ConnectionResetError:
+            # Closed by __aexit__
+            pass
+        finally:
+            hello.cancel()
+
+    async def __aenter__(self):
+        # Python 3.11 reports the Satellite's downlinks, cancelled when the check
+        # is over, as errors of the server
+        loop = asyncio.get_running_loop()
+        loop.set_exception_handler(
+            lambda loop, context: None
+            if isinstance(context.get("exception"), asyncio.CancelledError)
+            else loop.default_exception_handler(context)
+        )
+        self.uplink = await asyncio.start_server(self.handle_uplink, "localhost", 0)
+        up_port = self.uplink.sockets[0].getsockname()[1]
+        self.satellite = Satellite(
+            {1: self.channel},
+            "localhost",
+            up_port,
+            stats_interval=0,
+            **self.satellite_kwargs,
+        )
+        self.task = asyncio.create_task(self.satellite.serve())
+        return self
+
+    async def __aexit__(self, *exc):
+        self.done.set()
+        self.task.cancel()
+        await asyncio.gather(self.task, return_exceptions=True)
+        if self.up_task is not None:
+            self.up_writer.transport.abort()
+            await self.up_task
+        self.uplink.close()
+
+    async def connect(self, rcvbuf: int = 0) -> tuple[FrameReader, asyncio.StreamWriter]:
+        """Connect a TV, and start the Uplink once the Satellite subscribed it"""
+        loop = asyncio.get_running_loop()
+        while True:
+            sock = socket.socket()
+            sock.setblocking(False)
+            if rcvbuf:
+                # Before connecting, so that the window is small from the start
+                sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, rcvbuf)
+            try:
+                await loop.sock_connect(sock, ("localhost", self.channel.down_port))
+                break
+            except OSError:
+                sock.close()
+                await asyncio.sleep(0.1)
+        reader, writer = await asyncio.open_connection(sock=sock)
+        frames = FrameReader(reader)
+        frames.request_binary(writer)
+        while not self.channel.pubsub.subscribers:
+            await asyncio.sleep(0.01)
+        self.start.set()
+        return frames, writer
+
+
+async def check_stalled_disconnected(args):
+    """A TV that stops reading is disconnected under the disconnect policy"""
+    async with Setup(
+        args, queue_size=args.queue_size, slow_policy=DISCONNECT, coalesce_delay=0
+    ) as setup:
+        frames, writer = await setup.connect(STALLED_RCVBUF)
+        try:
+            # Reading would let a stalled write through, so the Satellite has to
+            # drop the TV while it is not reading at all
+            try:
+                async with asyncio.timeout(args.timeout):
+                    while setup.channel.pubsub.subscribers:
+                        await asyncio.sleep(0.05)
+            except TimeoutError:
+                raise CheckError("the stalled TV is still subscribed")
+            # Whatever made it into the socket buffers may still be there, then
+            # the TV must see the end of the stream
+            try:
+                async with asyncio.timeout(args.timeout):
+                    while await frames.reader.read(65536):
+                        pass
+            except ConnectionResetError:
+                pass
+            except TimeoutError:
+                raise CheckError("the stalled TV is still connected")
+        finally:
+            writer.close()
+
+
+async def check_reader_served(args, policy: str):
+    """A TV that reads every frame gets all of them, with the default write
+    coalescing"""
+    async with Setup(args, queue_size=args.queue_size, slow_policy=policy) as setup:
+        frames, writer = await setup.connect()
+        received = 0
+        try:
+            async with asyncio.timeout(args.timeout + args.frames / 1000):
+                while received < args.frames:
+                    await frames.read()
+                    received += 1
+        except (TimeoutError, asyncio.IncompleteReadError, ConnectionResetError):
+            raise CheckError(f"only got {received} of {args.frames} frames")
+        finally:
+            writer.close()
+
+
+CHECKS = {
+    "stalled TV disconnected": check_stalled_disconnected,
+    "reading TV not disconnected": lambda args: check_reader_served(args, DISCONNECT),
+    "reading TV loses no frames": lambda args: check_reader_served(args, DROP_OLDEST),
+}
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(prog="ectf25.utils.satellite_test")
+    parser.add_argument(
+        "--frames", "-n", type=int, default=50000, help="Frames the Uplink sends"
+    )
+    parser.add_argument(
+        "--frame-size",
+        "-f",
+        type=int,
+        default=208,
+        help="Size (in bytes) of an encoded frame (default: a design3 frame)",
+    )
+    parser.add_argument(
+        "--queue-size", type=int, default=64, help="Frames queued for each TV"
+    )
+    parser.add_argument(
+        "--verbose", "-v", action="store_true", help="Show the Satellite's logs"
+    )
+    parser.add_argument(
+        "--timeout",
+        type=float,
+        default=5,
+        help="Seconds to wait for the Satellite to drop or close a connection",
+    )
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+    logger.remove()
+    if args.verbose:
+        logger.add(sys.stderr, level="INFO")
+
+    failed = 0
+    for name, check in CHECKS.items():
+        try:
+            asyncio.run(check(args))
+            print(f"PASS {name}")
+        except Exception as e:
+            print(f"FAIL {name}: {e!r}")
+            failed += 1
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,180 @@
+"""
+asyncio transport over a pyserial port
+
+pyserial configures the port (baud rate, raw mode, flushing). On POSIX the
+port's file descriptor is non-blocking and is watched by the event loop
+directly, so any number of ports can be served from one thread without
+polling. Elsewhere a reader thread per port hands received data to the loop.
+"""
+
+import asyncio
+import os
+import threading
+from typing import Optional
+
+from loguru import logger
+from serial import Serial
+
+# Largest read from the port in one go
+READ_SIZE = 65536
+
+
+class SerialTransport(asyncio.Transport):
+    """Transport that delivers the bytes of an open pyserial port to a Protocol"""
+
+    def __init__(
+        self,
+        loop: asyncio.AbstractEventLoop,
+        protocol: asyncio.Protocol,
+        ser: Serial,
+    ):
+        """
+        :param loop: Event loop to run on
+        :param protocol: Protocol to deliver received bytes to
+        :param ser: An open serial port. The transport owns it from now on
+        """
+        super().__init__()
+        self._loop = loop
+        self._protocol = protocol
+        self.ser = ser
+        self._fd: Optional[int] = getattr(ser, "fd", None)
+        self._write_buf = bytearray()
+        self._drained = asyncio.Event()
+        self._drained.set()
+        self._closing = False
+        self._thread: Optional[threading.Thread] = None
+        if self._fd is not None:
+            self._loop.add_reader(self._fd, self._read_ready)
+        else:
+            self._thread = threading.Thread(target=self._read_thread, daemon=True)
+            self._thread.start()
+        self._loop.call_soon(self._protocol.connection_made, self)
+
+    @classmethod
+    def open(
+        cls,
+        loop: asyncio.AbstractEventLoop,
+        protocol: asyncio.Protocol,
+        port: str,
+        baudrate: int,
+        **serial_kwargs,
+    ) -> "SerialTransport":
+        """Open a serial port and connect it to a Protocol
+
+        :param serial_kwargs: Extra args for the Serial constructor. Read and
+            write timeouts do not apply: the port is never read or written
+            blocking on POSIX
+        """
+        serial_kwargs.pop("timeout", None)
+        ser = Serial(port=port, baudrate=baudrate, timeout=0, **serial_kwargs)
+        return cls(loop, protocol, ser)
+
+    def _read_ready(self):
+        try:
+            data = os.read(self._fd, READ_SIZE)
+        except (BlockingIOError, InterruptedError):
+            return
+        except OSError as e:
+            # EIO once the other end of a pty is gone
+            self._fatal(e)
+            return
+        if not data:
+            self._fatal(None)
+            return
+        self._protocol.data_received(data)
+
+    def _read_thread(self):
+        self.ser.timeout = 0.1
+        while not self._closing:
+            try:
+                data = self.ser.read(max(1, self.ser.in_waiting))
+            except Exception as e:
+                self._loop.call_soon_threadsafe(self._fatal, e)
+                return
+            if data:
+                self._loop.call_soon_threadsafe(self._deliver, data)
+
+    def _deliver(self, data: bytes):
+        if not self._closing:
+            self._protocol.data_received(data)
+
+    def write(self, data: bytes):
+        if self._closing:
+            return
+        if self._fd is None:
+            self.ser.write(data)
+            return
+        if not self._write_buf:
+            try:
+                n = os.write(self._fd, data)
+            except (BlockingIOError, InterruptedError):
+                n = 0
+            except OSError as e:
+                self._fatal(e)
+                return
+            if n == len(data):
+                return
+            data = data[n:]
+            self._loop.add_writer(self._fd, self._write_ready)
+            self._drained.clear()
+        self._write_buf += data
+
+    def _write_ready(self):
+        try:
+            n = os.write(self._fd, self._write_buf)
+        except (BlockingIOError, InterruptedError):
+            return
+        except OSError as e:
+            self._fatal(e)
+            return
+        del self._write_buf[:n]
+        if not self._write_buf:
+            self._loop.remove_writer(self._fd)
+            self._drained.set()
+
+    def get_write_buffer_size(self) -> int:
+        return len(self._write_buf)
+
+    async def drain(self):
+        """Wait until everything written has left the port"""
+        await self._drained.wait()
+        self.ser.flush()
+
+    def set_baudrate(self, baudrate: int):
+        self.ser.baudrate = baudrate
+
+    @property
+    def baudrate(self) -> int:
+        return self.ser.baudrate
+
+    def reset_input_buffer(self):
+        """Discard anything received by the port but not delivered yet"""
+        self.ser.reset_input_buffer()
+
+    def is_closing(self) -> bool:
+        return self._closing
+
+    def close(self):
+        self._close(None)
+
+    def abort(self):
+        self._close(None)
+
+    def _fatal(self, exc: Optional[Exception]):
+        if exc is not None:
+            logger.debug(f"Serial port {self.ser.port} failed: {exc}")
+        self._close(exc)
+
+    def _close(self, exc: Optional[Exception]):
+        if self._closing:
+            return
+        self._closing = True
+        if self._fd is not None:
+            self._loop.remove_reader(self._fd)
+            self._loop.remove_writer(self._fd)
+        self._write_buf.clear()
+        self._drained.set()
+        if self._thread is not None:
+            self._thread.join()
+        self.ser.close()
+        self._loop.call_soon(self._protocol.connection_lost, exc)
@@ -19,7 +19,7 @@ from psutil import Process
 
 from loguru import logger
 
-from ectf25.utils.decoder import DecoderIntf, DecoderError
+from ectf25.utils.decoder import DecoderPool, DecoderError
 from ectf25_design.encoder import Encoder
 from ectf25_design.gen_subscription import gen_subscription
 
@@ -114,26 +114,32 @@ class StabilityTester:
     Test the stability of a design. The intent is to perform a long-running test of the decoder to
     ensure that it meets functional timing requirements under extended usage. Default test length
     is 8 hours.
+
+    Several decoders can be tested at once: each round, every decoder decodes DEC_TEST_SIZE frames
+    and the requirements apply to each of them.
     """
 
     def __init__(
         self,
-        decoder_port: str,
+        decoder_ports: list[str],
         global_secrets: bytes,
-        device_id: int,
+        device_ids: list[int],
         results_file: str,
         duration_minutes: int = 480,
         channel: int = 1,
         should_subscribe: bool = False,
     ):
-        self.decoder_port = decoder_port
+        if len(device_ids) != len(decoder_ports):
+            raise ValueError("Need one decoder ID per decoder port")
+        self.decoder_ports = decoder_ports
         self.global_secrets = global_secrets
-        self.device_id = device_id
+        self.device_ids = device_ids
         self.results_file = results_file
         self.duration_minutes = duration_minutes
         self.channel = channel
 
-        self.decoder_intf = DecoderIntf(decoder_port)
+        # One frame in flight per decoder, so the pool times each decode on its own
+        self.decoder_pool = DecoderPool(decoder_ports, depth=1)
         self.encoder = Encoder(global_secrets)
 
         self.timestamp = 0
@@ -148,17 +154,17 @@ class StabilityTester:
         ts_min = 0
         ts_max = 0xFFFF_FFFF_FFFF_FFFF
         # these will throw their own errors, no need to check return values
-        sub = gen_subscription(
-            self.global_secrets, self.device_id, ts_min, ts_max, self.channel
-        )
-        self.decoder_intf.subscribe(sub)
+        for device, device_id in enumerate(self.device_ids):
+            sub = gen_subscription(
+                self.global_secrets, device_id, ts_min, ts_max, self.channel
+            )
+            self.decoder_pool.subscribe(device, sub)
 
-    @timed_call(max_runtime_ms=DEC_FRAME_MS, enforce_time=True)
-    def decode_frame(self, frame: bytes) -> tuple[float, bytes]:
+    def close(self):
         """
-        Decode one frame
+        Close the connections to the decoders
         """
-        return self.decoder_intf.decode(frame)
+        self.decoder_pool.close()
 
     def encode_frame(self, ptxt_frame: bytes, timestamp: int):
         """
@@ -184,14 +190,19 @@ class StabilityTester:
     @timed_call(enforce_time=False)
     def decode(self, frames: list[bytes]) -> list[bytes]:
         """
-        Decode a set of frames
+        Decode a set of frames, spread over the decoders
+
+        Each frame must be decoded within DEC_FRAME_MS of reaching its decoder
         """
         ret = []
-        for frame in frames:
+        for result in self.decoder_pool.decode_stream(
+            (self.channel, frame) for frame in frames
+        ):
             self.total_decodes += 1
-            try:
-                _, frame = self.decode_frame(frame)
-            except TimingError:
+            if result.error is not None:
+                raise result.error
+            frame = result.decoded
+            if result.decode_time * MS_PER_SEC > DEC_FRAME_MS:
                 self.timing_fails += 1
                 frame = None
             ret.append(frame)
@@ -206,6 +217,8 @@ class StabilityTester:
         """
         enc_times = []
         dec_times = []
+        n_decoders = len(self.decoder_ports)
+        dec_size = min(DEC_TEST_SIZE * n_decoders, ENC_TEST_SIZE)
 
         start = time.time()
         while time.time() - start < self.duration_minutes * 60:
@@ -219,7 +232,7 @@ class StabilityTester:
 
             # Trim down the generated list for the decode test, as Encoder FPS
             # requirement is higher than Decoder
-            subset = set(random.sample(range(ENC_TEST_SIZE), DEC_TEST_SIZE))
+            subset = set(random.sample(range(ENC_TEST_SIZE), dec_size))
             enc_frames = [f for idx, f in enumerate(enc_frames) if idx in subset]
 
             dec_time, dec_frames = self.decode(enc_frames)
@@ -244,7 +257,8 @@ class StabilityTester:
 
             # check decoder meets FPS requirement
             if len(dec_times) >= ROLLING_TIME_SECONDS:
-                dec_fps = (len(dec_times) * DEC_TEST_SIZE) / sum(dec_times)
+                # per decoder, as they decode at the same time
+                dec_fps = (len(dec_times) * dec_size) / sum(dec_times) / n_decoders
                 logger.debug(f"Current Decoder FPS: {dec_fps}")
                 if dec_fps < FPS_REQ_DECODER:
                     raise TimingError(
@@ -257,6 +271,7 @@ class StabilityTester:
         results_fmt += f"Total decodes: {self.total_decodes}\n"
         results_fmt += f"Failure rate: {self.timing_fails / self.total_decodes}\n"
         logger.info(results_fmt)
+        self.decoder_pool.log_summary()
         if self.results_file is not None:
             with open(self.results_file, "w") as f:
                 f.write(results_fmt)
@@ -266,7 +281,12 @@ class StabilityTester:
 def parse_args():
     parser = argparse.ArgumentParser(prog="stability_test.py")
     parser.add_argument(
-        "-p", "--port", required=True, type=str, help="Decoder serial port"
+        "-p",
+        "--port",
+        required=True,
+        action="append",
+        type=str,
+        help="Decoder serial port. Repeat to test several decoders at once",
     )
     parser.add_argument(
         "-g", "--global-secrets", required=True, type=str, help="Path to global secrets"
@@ -278,8 +298,9 @@ def parse_args():
         "-di",
         "--decoder-id",
         required=True,
+        action="append",
         type=lambda x: int(x, 16),
-        help="Decoder ID",
+        help="Decoder ID. Repeat once per port, in the same order",
     )
     parser.add_argument(
         "-r",
@@ -321,7 +342,10 @@ def main():
         args.channel,
         args.subscribe,
     )
-    st.run()
+    try:
+        st.run()
+    finally:
+        st.close()
 
 
 if __name__ == "__main__":
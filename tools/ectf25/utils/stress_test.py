@@ -22,7 +22,7 @@ from loguru import logger
 from tqdm import tqdm
 
 from ectf25.utils import Encoder
-from ectf25.utils.decoder import DecoderIntf
+from ectf25.utils.decoder import DISPATCH_POLICIES, DecoderPool
 
 Frame = namedtuple("Frame", ["channel", "data", "timestamp"])
 
@@ -72,23 +72,31 @@ def test_encoder(args):
             args.dump,
         )
 
-    kb_threshold = args.threshold / 1000
-    kb_throughput = args.test_size / total / 1000
+    check_throughput(args.test_size / total / 1000, args.threshold / 1000)
+
+
+def check_throughput(kb_throughput: float, kb_threshold: float, name: str = ""):
+    """Exit with an error if `kb_throughput` is below `kb_threshold`"""
     if kb_throughput < kb_threshold:
         logger.error(
-            f"Throughput too slow! {kb_throughput:,.2f} KBps < {kb_threshold:,.2f} KBps"
+            f"{name}Throughput too slow!"
+            f" {kb_throughput:,.2f} KBps < {kb_threshold:,.2f} KBps"
         )
         exit(-1)
     else:
         logger.success(
-            "Throughput sufficient:"
+            f"{name}Throughput sufficient:"
             f" {kb_throughput:,.2f} KBps > {kb_threshold:,.2f} KBps"
         )
 
 
 def test_decoder(args):
-    """Test the decoder by passing the frames generated by `test_encoder` to the decoder"""
-    decoder = DecoderIntf(args.port)
+    """Test the decoder by passing the frames generated by `test_encoder` to the decoder
+
+    With several ports, the frames are spread over all of the Decoders and each of
+    them must meet the threshold
+    """
+    pool = DecoderPool(args.port, dispatch=args.dispatch)
     logger.info("Loading encoded frames...")
     frames = [
         Frame(
@@ -102,28 +110,31 @@ def test_decoder(args):
     logger.info("Running stress test...")
     total_frame_len = 0
     start = time.perf_counter()
-    for frame in tqdm(frames):
-        try:
-            frame_data = decoder.decode(frame.data)
-            total_frame_len += len(frame_data)
-        except Exception as e:
-            logger.error(f"Errored on frame {frame}!")
-            raise e
+    results = pool.decode_stream((frame.channel, frame.data) for frame in frames)
+    try:
+        for frame, result in zip(frames, tqdm(results, total=len(frames))):
+            if result.error is not None:
+                logger.error(f"Errored on frame {frame}!")
+                raise result.error
+            total_frame_len += len(result.decoded)
+    finally:
+        results.close()
+        pool.close()
     total = time.perf_counter() - start
 
     # Check threshold
     kb_threshold = args.threshold / 1000
-    kb_throughput = total_frame_len / total / 1000
-    if kb_throughput < kb_threshold:
-        logger.error(
-            f"Throughput too slow! {kb_throughput:,.2f} KBps < {kb_threshold:,.2f} KBps"
-        )
-        exit(-1)
-    else:
-        logger.success(
-            "Throughput sufficient:"
-            f" {kb_throughput:,.2f} KBps > {kb_threshold:,.2f} KBps"
-        )
+    if len(pool.ports) > 1:
+        pool.log_summary()
+        for port, stats in zip(pool.ports, pool.device_stats):
+            # channel dispatch leaves a Decoder idle if there are fewer channels
+            if stats.frames == 0:
+                logger.warning(f"{port}: no frames dispatched")
+                continue
+            check_throughput(
+                stats.bytes_decoded / stats.elapsed / 1000, kb_threshold, f"{port}: "
+            )
+    check_throughput(total_frame_len / total / 1000, kb_threshold)
 
 
 def parse_args():
@@ -163,7 +174,14 @@ def parse_args():
     decode_parser.set_defaults(threshold=640.0)
     decode_parser.add_argument(
         "port",
-        help="Serial port to the Decoder (See https://rules.ectf.mitre.org/2025/getting_started/boot_reference for platform-specific instructions)",
+        nargs="+",
+        help="Serial port to the Decoder, or ports to several Decoders to test at once (See https://rules.ectf.mitre.org/2025/getting_started/boot_reference for platform-specific instructions)",
+    )
+    decode_parser.add_argument(
+        "--dispatch",
+        choices=DISPATCH_POLICIES,
+        default=DISPATCH_POLICIES[0],
+        help="How frames are spread over several Decoders",
     )
     decode_parser.add_argument(
         "frames",
@@ -11,6 +11,8 @@ Copyright: Copyright (c) 2025 The MITRE Corporation
 """
 
 import argparse
+from collections import deque
+from contextlib import closing
 import json
 from pathlib import Path
 import random
@@ -21,7 +23,7 @@ from typing import Iterator
 from loguru import logger
 
 from ectf25.utils import Encoder
-from ectf25.utils.decoder import DecoderIntf
+from ectf25.utils.decoder import DISPATCH_POLICIES, DecoderPool
 
 
 def rand_gen(args) -> Iterator[tuple[int, bytes, int]]:
@@ -128,8 +130,15 @@ def parse_args():
     parser.add_argument(
         "--port",
         "-p",
+        action="append",
         default=None,
-        help="Serial port to the Decoder (See https://rules.ectf.mitre.org/2025/getting_started/boot_reference for platform-specific instructions)",
+        help="Serial port to the Decoder. Repeat to decode on several Decoders at once (See https://rules.ectf.mitre.org/2025/getting_started/boot_reference for platform-specific instructions)",
+    )
+    parser.add_argument(
+        "--dispatch",
+        choices=DISPATCH_POLICIES,
+        default=DISPATCH_POLICIES[0],
+        help="How frames are spread over several Decoders",
     )
     parser.add_argument(
         "--delay", "-d", type=float, default=0, help="Delay after frame decoding"
@@ -218,18 +227,21 @@ def main():
     raw_frames = []
     encoded_frames = []
     decoded_frames = []
-    decoder = DecoderIntf(args.port)
+    pool = (
+        None if args.stub_decoder else DecoderPool(args.port, dispatch=args.dispatch)
+    )
+    # frames handed to the Decoders whose result has not been checked yet
+    pending = deque()
 
     # performance stats
     nbytes = 0
     encoder_time = 0
-    decoder_time = 0
 
-    try:
+    def encode_frames() -> Iterator[tuple[int, bytes]]:
+        nonlocal encoder_time
         # get frames from generator
         for channel, raw_frame, timestamp in args.frame_generator(args):
             logger.debug(f"RAW IN  C: {channel}, F: {raw_frame}, TS: {timestamp}")
-            nbytes += len(raw_frame)
             raw_frames.append(
                 (channel, raw_frame.decode(errors="backslashreplace"), timestamp)
             )
@@ -247,15 +259,32 @@ def main():
             encoded_frames.append(
                 (channel, encoded_frame.decode(errors="backslashreplace"), timestamp)
             )
+            pending.append((channel, raw_frame, timestamp))
+            yield channel, encoded_frame
 
-            # decode frame or use encoded frame if decoder stubbed out
-            if args.stub_decoder:
-                decoded_frame = encoded_frame
+    def decode_frames() -> Iterator[bytes]:
+        # decode frames or use encoded frames if decoder stubbed out
+        if args.stub_decoder:
+            for _, encoded_frame in encode_frames():
                 logger.warning("Decoder stubbed out. Using encoded frame")
-            else:
-                start = time.perf_counter()
-                decoded_frame = decoder.decode(encoded_frame)
-                decoder_time += time.perf_counter() - start
+                yield encoded_frame
+            return
+        # frames typed on stdin are decoded as soon as they are entered, and with
+        # --delay each frame is only sent once the delay after the previous one
+        # is over; other sources keep every Decoder busy
+        strict = args.frame_generator is stdin_gen or args.delay > 0
+        ahead = 0 if strict else None
+        with closing(pool.decode_stream(encode_frames(), ahead=ahead)) as results:
+            for result in results:
+                if result.error is not None:
+                    raise result.error
+                yield result.decoded
+
+    decoded = decode_frames()
+    try:
+        for decoded_frame in decoded:
+            channel, raw_frame, timestamp = pending.popleft()
+            nbytes += len(raw_frame)
 
             # warn if frame doesn't match
             if raw_frame != decoded_frame:
@@ -269,7 +298,11 @@ def main():
             # print performance stats if requested
             if args.perf:
                 encoder_avg = "N/A" if args.stub_encoder else int(nbytes / encoder_time)
-                decoder_avg = "N/A" if args.stub_decoder else int(nbytes / decoder_time)
+                decoder_avg = (
+                    "N/A"
+                    if args.stub_decoder
+                    else int(pool.stats.bytes_decoded / pool.stats.elapsed)
+                )
                 logger.info(
                     f"STATS: encoder {encoder_avg} B/s, decoder {decoder_avg} B/s"
                 )
@@ -277,6 +310,12 @@ def main():
             # sleep if requested
             time.sleep(args.delay)
     finally:
+        decoded.close()
+        if pool is not None:
+            if args.perf:
+                pool.log_summary()
+            pool.close()
+
         # dump frames
         if args.dump_raw:
             with open(args.dump_raw, "w") as f:
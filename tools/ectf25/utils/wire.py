@@ -0,0 +1,172 @@
+"""
+Wire format of encoded frames from the Uplink to the Satellite and on to the TVs
+
+Frames are sent as JSON lines ({"channel", "timestamp", "encoded" as hex}) unless
+the receiving end asks for binary framing by sending HELLO_BINARY right after it
+connects. A sender that supports it echoes HELLO_BINARY in the stream and sends
+every frame after that as a fixed HEADER (magic, channel, timestamp, length)
+followed by the raw encoded frame, so a Satellite can route frames without
+parsing them and nothing is hex encoded. Ends that predate binary framing never
+send or echo the hello, so the link stays on JSON lines.
+"""
+
+import asyncio
+import json
+import struct
+from typing import Optional
+
+FORMAT_JSON = "json"
+FORMAT_BINARY = "binary"
+WIRE_FORMATS = (FORMAT_JSON, FORMAT_BINARY)
+
+HELLO_BINARY = b'{"format": "binary"}\n'
+
+# magic, channel, timestamp, length of the encoded frame
+HEADER = struct.Struct("<2sIQH")
+MAGIC = b"\xecF"
+
+
+class WireFrame:
+    """An encoded frame, keeping the wire encodings it has already been through"""
+
+    __slots__ = ("channel", "timestamp", "_encoded", "_hex", "_json", "_binary")
+
+    def __init__(
+        self,
+        channel: int,
+        timestamp: int,
+        encoded: Optional[bytes] = None,
+        *,
+        hex_encoded: Optional[str] = None,
+        json_line: Optional[bytes] = None,
+        binary: Optional[bytes] = None,
+    ):
+        """
+        :param encoded: The encoded frame, or None if hex_encoded is given
+        :param hex_encoded: The encoded frame as hex, as it came in a JSON line
+        :param json_line: The frame as received in JSON, to forward unchanged
+        :param binary: The frame as received in binary, to forward unchanged
+        """
+        self.channel = channel
+        self.timestamp = timestamp
+        self._encoded = encoded
+        self._hex = hex_encoded
+        self._json = json_line
+        self._binary = binary
+
+    @property
+    def encoded(self) -> bytes:
+        if self._encoded is None:
+            self._encoded = bytes.fromhex(self._hex)
+        return self._encoded
+
+    def json_line(self) -> bytes:
+        """The frame as a JSON line"""
+        if self._json is None:
+            if self._hex is None:
+                self._hex = self.encoded.hex()
+            self._json = (
+                json.dumps(
+                    {
+                        "channel": self.channel,
+                        "timestamp": self.timestamp,
+                        "encoded": self._hex,
+                    }
+                ).encode()
+                + b"\n"
+            )
+        return self._json
+
+    def binary(self) -> bytes:
+        """The frame as a binary header and the raw encoded frame"""
+        if self._binary is None:
+            encoded = self.encoded
+            self._binary = (
+                HEADER.pack(MAGIC, self.channel, self.timestamp, len(encoded)) + encoded
+            )
+        return self._binary
+
+
+class FrameReader:
+    """Read frames from a stream in whichever format the sender uses"""
+
+    def __init__(self, reader: asyncio.StreamReader):
+        self.reader = reader
+        self.binary = False
+
+    def request_binary(self, writer: asyncio.StreamWriter):
+        """Ask the sender for binary framing. Frames keep coming as JSON lines if
+        it does not support it"""
+        writer.write(HELLO_BINARY)
+
+    async def read(self) -> WireFrame:
+        """Read the next frame
+
+        :raises asyncio.IncompleteReadError: The stream ended
+        :raises ValueError: The stream is not in either format
+        """
+        while True:
+            if self.binary:
+                header = await self.reader.readexactly(HEADER.size)
+                magic, channel, timestamp, length = HEADER.unpack(header)
+                if magic != MAGIC:
+                    raise ValueError(f"Bad frame header {header!r}")
+                encoded = await self.reader.readexactly(length)
+                return WireFrame(
+                    channel, timestamp, encoded, binary=header + encoded
+                )
+
+            line = await self.reader.readline()
+            if not line.endswith(b"\n"):
+                raise asyncio.IncompleteReadError(line, None)
+            if line == HELLO_BINARY:
+                # Everything after the echo is binary
+                self.binary = True
+                continue
+            frame = json.loads(line)
+            return WireFrame(
+                frame["channel"],
+                frame["timestamp"],
+                hex_encoded=frame["encoded"],
+                json_line=line,
+            )
+
+
+class FrameWriter:
+    """Write frames to a stream in the format the receiver asked for"""
+
+    def __init__(self, writer: asyncio.StreamWriter):
+        self.writer = writer
+        self.binary = False
+        self._switch = False
+
+    def start_binary(self):
+        """Switch to binary framing before the next frame without being asked, for
+        a receiver known to be a FrameReader"""
+        self._switch = True
+
+    async def serve_hello(self, reader: asyncio.StreamReader):
+        """Switch to binary framing before the next frame once the receiver asks"""
+        while line := await reader.readline():
+            if line == HELLO_BINARY and not self.binary:
+                self._switch = True
+
+    def write(self, frame: WireFrame):
+        if self._switch:
+            self._switch = False
+            self.binary = True
+            self.writer.write(HELLO_BINARY)
+        self.writer.write(frame.binary() if self.binary else frame.json_line())
+
+    def write_many(self, frames: list[WireFrame]):
+        """Write several frames with a single write to the transport"""
+        data = []
+        if self._switch:
+            self._switch = False
+            self.binary = True
+            data.append(HELLO_BINARY)
+        if self.binary:
+            data += [frame.binary() for frame in frames]
+        else:
+            data += [frame.json_line() for frame in frames]
+        self.writer.writelines(data)
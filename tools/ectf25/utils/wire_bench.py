@@ -0,0 +1,308 @@
+"""
+Measure the cost of the Uplink -> Satellite -> TV wire formats
+
+Runs the real Satellite (python -m ectf25.satellite) between a stand-in Uplink
+and a stand-in fleet of TVs, one connection per channel, and pushes the same
+frames through it with each wire format (see ectf25.utils.wire) and each
+downlink write coalescing delay. The Uplink stand-in sends pre-encoded frames as
+fast as the Satellite takes them, optionally with every Nth frame on channel 0
+(sent to every TV), and the TV stand-in reads them the way ectf25.tv does. Each
+runs in its own process, so the CPU time per frame delivered to a TV of the
+Uplink, the Satellite and the TVs is reported separately, along with frames per
+second delivered, bytes per frame on the wire and the Satellite's downlink
+writes (each one send() to the kernel, or fewer) per frame:
+
+    python3 -m ectf25.utils.wire_bench --channels 128 --frames-per-channel 200 \
+        --broadcast-every 16 --coalesce-ms 0 2
+"""
+
+import argparse
+import asyncio
+from collections import Counter
+import json
+import multiprocessing
+import os
+import random
+import subprocess
+import sys
+import tempfile
+import time
+
+import psutil
+from loguru import logger
+
+from ectf25.satellite import DEFAULT_COALESCE_DELAY
+from ectf25.utils.wire import (
+    FORMAT_BINARY,
+    WIRE_FORMATS,
+    FrameReader,
+    FrameWriter,
+    WireFrame,
+)
+
+# Frames written between waits for the socket to drain
+DRAIN_EVERY = 64
+
+# Seconds between the Satellite's stats reports, read once the TVs have all frames
+SAT_STATS_INTERVAL = 0.2
+
+
+def schedule(args) -> list[int]:
+    """Channel of every frame the Uplink sends"""
+    n = args.channels * args.frames_per_channel
+    every = args.broadcast_every
+    return [
+        0 if every and i % every == every - 1 else 1 + i % args.channels
+        for i in range(n)
+    ]
+
+
+def per_tv(args) -> list[int]:
+    """Frames the TV of each channel receives: its channel's and channel 0's"""
+    counts = Counter(schedule(args))
+    return [counts[1 + i] + counts[0] for i in range(args.channels)]
+
+
+def uplink(args, fmt: str, conn, start):
+    """Serve the frames to the Satellite once `start` is set
+
+    Sends the listening port, then the CPU seconds spent sending, over `conn`
+    """
+
+    async def handle(reader, writer):
+        frames = FrameWriter(writer)
+        hello = asyncio.create_task(frames.serve_hello(reader))
+        payloads = [random.randbytes(args.frame_size) for _ in range(16)]
+        # The Satellite asks for its format right after connecting, well before
+        # the start
+        await asyncio.get_running_loop().run_in_executor(None, start.wait)
+
+        channels = schedule(args)
+        cpu = time.process_time()
+        for i, channel in enumerate(channels):
+            frames.write(WireFrame(channel, 1000 + i, payloads[i % len(payloads)]))
+            if i % DRAIN_EVERY == 0:
+                await writer.drain()
+        await writer.drain()
+        conn.send(time.process_time() - cpu)
+        hello.cancel()
+        # Keep the connection up until the bench is over
+        await asyncio.Event().wait()
+
+    async def serve():
+        server = await asyncio.start_server(handle, "localhost", 0)
+        conn.send(server.sockets[0].getsockname()[1])
+        async with server:
+            await server.serve_forever()
+
+    asyncio.run(serve())
+
+
+def tvs(args, fmt: str, downlinks: list[tuple[int, int]], conn, ready, start):
+    """Connect a TV to each Satellite port in `downlinks` and read until it has
+    the number of frames given with the port
+
+    Sends (CPU seconds, wall seconds from start to the last frame, bytes per
+    frame on the wire) over `conn`
+    """
+    connected = 0
+
+    async def connect(port: int):
+        while True:
+            try:
+                return await asyncio.open_connection("localhost", port)
+            except OSError:
+                await asyncio.sleep(0.1)
+
+    async def watch(port: int, expected: int) -> int:
+        nonlocal connected
+        reader, writer = await connect(port)
+        frames = FrameReader(reader)
+        if fmt == FORMAT_BINARY:
+            frames.request_binary(writer)
+        connected += 1
+        for _ in range(expected):
+            frame = await frames.read()
+            # The TV hands the raw frame to the Decoder
+            frame.encoded
+        writer.close()
+        return len(frame.binary() if frames.binary else frame.json_line())
+
+    async def run():
+        watchers = [
+            asyncio.create_task(watch(port, expected)) for port, expected in downlinks
+        ]
+        while connected < len(downlinks):
+            await asyncio.sleep(0.05)
+        # Frames published before the Satellite subscribes a downlink are not
+        # sent to it; give it a moment to subscribe them all
+        await asyncio.sleep(0.5)
+        ready.set()
+        await asyncio.get_running_loop().run_in_executor(None, start.wait)
+        cpu = time.process_time()
+        wall = time.perf_counter()
+        sizes = await asyncio.gather(*watchers)
+        conn.send(
+            (
+                time.process_time() - cpu,
+                time.perf_counter() - wall,
+                sum(sizes) / len(sizes),
+            )
+        )
+
+    asyncio.run(run())
+
+
+def run(args, fmt: str, coalesce_ms: float) -> dict:
+    """Push the frames through a fresh Satellite in one wire format"""
+    sat_stats = os.path.join(tempfile.mkdtemp(), "satellite.json")
+    up_conn, up_child = multiprocessing.Pipe()
+    tv_conn, tv_child = multiprocessing.Pipe()
+    ready = multiprocessing.Event()
+    start = multiprocessing.Event()
+
+    up = multiprocessing.Process(
+        target=uplink, args=(args, fmt, up_child, start), daemon=True
+    )
+    up.start()
+    up_port = up_conn.recv()
+
+    satellite = subprocess.Popen(
+        [
+            sys.executable,
+            "-m",
+            "ectf25.satellite",
+            "localhost",
+            str(up_port),
+            "localhost",
+            *(f"{1 + i}:{args.base_port + i}" for i in range(args.channels)),
+            "--wire",
+            fmt,
+            "--coalesce-ms",
+            str(coalesce_ms),
+            # Measure the wire, not the slow-TV policy: never drop a frame
+            "--queue-size",
+            str(max(per_tv(args))),
+            "--stats-interval",
+            str(SAT_STATS_INTERVAL),
+            "--stats-json",
+            sat_stats,
+        ],
+        stdout=subprocess.DEVNULL,
+        stderr=subprocess.DEVNULL,
+    )
+    downlinks = [(args.base_port + i, n) for i, n in enumerate(per_tv(args))]
+    tv = multiprocessing.Process(
+        target=tvs, args=(args, fmt, downlinks, tv_child, ready, start), daemon=True
+    )
+    tv.start()
+    try:
+        if not ready.wait(60):
+            raise RuntimeError("TVs could not connect to the Satellite")
+        sat_cpu = psutil.Process(satellite.pid).cpu_times()
+        start.set()
+        up_cpu = up_conn.recv()
+        tv_cpu, elapsed, frame_bytes = tv_conn.recv()
+        sat_end = psutil.Process(satellite.pid).cpu_times()
+        # The TVs hung up after their last frame; wait for a report with every
+        # downlink gone
+        time.sleep(2 * SAT_STATS_INTERVAL)
+        with open(sat_stats) as f:
+            stats = json.load(f)
+    finally:
+        satellite.terminate()
+        satellite.wait()
+        up.terminate()
+        tv.terminate()
+        up.join()
+        tv.join()
+
+    n = sum(per_tv(args))
+    sat_cpu = (sat_end.user + sat_end.system) - (sat_cpu.user + sat_cpu.system)
+    return {
+        "wire": fmt,
+        "coalesce_ms": coalesce_ms,
+        "channels": args.channels,
+        "broadcast_every": args.broadcast_every,
+        "frame_size": args.frame_size,
+        "frames": n,
+        "writes_per_frame": stats["writes"] / n,
+        "frames_per_second": n / elapsed,
+        "wire_bytes_per_frame": frame_bytes,
+        "uplink_cpu_us_per_frame": 1e6 * up_cpu / n,
+        "satellite_cpu_us_per_frame": 1e6 * sat_cpu / n,
+        "tv_cpu_us_per_frame": 1e6 * tv_cpu / n,
+    }
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(prog="ectf25.utils.wire_bench")
+    parser.add_argument(
+        "--channels", "-c", type=int, default=128, help="Channels (one TV each)"
+    )
+    parser.add_argument(
+        "--frames-per-channel", "-n", type=int, default=200, help="Frames per channel"
+    )
+    parser.add_argument(
+        "--frame-size",
+        "-f",
+        type=int,
+        default=208,
+        help="Size (in bytes) of an encoded frame (default: a design3 frame)",
+    )
+    parser.add_argument(
+        "--broadcast-every",
+        type=int,
+        default=0,
+        help="Send every Nth frame on channel 0, to every TV (0: never)",
+    )
+    parser.add_argument(
+        "--base-port",
+        type=int,
+        default=23000,
+        help="Satellite downlink port of the first channel",
+    )
+    parser.add_argument(
+        "--wire",
+        choices=WIRE_FORMATS,
+        nargs="+",
+        default=list(WIRE_FORMATS),
+        help="Wire formats to measure",
+    )
+    parser.add_argument(
+        "--coalesce-ms",
+        type=float,
+        nargs="+",
+        default=[0, DEFAULT_COALESCE_DELAY * 1000],
+        help="Satellite downlink write coalescing delays to measure",
+    )
+    parser.add_argument("--json", default=None, help="Also write the results here")
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+
+    results = []
+    for fmt in args.wire:
+        for coalesce_ms in args.coalesce_ms:
+            result = run(args, fmt, coalesce_ms)
+            results.append(result)
+            print(json.dumps(result), flush=True)
+            logger.info(
+                f"{fmt:>6} x{args.channels} channels, coalesce {coalesce_ms:4} ms:"
+                f" {result['frames_per_second']:9.1f} frames/s,"
+                f" {result['wire_bytes_per_frame']:5.0f} B/frame,"
+                f" {result['writes_per_frame']:5.3f} writes/frame, CPU/frame"
+                f" uplink {result['uplink_cpu_us_per_frame']:6.1f} us,"
+                f" satellite {result['satellite_cpu_us_per_frame']:6.1f} us,"
+                f" TVs {result['tv_cpu_us_per_frame']:6.1f} us"
+            )
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(results, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()